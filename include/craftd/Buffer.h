@@ -42,6 +42,17 @@ typedef struct _CDBuffer {
 	bool external;
 } CDBuffer;
 
+/**
+ * An immutable payload that many Buffers can reference without copying it,
+ * it's freed once the last reference is dropped.
+ */
+typedef struct _CDSharedBuffer {
+	volatile int references;
+
+	size_t  length;
+	uint8_t data[];
+} CDSharedBuffer;
+
 /**
  * Create an empty Buffer object
  *
@@ -74,4 +85,31 @@ CDPointer CD_BufferRemove (CDBuffer* self, size_t length);
 
 CDBuffer* CD_BufferRemoveBuffer (CDBuffer* self);
 
+/**
+ * Create a SharedBuffer holding a copy of the content of a Buffer, the caller owns one reference
+ *
+ * @param data The Buffer to copy the content from
+ *
+ * @return The instantiated SharedBuffer object
+ */
+CDSharedBuffer* CD_CreateSharedBuffer (CDBuffer* data);
+
+/**
+ * Take another reference to a SharedBuffer
+ *
+ * @return The same SharedBuffer
+ */
+CDSharedBuffer* CD_ReferenceSharedBuffer (CDSharedBuffer* self);
+
+/**
+ * Drop a reference to a SharedBuffer, the last one frees it
+ */
+void CD_DestroySharedBuffer (CDSharedBuffer* self);
+
+/**
+ * Append a reference to a SharedBuffer, the reference is dropped when the
+ * Buffer drains the data
+ */
+void CD_BufferAddSharedBuffer (CDBuffer* self, CDSharedBuffer* data);
+
 #endif
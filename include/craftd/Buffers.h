@@ -39,6 +39,9 @@ typedef struct _CDBuffers {
 	CDBuffer* output;
 
 	bool external;
+
+	// protocol parsing progress kept between reads, it's freed with the buffers
+	CDPointer parser;
 } CDBuffers;
 
 CDBuffers* CD_CreateBuffers (void);
@@ -29,27 +29,41 @@
 #include <craftd/common.h>
 
 struct _CDServer;
+struct _CDReactor;
+struct _CDStrand;
+struct _CDJob;
 
+/* Max number of parsed packets waiting on a Client's strand before it stops parsing */
+#define CD_CLIENT_MAX_PENDING 8
+
+/* Bytes waiting in a Client's output buffer above which bulk senders should hold back */
+#define CD_CLIENT_WATERMARK 262144
+
+/**
+ * A Client goes from Connect to Idle once connected and to Disconnect only once,
+ * the status is only changed atomically.
+ */
 typedef enum _CDClientStatus {
 	CDClientConnect,
 	CDClientIdle,
-	CDClientProcess,
 	CDClientDisconnect
 } CDClientStatus;
 
 typedef struct _CDClient {
-	struct _CDServer* server;
+	struct _CDServer*  server;
+	struct _CDReactor* reactor;
 
 	char            ip[128];
 	evutil_socket_t socket;
 	CDBuffers*      buffers;
 
-	CDClientStatus status;
-	uint8_t        jobs;
+	struct _CDStrand* strand;
+
+	volatile CDClientStatus status;
+	volatile int            jobs;
 
-	struct {
-		pthread_rwlock_t status;
-	} lock;
+	// queued on the strand once the output drains below CD_CLIENT_WATERMARK / 2
+	struct _CDJob* volatile drain;
 
 	CD_DEFINE_DYNAMIC;
 	CD_DEFINE_ERROR;
@@ -69,6 +83,51 @@ CDClient* CD_CreateClient (struct _CDServer* server);
  */
 void CD_DestroyClient (CDClient* self);
 
+/**
+ * Get the current status of a Client
+ */
+CDClientStatus CD_ClientGetStatus (CDClient* self);
+
+/**
+ * Change the status of a Client if it's still the expected one.
+ *
+ * @return true if the status was changed
+ */
+bool CD_ClientChangeStatus (CDClient* self, CDClientStatus from, CDClientStatus to);
+
+/**
+ * Queue a Job on the Client strand, Jobs of the same Client run in order and never in parallel.
+ *
+ * @return false if the Client is disconnecting, the Job is destroyed in that case
+ */
+bool CD_ClientAddJob (CDClient* self, struct _CDJob* job);
+
+/**
+ * Mark the Client as disconnecting and queue its disconnection as the last Job of its strand.
+ *
+ * @return false if the Client was already disconnecting
+ */
+bool CD_ClientDisconnect (CDClient* self);
+
+/**
+ * Queue a Job on the Client strand once its output buffer drained below half
+ * CD_CLIENT_WATERMARK, or right away if it already has. Only one Job can wait.
+ *
+ * @return false if another Job is already waiting, the Job is destroyed in that case
+ */
+bool CD_ClientAddJobOnDrain (CDClient* self, struct _CDJob* job);
+
+/**
+ * Called by the reactor when the output buffer of the Client drained, queues the
+ * Job waiting on it if any.
+ */
+void CD_ClientDrained (CDClient* self);
+
+/**
+ * Check if the output buffer of the Client is over CD_CLIENT_WATERMARK
+ */
+bool CD_ClientIsCongested (CDClient* self);
+
 /**
  * Send a raw String to a Client
  *
@@ -76,4 +135,11 @@ void CD_DestroyClient (CDClient* self);
  */
 void CD_ClientSendBuffer (CDClient* self, CDBuffer* data);
 
+/**
+ * Send a SharedBuffer to a Client without copying it
+ *
+ * @param data The SharedBuffer to reference
+ */
+void CD_ClientSendSharedBuffer (CDClient* self, CDSharedBuffer* data);
+
 #endif
@@ -29,6 +29,9 @@
 #include <craftd/common.h>
 #include <libconfig.h>
 
+/* Upper bound of server.connection.batch, the packets are collected on the stack */
+#define CD_CONFIG_MAX_BATCH 256
+
 typedef struct _CDConfig {
 	config_t data;
 
@@ -43,6 +46,9 @@ typedef struct _CDConfig {
 
 			uint16_t port;
 			int      backlog;
+			int      reactors;
+			int      batch;
+			bool     cork;
 		} connection;
 
 		struct {
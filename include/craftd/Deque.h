@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_DEQUE_H
+#define CRAFTD_DEQUE_H
+
+#include <craftd/common.h>
+
+#define CD_DEQUE_DEFAULT_SIZE 256
+
+typedef struct _CDDequeArray {
+	struct _CDDequeArray* previous;
+
+	size_t    size;
+	CDPointer item[];
+} CDDequeArray;
+
+/**
+ * The Deque class.
+ *
+ * A Chase-Lev work-stealing deque: the owner thread pushes and takes at the
+ * bottom without locking, any other thread can steal from the top.
+ */
+typedef struct _CDDeque {
+	volatile int64_t top;
+	volatile int64_t bottom;
+
+	CDDequeArray* volatile array;
+} CDDeque;
+
+/**
+ * Create a Deque object
+ *
+ * @return The deque object
+ */
+CDDeque* CD_CreateDeque (void);
+
+/**
+ * Destroy a Deque object, the remaining items are lost
+ */
+void CD_DestroyDeque (CDDeque* self);
+
+/**
+ * Push a value at the bottom of the Deque, owner only.
+ *
+ * @param data The value to push
+ */
+void CD_DequePush (CDDeque* self, CDPointer data);
+
+/**
+ * Take a value from the bottom of the Deque, owner only.
+ *
+ * @return The value or CDNull if the Deque is empty
+ */
+CDPointer CD_DequeTake (CDDeque* self);
+
+/**
+ * Steal a value from the top of the Deque, callable from any thread.
+ *
+ * @return The value or CDNull if the Deque is empty or the race was lost
+ */
+CDPointer CD_DequeSteal (CDDeque* self);
+
+/**
+ * Get the approximate number of values in the Deque
+ *
+ * @return The number of values
+ */
+size_t CD_DequeLength (CDDeque* self);
+
+#endif
@@ -35,7 +35,8 @@ typedef enum _CDJobType {
 	CDClientProcessJob,
 	CDClientDisconnectJob,
 
-	CDCustomJob
+	CDCustomJob,
+	CDStrandJob
 } CDJobType;
 
 #define CD_JOB_IS_CUSTOM(job) ( \
@@ -55,9 +56,14 @@ typedef struct _CDCustomJobData {
 	CDPointer           data;
 } CDCustomJobData;
 
+/**
+ * The packets a Client sent in a row, processed in order by a single job.
+ */
 typedef struct _CDClientProcessJobData {
 	CDClient* client;
-	void*     packet;
+
+	size_t length;
+	void*  packet[];
 } CDClientProcessJobData;
 
 typedef struct _CDJob {
@@ -65,6 +71,8 @@ typedef struct _CDJob {
 	CDPointer data;
 
 	bool external;
+
+	struct _CDJob* next;
 } CDJob;
 
 CDJob* CD_CreateJob (CDJobType type, CDPointer data);
@@ -79,6 +87,6 @@ CDPointer CD_DestroyJobKeepData (CDJob* job);
 
 CDCustomJobData* CD_CreateCustomJob (CDCustomJobCallback callback, CDPointer data);
 
-CDClientProcessJobData* CD_CreateClientProcessJob (CDClient* client, void* packet);
+CDClientProcessJobData* CD_CreateClientProcessJob (CDClient* client, void** packets, size_t length);
 
 #endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_PACKETBATCH_H
+#define CRAFTD_PACKETBATCH_H
+
+#include <craftd/common.h>
+
+struct _CDClient;
+
+/**
+ * A PacketBatch collects many encoded packets into a single Buffer so they can
+ * be queued on a Client with one operation instead of one per packet.
+ */
+typedef struct _CDPacketBatch {
+	CDBuffer* buffer;
+	size_t    length;
+} CDPacketBatch;
+
+/**
+ * Create an empty PacketBatch object
+ *
+ * @return The instantiated PacketBatch object
+ */
+CDPacketBatch* CD_CreatePacketBatch (void);
+
+/**
+ * Destroy a PacketBatch object, pending packets are dropped
+ */
+void CD_DestroyPacketBatch (CDPacketBatch* self);
+
+/**
+ * Append an encoded packet to the batch, the data is moved out of the given Buffer
+ *
+ * @param data The encoded packet
+ */
+void CD_PacketBatchAdd (CDPacketBatch* self, CDBuffer* data);
+
+/**
+ * Append a copy of an encoded packet to the batch, the given Buffer is left
+ * as it is so the same packet can go in many batches
+ *
+ * @param data The encoded packet
+ */
+void CD_PacketBatchAddCopy (CDPacketBatch* self, CDBuffer* data);
+
+/**
+ * Get the number of packets in the batch
+ */
+size_t CD_PacketBatchLength (CDPacketBatch* self);
+
+/**
+ * Get the size in bytes of the batch
+ */
+size_t CD_PacketBatchSize (CDPacketBatch* self);
+
+/**
+ * Queue every packet of the batch on a Client, the batch is left empty and can be reused
+ *
+ * @param client The Client to send the packets to
+ */
+void CD_PacketBatchSend (CDPacketBatch* self, struct _CDClient* client);
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_REACTOR_H
+#define CRAFTD_REACTOR_H
+
+#include <craftd/common.h>
+
+struct _CDServer;
+
+/**
+ * A Reactor is an event base with its own thread and its own listening socket.
+ *
+ * Every Client is pinned to the Reactor that accepted it, all its callbacks and
+ * its final destruction happen on that Reactor's thread.
+ */
+typedef struct _CDReactor {
+	struct _CDServer* server;
+
+	int       id;
+	pthread_t thread;
+
+	struct event_base* base;
+	struct event*      listener;
+	evutil_socket_t    socket;
+
+	/// Keeps the loop waiting when the Reactor has no listener nor Client yet
+	struct event* idle;
+
+	CDList* disconnecting;
+} CDReactor;
+
+/**
+ * Create a Reactor object with a fresh event base
+ *
+ * @return The instantiated object or NULL if the event base couldn't be created
+ */
+CDReactor* CD_CreateReactor (struct _CDServer* server);
+
+/**
+ * Destroy a Reactor object, the thread has to be stopped already
+ */
+void CD_DestroyReactor (CDReactor* self);
+
+/**
+ * Main thread function, loops until the Server stops running, cleaning the
+ * disconnected Clients at each loop exit.
+ */
+bool CD_RunReactor (CDReactor* self);
+
+/**
+ * Make the Reactor loop exit so disconnected Clients get cleaned.
+ *
+ * @param now Break the loop without running the pending callbacks
+ */
+void CD_ReactorFlush (CDReactor* self, bool now);
+
+/**
+ * Destroy the Clients that were disconnected on this Reactor.
+ *
+ * Must be called from the Reactor thread or when its loop is not running.
+ */
+void CD_ReactorCleanDisconnects (CDReactor* self);
+
+#endif
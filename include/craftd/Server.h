@@ -34,6 +34,7 @@
 #include <craftd/Plugins.h>
 #include <craftd/ScriptingEngines.h>
 #include <craftd/Client.h>
+#include <craftd/Reactor.h>
 
 /**
  * Server class.
@@ -50,22 +51,27 @@ typedef struct _CDServer {
 	CDLogger            logger;
 
 	CDList* clients;
-	CDList* disconnecting;
+
+	struct {
+		size_t      length;
+		CDReactor** item;
+
+		bool   distribute;
+		size_t last;
+	} reactors;
 
 	bool running;
 
 	uint16_t time;
 
 	struct {
+		// the first Reactor's base, signals and plugins live here
 		struct event_base* base;
-		struct event*      listener;
 
 		CDHash* callbacks;
 		CDHash* provided;
 	} event;
 
-	evutil_socket_t socket;
-
 	CD_DEFINE_DYNAMIC;
 	CD_DEFINE_ERROR;
 } CDServer;
@@ -100,8 +106,14 @@ bool CD_RunServer (CDServer* self);
 
 bool CD_StopServer (CDServer* self);
 
+/**
+ * Make every Reactor loop exit so disconnected Clients get cleaned.
+ */
 void CD_ServerFlush (CDServer* self, bool now);
 
+/**
+ * Destroy the disconnected Clients of every Reactor, only safe when the Reactors are not looping.
+ */
 void CD_ServerCleanDisconnects (CDServer* self);
 
 void CD_ReadFromClient (CDClient* client);
@@ -40,6 +40,9 @@ typedef struct _CDString {
 	CDRawString raw;
 	size_t      length;
 	bool        external;
+
+	// set by protocols once the content is known to be valid for them, any change resets it
+	bool        clean;
 } CDString;
 
 /**
@@ -28,6 +28,7 @@
 
 #include <craftd/common.h>
 #include <craftd/Job.h>
+#include <craftd/Deque.h>
 
 struct _CDWorkers;
 struct _CDServer;
@@ -40,6 +41,9 @@ typedef struct _CDWorker {
 
 	struct _CDWorkers* workers;
 
+	CDDeque* jobs;
+	uint32_t seed;
+
 	CDJob* job;
 	bool   working;
 	bool   stopped;
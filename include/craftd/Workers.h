@@ -31,6 +31,12 @@
 
 #define CD_THREAD_STACK 8388608
 
+/* Max number of jobs a worker moves from the shared queue to its own deque at once */
+#define CD_WORKERS_BATCH 32
+
+/* Max number of jobs a Strand runs before letting the others have a go */
+#define CD_STRAND_BUDGET 16
+
 struct _CDServer;
 
 typedef struct _CDWorkers {
@@ -41,16 +47,46 @@ typedef struct _CDWorkers {
 	size_t     length;
 	CDWorker** item;
 
-	CDList* jobs;
+	// jobs added from threads that aren't workers
+	struct {
+		CDJob* head;
+		CDJob* tail;
 
+		volatile size_t length;
+	} queue;
+
+	struct {
+		volatile uint32_t epoch;
+		volatile int      waiting;
+	} parking;
+
+	pthread_key_t  current;
 	pthread_attr_t attributes;
 
 	struct {
-		pthread_cond_t  condition;
-		pthread_mutex_t mutex;
+		pthread_cond_t     condition;
+		pthread_mutex_t    mutex;
+		pthread_spinlock_t queue;
+		pthread_rwlock_t   workers;
 	} lock;
 } CDWorkers;
 
+/**
+ * The Strand class.
+ *
+ * A FIFO of Jobs that runs on at most one worker at a time, so its Jobs keep
+ * their order while different Strands run in parallel.
+ */
+typedef struct _CDStrand {
+	CDJob* head;
+	CDJob* tail;
+
+	bool scheduled;
+	bool closed;
+
+	pthread_spinlock_t lock;
+} CDStrand;
+
 CDWorkers* CD_CreateWorkers (struct _CDServer* server);
 
 void CD_DestroyWorkers (CDWorkers* self);
@@ -69,8 +105,68 @@ CDWorkers* CD_AppendWorker (CDWorkers* self, CDWorker* worker);
 
 bool CD_HasJobs (CDWorkers* self);
 
+/**
+ * Add a Job, from a worker it goes on its own deque, otherwise on the shared queue.
+ */
 void CD_AddJob (CDWorkers* self, CDJob* job);
 
+/**
+ * Add many Jobs at once, taking the shared queue lock and waking workers only once.
+ *
+ * @param jobs The Jobs to add, they're run in order when possible
+ * @param length The number of Jobs
+ */
+void CD_AddJobs (CDWorkers* self, CDJob** jobs, size_t length);
+
+/**
+ * Add a Job at the end of the shared queue, after every Job already waiting there.
+ */
+void CD_DeferJob (CDWorkers* self, CDJob* job);
+
+/**
+ * Get the next Job without blocking, from the current worker's deque, the shared
+ * queue or another worker's deque.
+ *
+ * @return The Job or NULL if none was found
+ */
 CDJob* CD_NextJob (CDWorkers* self);
 
+/**
+ * Get the next Job for the given worker, parking it until one is available.
+ *
+ * @return The Job or NULL if the worker has been stopped
+ */
+CDJob* CD_WaitJob (CDWorkers* self, CDWorker* worker);
+
+CDStrand* CD_CreateStrand (void);
+
+/**
+ * Destroy a Strand and the Jobs still queued on it, it must not be running.
+ */
+void CD_DestroyStrand (CDStrand* self);
+
+/**
+ * Queue a Job on a Strand, scheduling the Strand if it was idle.
+ *
+ * @return false if the Strand is closed, the Job is destroyed in that case
+ */
+bool CD_StrandAddJob (CDWorkers* self, CDStrand* strand, CDJob* job);
+
+/**
+ * Queue the last Job of a Strand, any Job added after it is refused.
+ *
+ * @return false if the Strand was already closed, the Job is destroyed in that case
+ */
+bool CD_StrandCloseWithJob (CDWorkers* self, CDStrand* strand, CDJob* job);
+
+/**
+ * Get the next Job of a running Strand, marking it idle when there's none.
+ *
+ * @param last Set to true when the Job is the one the Strand was closed with,
+ *             the Strand must not be touched after running it
+ *
+ * @return The Job or NULL if the Strand is empty
+ */
+CDJob* CD_StrandNextJob (CDStrand* self, bool* last);
+
 #endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_ATOMIC_H
+#define CRAFTD_ATOMIC_H
+
+/**
+ * Thin wrappers around the compiler atomic builtins.
+ *
+ * Every operation is sequentially consistent, the newer __atomic builtins are
+ * used when available and the __sync ones otherwise.
+ */
+
+#if defined(__ATOMIC_SEQ_CST)
+#	define CD_AtomicGet(pointer) \
+		__atomic_load_n(pointer, __ATOMIC_SEQ_CST)
+
+#	define CD_AtomicSet(pointer, value) \
+		__atomic_store_n(pointer, value, __ATOMIC_SEQ_CST)
+
+#	define CD_AtomicSwap(pointer, value) \
+		__atomic_exchange_n(pointer, value, __ATOMIC_SEQ_CST)
+
+#	define CD_AtomicFence() \
+		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#	define CD_AtomicGet(pointer) \
+		__sync_fetch_and_add(pointer, 0)
+
+#	define CD_AtomicSet(pointer, value) \
+		do { __sync_synchronize(); *(pointer) = (value); __sync_synchronize(); } while (0)
+
+#	define CD_AtomicSwap(pointer, value) \
+		(__sync_synchronize(), __sync_lock_test_and_set(pointer, value))
+
+#	define CD_AtomicFence() \
+		__sync_synchronize()
+#endif
+
+#define CD_AtomicCompareAndSwap(pointer, old, value) \
+	__sync_bool_compare_and_swap(pointer, old, value)
+
+#define CD_AtomicAdd(pointer, value) \
+	__sync_add_and_fetch(pointer, value)
+
+#define CD_AtomicSub(pointer, value) \
+	__sync_sub_and_fetch(pointer, value)
+
+#define CD_AtomicIncrement(pointer) \
+	CD_AtomicAdd(pointer, 1)
+
+#define CD_AtomicDecrement(pointer) \
+	CD_AtomicSub(pointer, 1)
+
+#endif
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdarg.h>
 #include <string.h>
@@ -79,6 +80,7 @@
 #define CDNull (0)
 
 #include <craftd/lock.h>
+#include <craftd/atomic.h>
 #include <craftd/utils.h>
 #include <craftd/memory.h>
 #include <craftd/extras.h>
@@ -130,4 +130,91 @@ CD_realloc (void* pointer, size_t size)
 	return newPointer;
 }
 
+/// Bytes a slab pool asks the system for at once, a huge page on x86
+#define CD_SLAB_BLOCK_SIZE (2 * 1024 * 1024)
+
+/// Free slabs a thread keeps before giving them back to the pool
+#define CD_SLAB_CACHE_LENGTH 4
+
+/**
+ * A free slab, the link lives in the slab itself
+ */
+typedef struct _CDSlab {
+	struct _CDSlab* next;
+} CDSlab;
+
+/**
+ * The free slabs of a pool a thread keeps for itself, used without locking
+ */
+typedef struct _CDSlabCache {
+	struct _CDSlabPool* pool;
+
+	CDSlab* head;
+	size_t  length;
+
+	struct _CDSlabCache* previous;
+	struct _CDSlabCache* next;
+} CDSlabCache;
+
+/**
+ * A pool of fixed size objects too big to leave to malloc, like chunks and chunk
+ * sized scratch buffers. Slabs are carved out of big blocks that go back to the
+ * system only when the pool is destroyed.
+ */
+typedef struct _CDSlabPool {
+	size_t size;
+	bool   huge;
+
+	pthread_key_t cache;
+
+	/// Slabs given back by threads with a full cache, or by exiting threads
+	CDSlab* free;
+
+	/// The part of the last block no slab was carved from yet
+	struct {
+		uint8_t* next;
+		uint8_t* end;
+	} fresh;
+
+	struct {
+		void** item;
+		size_t length;
+	} blocks;
+
+	CDSlabCache* caches;
+
+	/// Slabs in use, and free slabs kept in the pool and the thread caches
+	struct {
+		size_t live;
+		size_t cached;
+	} stats;
+
+	pthread_mutex_t lock;
+} CDSlabPool;
+
+/**
+ * Create a pool of slabs of the given size
+ *
+ * @param size The size of each slab
+ * @param huge Back the blocks with transparent huge pages where available
+ */
+CDSlabPool* CD_CreateSlabPool (size_t size, bool huge);
+
+/**
+ * Free every block of the pool, slabs still in use included
+ */
+void CD_DestroySlabPool (CDSlabPool* self);
+
+/**
+ * Take a slab from the calling thread's cache, or from the pool when it's empty
+ *
+ * @return An uninitialized slab of the pool's size
+ */
+void* CD_SlabAlloc (CDSlabPool* self);
+
+/**
+ * Give a slab back to the calling thread's cache, or to the pool when it's full
+ */
+void CD_SlabFree (CDSlabPool* self, void* pointer);
+
 #endif
@@ -29,6 +29,8 @@
 #include <craftd/protocols/survival/minecraft.h>
 
 #include <craftd/protocols/survival/World.h>
+#include <craftd/protocols/survival/Section.h>
+#include <craftd/protocols/survival/ChunkView.h>
 #include <craftd/protocols/survival/Player.h>
 #include <craftd/protocols/survival/Packet.h>
 #include <craftd/protocols/survival/PacketLength.h>
@@ -47,6 +47,8 @@
  *     U: SVString (UCS-2)
  *     M: SVMetadata
  *
+ * Consecutive fixed size fields are encoded into a single reserved span.
+ *
  * @param format The format string
  */
 void SV_BufferAddFormat (CDBuffer* self, const char* format, ...);
@@ -91,6 +93,8 @@ void SV_BufferAddMetadata (CDBuffer* self, SVMetadata* data);
  *     U: SVString (UCS-2)
  *     M: SVMetadata
  *
+ * Consecutive fixed size fields are removed with a single copy.
+ *
  * @param format The format string
  */
 void SV_BufferRemoveFormat (CDBuffer* self, const char* format, ...);
@@ -115,4 +119,28 @@ SVString SV_BufferRemoveString16 (CDBuffer* self);
 
 SVMetadata* SV_BufferRemoveMetadata (CDBuffer* self);
 
+/**
+ * Transcode UTF-8 into big endian UCS-2, characters outside the BMP and malformed
+ * sequences become U+FFFD.
+ *
+ * The output must have room for 2 bytes per input byte.
+ *
+ * @return The number of UCS-2 characters written
+ */
+size_t SV_UTF8ToUCS2 (const uint8_t* input, size_t size, uint8_t* output);
+
+/**
+ * The number of UCS-2 characters SV_UTF8ToUCS2 writes for the input
+ */
+size_t SV_UTF8ToUCS2Length (const uint8_t* input, size_t size);
+
+/**
+ * Transcode big endian UCS-2 into UTF-8, U+FFFD becomes ? and U+FFFF is dropped.
+ *
+ * The output must have room for 3 bytes per input character.
+ *
+ * @return The number of bytes written
+ */
+size_t SV_UCS2ToUTF8 (const uint8_t* input, size_t length, uint8_t* output);
+
 #endif
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_SURVIVAL_CHUNKVIEW_H
+#define CRAFTD_SURVIVAL_CHUNKVIEW_H
+
+#include <craftd/protocols/survival/minecraft.h>
+
+/* Side of the window a view tracks around its center, the radius and margin have to fit in half of it */
+#define SV_CHUNK_VIEW_SIZE 32
+
+struct _SVChunkView;
+
+typedef void (*SVChunkViewCallback) (struct _SVChunkView* view, SVChunkPosition position, CDPointer context);
+
+/**
+ * The chunks a player has loaded around it, one bit per chunk in a window
+ * centered on the player. Row i holds the chunks at x = center.x + i - 16,
+ * bit j the ones at z = center.z + j - 16.
+ *
+ * Loaded chunks stay loaded up to margin chunks past the radius, further
+ * than that they're unloaded once they've been out for grace seconds.
+ */
+typedef struct _SVChunkView {
+	SVChunkPosition center;
+	int             radius;
+	int             margin;
+	time_t          grace;
+
+	uint32_t loaded[SV_CHUNK_VIEW_SIZE];
+
+	/// Loaded chunks out of the margin waiting for the grace period to end
+	uint32_t leaving[SV_CHUNK_VIEW_SIZE];
+
+	/// When the leaving chunks left, by chunk coordinates modulo the window size
+	time_t since[SV_CHUNK_VIEW_SIZE][SV_CHUNK_VIEW_SIZE];
+
+	/// The chunks in the radius and in the radius plus the margin, relative to the center
+	uint32_t area[SV_CHUNK_VIEW_SIZE];
+	uint32_t keep[SV_CHUNK_VIEW_SIZE];
+
+	/// Offsets of the chunks in the radius, nearest first
+	struct {
+		SVChunkPosition* item;
+		size_t           length;
+	} order;
+
+	struct {
+		/// Chunks that came back in the radius while still loaded
+		uint64_t kept;
+	} stats;
+} SVChunkView;
+
+/**
+ * Create an empty view centered on (0, 0)
+ *
+ * @param margin How many chunks past the radius loaded chunks are kept
+ * @param grace  How many seconds chunks past the margin are kept, 0 to unload them right away
+ */
+SVChunkView* SV_CreateChunkView (int radius, int margin, time_t grace);
+
+void SV_DestroyChunkView (SVChunkView* self);
+
+/**
+ * Check if a chunk is marked as loaded, chunks out of the window never are
+ */
+bool SV_ChunkViewHas (SVChunkView* self, SVChunkPosition position);
+
+/**
+ * Mark a chunk as loaded or not, chunks out of the window are ignored
+ */
+void SV_ChunkViewSet (SVChunkView* self, SVChunkPosition position, bool loaded);
+
+/**
+ * Move the view to a new center.
+ *
+ * Loaded chunks that end up out of the window, or past the margin when there's
+ * no grace period, are unmarked and passed to unload. Then every chunk in the
+ * radius that isn't loaded is passed to load, nearest first. Marking those as
+ * loaded is up to the caller.
+ *
+ * @param now The current time, to start the grace period of chunks leaving the margin
+ */
+void SV_ChunkViewMove (SVChunkView* self, SVChunkPosition center, time_t now, SVChunkViewCallback unload, SVChunkViewCallback load, CDPointer context);
+
+/**
+ * Unmark and pass to unload the chunks that have been past the margin for
+ * the whole grace period.
+ */
+void SV_ChunkViewExpire (SVChunkView* self, time_t now, SVChunkViewCallback unload, CDPointer context);
+
+/**
+ * Unmark every loaded chunk, passing each of them to unload
+ */
+void SV_ChunkViewClear (SVChunkView* self, SVChunkViewCallback unload, CDPointer context);
+
+#endif
@@ -27,6 +27,8 @@
 #define CRAFTD_SURVIVAL_PACKET_H
 
 #include <craftd/protocols/survival/common.h>
+#include <craftd/protocols/survival/PacketSchema.h>
+#include <craftd/PacketBatch.h>
 
 #define CRAFTD_PROTOCOL_VERSION (19)
 
@@ -36,73 +38,15 @@ typedef enum _SVPacketChain {
 	SVPing
 } SVPacketChain;
 
+#define SV_PACKET_TYPE(type, id, length, description) \
+	type = id,
+
 typedef enum _SVPacketType {
-    SVKeepAlive               = 0x00,
-    SVLogin                   = 0x01,
-    SVHandshake               = 0x02,
-    SVChat                    = 0x03,
-    SVTimeUpdate              = 0x04,
-    SVEntityEquipment         = 0x05,
-    SVSpawnPosition           = 0x06,
-    SVUseEntity               = 0x07,
-    SVUpdateHealth            = 0x08,
-    SVRespawn                 = 0x09,
-    SVOnGround                = 0x0A,
-    SVPlayerPosition          = 0x0B,
-    SVPlayerLook              = 0x0C,
-    SVPlayerMoveLook          = 0x0D,
-    SVPlayerDigging           = 0x0E,
-    SVPlayerBlockPlacement    = 0x0F,
-    SVHoldChange              = 0x10,
-    SVUseBed                  = 0x11,
-    SVAnimation               = 0x12,
-    SVEntityAction            = 0x13,
-    SVNamedEntitySpawn        = 0x14,
-    SVPickupSpawn             = 0x15,
-    SVCollectItem             = 0x16,
-    SVSpawnObject             = 0x17,
-    SVSpawnMob                = 0x18,
-    SVPainting                = 0x19,
-    SVExperienceOrb           = 0x1A,
-    SVStanceUpdate            = 0x1B,
-    SVEntityVelocity          = 0x1C,
-    SVEntityDestroy           = 0x1D,
-    SVEntityCreate            = 0x1E,
-    SVEntityRelativeMove      = 0x1F,
-    SVEntityLook              = 0x20,
-    SVEntityLookMove          = 0x21,
-    SVEntityTeleport          = 0x22,
-    SVEntityStatus            = 0x26,
-    SVEntityAttach            = 0x27,
-    SVEntityMetadata          = 0x28,
-    SVEntityEffect            = 0x29,
-    SVRemoveEntityEffect      = 0x2A,
-    SVExperience              = 0x2B,
-    SVPreChunk                = 0x32,
-    SVMapChunk                = 0x33,
-    SVMultiBlockChange        = 0x34,
-    SVBlockChange             = 0x35,
-    SVPlayNoteBlock           = 0x36, //TODO: Needs to be changed to SVBlockAction
-    SVExplosion               = 0x3C,
-    SVSoundEffect             = 0x3D,
-    SVState                   = 0x46,
-    SVThunderbolt             = 0x47,
-    SVOpenWindow              = 0x64,
-    SVCloseWindow             = 0x65,
-    SVWindowClick             = 0x66,
-    SVSetSlot                 = 0x67,
-    SVWindowItems             = 0x68,
-    SVUpdateProgressBar       = 0x69,
-    SVTransaction             = 0x6A,
-    SVCreativeInventoryAction = 0x6B,
-    SVUpdateSign              = 0x82,
-    SVItemData                = 0x83,
-    SVIncrementStatistic      = 0xC8,
-    SVPlayerListItem          = 0xC9,
-    SVListPing                = 0xFE,
-    SVDisconnect              = 0xFF
+	SV_PACKET_SCHEMA(SV_PACKET_TYPE)
 } SVPacketType;
 
+#undef SV_PACKET_TYPE
+
 /*
  * Commonly used enums
  */
@@ -939,7 +883,7 @@ SVPacket* SV_PacketFromBuffers (CDBuffers* buffers, bool isResponse);
 void SV_DestroyPacket (SVPacket* self);
 
 /**
- * Destroy Packet data
+ * Destroy the strings, metadata and arrays the Packet data points to, as described by SVPacketFormats
  */
 void SV_DestroyPacketData (SVPacket* self);
 
@@ -957,8 +901,24 @@ CDPointer SV_GetPacketDataFromBuffer (SVPacket* self, CDBuffer* input);
 /**
  * Generate a Buffer version of the packet to send through the net
  *
- * @return The raw packet data
+ * The size is computed from SVPacketFormats first and the Packet is written in a single span.
+ *
+ * @return The raw packet data, NULL if the packet can't be encoded
  */
 CDBuffer* SV_PacketToBuffer (SVPacket* self);
 
+/**
+ * Encode the packet and append it to a PacketBatch
+ *
+ * @param batch The PacketBatch to append to
+ */
+void SV_PacketBatchAdd (CDPacketBatch* batch, SVPacket* self);
+
+/**
+ * Generate a SharedBuffer version of the packet to send to many clients
+ *
+ * @return The raw packet data, NULL if the packet can't be encoded
+ */
+CDSharedBuffer* SV_PacketToSharedBuffer (SVPacket* self);
+
 #endif
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_SURVIVAL_PACKETSCHEMA_H
+#define CRAFTD_SURVIVAL_PACKETSCHEMA_H
+
+#include <craftd/common.h>
+
+/**
+ * Every Packet of the protocol, declared once.
+ *
+ * _(type, id, length, description)
+ *
+ * The length is the size of the fixed part of the Packet including the id byte,
+ * the layout of every chain is described by SVPacketFormats.
+ *
+ * The Packet type enum, SVPacketLength and SVPacketName are generated from it.
+ */
+#define SV_PACKET_SCHEMA(_)                                               \
+	_(SVKeepAlive,               0x00, 5,  "Keep Alive")                  \
+	_(SVLogin,                   0x01, 23, "Login")                       \
+	_(SVHandshake,               0x02, 3,  "Handshake")                   \
+	_(SVChat,                    0x03, 3,  "Chat")                        \
+	_(SVTimeUpdate,              0x04, 9,  "Time Update")                 \
+	_(SVEntityEquipment,         0x05, 11, "Entity Equipment")            \
+	_(SVSpawnPosition,           0x06, 13, "Spawn Position")              \
+	_(SVUseEntity,               0x07, 10, "Use Entity")                  \
+	_(SVUpdateHealth,            0x08, 9,  "Update Health")               \
+	_(SVRespawn,                 0x09, 14, "Respawn")                     \
+	_(SVOnGround,                0x0A, 2,  "Player")                      \
+	_(SVPlayerPosition,          0x0B, 34, "Player Position")             \
+	_(SVPlayerLook,              0x0C, 10, "Player Look")                 \
+	_(SVPlayerMoveLook,          0x0D, 42, "Player Position & Look")      \
+	_(SVPlayerDigging,           0x0E, 12, "Player Digging")              \
+	_(SVPlayerBlockPlacement,    0x0F, 13, "Player Block Placement")      \
+	_(SVHoldChange,              0x10, 3,  "Holding Change")              \
+	_(SVUseBed,                  0x11, 15, "Use Bed")                     \
+	_(SVAnimation,               0x12, 6,  "Animation")                   \
+	_(SVEntityAction,            0x13, 6,  "Entity Action")               \
+	_(SVNamedEntitySpawn,        0x14, 23, "Named Entity Spawn")          \
+	_(SVPickupSpawn,             0x15, 25, "Pickup Spawn")                \
+	_(SVCollectItem,             0x16, 9,  "Collect Item")                \
+	_(SVSpawnObject,             0x17, 22, "Add Object/Vehicle")          \
+	_(SVSpawnMob,                0x18, 21, "Mob Spawn")                   \
+	_(SVPainting,                0x19, 23, "Painting")                    \
+	_(SVExperienceOrb,           0x1A, 19, "Experience Orb")              \
+	_(SVStanceUpdate,            0x1B, 19, "Stance Update (?)")           \
+	_(SVEntityVelocity,          0x1C, 11, "Entity Velocity")             \
+	_(SVEntityDestroy,           0x1D, 5,  "Destroy Entity")              \
+	_(SVEntityCreate,            0x1E, 5,  "Entity")                      \
+	_(SVEntityRelativeMove,      0x1F, 8,  "Entity Relative Move")        \
+	_(SVEntityLook,              0x20, 7,  "Entity Look")                 \
+	_(SVEntityLookMove,          0x21, 10, "Entity Look & Relative Move") \
+	_(SVEntityTeleport,          0x22, 19, "Entity Teleport")             \
+	_(SVEntityStatus,            0x26, 6,  "Entity Status")               \
+	_(SVEntityAttach,            0x27, 9,  "Attach Entity")               \
+	_(SVEntityMetadata,          0x28, 6,  "Entity Metadata")             \
+	_(SVEntityEffect,            0x29, 9,  "Entity Effect")               \
+	_(SVRemoveEntityEffect,      0x2A, 6,  "Remove Entity Effect")        \
+	_(SVExperience,              0x2B, 5,  "Experience")                  \
+	_(SVPreChunk,                0x32, 10, "Pre-Chunk")                   \
+	_(SVMapChunk,                0x33, 18, "Map Chunk")                   \
+	_(SVMultiBlockChange,        0x34, 11, "Multi Block Change")          \
+	_(SVBlockChange,             0x35, 12, "Block Change")                \
+	_(SVPlayNoteBlock,           0x36, 13, "Block Action")                \
+	_(SVExplosion,               0x3C, 33, "Explosion")                   \
+	_(SVSoundEffect,             0x3D, 18, "Sound Effect")                \
+	_(SVState,                   0x46, 3,  "New/Invalid State")           \
+	_(SVThunderbolt,             0x47, 18, "Thunderbolt")                 \
+	_(SVOpenWindow,              0x64, 6,  "Open Window")                 \
+	_(SVCloseWindow,             0x65, 2,  "Close Window")                \
+	_(SVWindowClick,             0x66, 10, "Window Click")                \
+	_(SVSetSlot,                 0x67, 6,  "Set Slot")                    \
+	_(SVWindowItems,             0x68, 4,  "Window Items")                \
+	_(SVUpdateProgressBar,       0x69, 6,  "Update Progress Bar")         \
+	_(SVTransaction,             0x6A, 5,  "Transaction")                 \
+	_(SVCreativeInventoryAction, 0x6B, 9,  "Creative Inventory Action")   \
+	_(SVUpdateSign,              0x82, 19, "Update Sign")                 \
+	_(SVItemData,                0x83, 6,  "Item Data")                   \
+	_(SVIncrementStatistic,      0xC8, 6,  "Increment Statistic")         \
+	_(SVPlayerListItem,          0xC9, 6,  "Player List Item")            \
+	_(SVListPing,                0xFE, 1,  "Server List Ping")            \
+	_(SVDisconnect,              0xFF, 3,  "Disconnect/Kick")
+
+/**
+ * Wire type of a Packet field.
+ */
+typedef enum _SVFieldType {
+	SVFieldByte,
+	SVFieldShort,
+	SVFieldInteger,
+	SVFieldLong,
+	SVFieldFloat,
+	SVFieldDouble,
+	SVFieldBoolean,
+	SVFieldSize,     // a byte holding the value minus one
+	SVFieldString,   // UTF-8 with a short size prefix
+	SVFieldString16, // UCS-2 with a short length prefix
+	SVFieldMetadata,
+	SVFieldItem,     // a short id, then a byte count and a short damage unless the id is -1
+	SVFieldArray,    // raw elements already in wire order, as many as the last counter says
+	SVFieldItems     // Items, as many as the last counter says
+} SVFieldType;
+
+/* The field is the number of elements of the arrays after it, a byte counter is unsigned */
+#define SV_FIELD_COUNT (1 << 0)
+
+/* The guarded fields after it are only there if the field is greater than 0 */
+#define SV_FIELD_CONDITION (1 << 1)
+
+#define SV_FIELD_GUARDED (1 << 2)
+
+/**
+ * A field of a Packet, in wire order.
+ *
+ * The size is the one of the struct member, so narrower or wider members than
+ * the wire type are converted, for arrays it's the size of an element.
+ */
+typedef struct _SVPacketField {
+	SVFieldType type;
+	uint8_t     flags;
+	uint16_t    size;
+	uint16_t    offset;
+} SVPacketField;
+
+/**
+ * The layout of a Packet in a chain, size is 0 when the chain doesn't have the Packet.
+ */
+typedef struct _SVPacketFormat {
+	const SVPacketField* field;
+	size_t               length;
+	size_t               size;
+} SVPacketFormat;
+
+/* Size of the fixed part of every Packet, 0 for unknown ones */
+extern const size_t SVPacketLength[256];
+
+/* Name of every Packet, NULL for unknown ones */
+extern const char* SVPacketName[256];
+
+/* Layout of every Packet, indexed by SVPacketChain and type */
+extern const SVPacketFormat SVPacketFormats[3][256];
+
+/**
+ * Size of the field on the wire, 0 when it depends on the data
+ */
+static inline
+size_t
+SV_PacketFieldSize (const SVPacketField* field)
+{
+	switch (field->type) {
+		case SVFieldByte:
+		case SVFieldBoolean:
+		case SVFieldSize:    return 1;
+		case SVFieldShort:   return 2;
+		case SVFieldInteger:
+		case SVFieldFloat:   return 4;
+		case SVFieldLong:
+		case SVFieldDouble:  return 8;
+
+		default: return 0;
+	}
+}
+
+#endif
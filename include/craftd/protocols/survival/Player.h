@@ -102,4 +102,13 @@ void SV_PlayerSendPacketAndClean (SVPlayer* self, SVPacket* packet);
  */
 void SV_PlayerSendPacketAndCleanData (SVPlayer* self, SVPacket* packet);
 
+/**
+ * Send a Packet to a Map of Players, the packet is encoded only once
+ *
+ * @param players The Players to send the packet to, by entity id
+ * @param packet The Packet object to send
+ * @param except A Player to skip, can be NULL
+ */
+void SV_PlayersSendPacket (CDMap* players, SVPacket* packet, SVPlayer* except);
+
 #endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_SURVIVAL_SECTION_H
+#define CRAFTD_SURVIVAL_SECTION_H
+
+#include <craftd/protocols/survival/minecraft.h>
+
+/* Side of a section, a chunk is a column of sections */
+#define SV_SECTION_SIZE 16
+
+#define SV_SECTION_BLOCKS (SV_SECTION_SIZE * SV_SECTION_SIZE * SV_SECTION_SIZE)
+
+#define SV_CHUNK_SECTIONS (128 / SV_SECTION_SIZE)
+
+/**
+ * The values of the blocks in a section. A section where every block has
+ * the same value only stores that value, otherwise every block has an index
+ * in the palette packed in bits bits.
+ */
+typedef struct _SVPalette {
+	/// Bits per index, 0 when every block has the value
+	uint8_t  bits;
+	uint16_t value;
+
+	uint16_t  length;
+	uint16_t* item;
+	uint64_t* data;
+} SVPalette;
+
+/**
+ * A 16x16x16 cube of a chunk, blocks are stored as type << 4 | metadata
+ */
+typedef struct _SVSection {
+	SVPalette blocks;
+	SVPalette blockLight;
+	SVPalette skyLight;
+} SVSection;
+
+/**
+ * The resident form of a chunk, SVChunk only exists while a chunk is
+ * loaded, saved or sent.
+ */
+typedef struct _SVPackedChunk {
+	SVChunkPosition position;
+
+	uint8_t heightMap[256];
+
+	SVSection sections[SV_CHUNK_SECTIONS];
+} SVPackedChunk;
+
+/**
+ * Pack a chunk in sections, uniform sections take no room for their blocks
+ */
+SVPackedChunk* SV_CreatePackedChunk (SVChunk* chunk);
+
+void SV_DestroyPackedChunk (SVPackedChunk* self);
+
+/**
+ * Move the content of another packed chunk into this one, which keeps its
+ * address. The other one is destroyed.
+ */
+void SV_PackedChunkReplace (SVPackedChunk* self, SVPackedChunk* other);
+
+/**
+ * Expand a packed chunk to the arrays the protocol and persistence use
+ */
+void SV_PackedChunkExpand (SVPackedChunk* self, SVChunk* result);
+
+/**
+ * Get a block, only the position in the chunk is used
+ */
+void SV_PackedChunkGetBlock (SVPackedChunk* self, SVBlockPosition position, uint8_t* type, uint8_t* metadata);
+
+/**
+ * Change a block, only the position in the chunk is used
+ *
+ * @return true if the block changed
+ */
+bool SV_PackedChunkSetBlock (SVPackedChunk* self, SVBlockPosition position, uint8_t type, uint8_t metadata);
+
+/**
+ * Bytes the packed chunk takes in memory
+ */
+size_t SV_PackedChunkSize (SVPackedChunk* self);
+
+#endif
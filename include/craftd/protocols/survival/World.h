@@ -29,6 +29,7 @@
 #include <craftd/Server.h>
 
 #include <craftd/protocols/survival/Player.h>
+#include <craftd/protocols/survival/Section.h>
 
 typedef enum _SVWorldError {
 	SVWorldErrUnknown,
@@ -53,6 +54,101 @@ typedef enum _SVWorldDifficulty {
     SVDifficultyHard     = 3
 } SVWorldDifficulty;
 
+/* Changed blocks in a chunk past which the whole chunk is sent again instead of a MultiBlockChange */
+#define SV_WORLD_CHUNK_CHANGES 64
+
+/**
+ * Key of a chunk in maps, both halves go through their unsigned bits so
+ * negative coordinates don't collide
+ */
+static inline
+CDMapId
+SV_ChunkPositionToId (SVChunkPosition position)
+{
+	return (CDMapId) (((uint64_t) (uint32_t) position.x << 32) | (uint32_t) position.z);
+}
+
+/**
+ * How a chunk is held, a reference only keeps it in the cache while reading
+ * and writing also take its lock
+ */
+typedef enum _SVChunkAccess {
+	SVChunkReference,
+	SVChunkRead,
+	SVChunkWrite
+} SVChunkAccess;
+
+/**
+ * A cached chunk, referenced while somebody holds it and kept in the LRU
+ * list once nobody does.
+ */
+typedef struct _SVWorldChunk {
+	SVChunkPosition position;
+	SVPackedChunk*  chunk;
+
+	/// What the packed chunk takes in memory, counted in the cache memory
+	size_t size;
+
+	/// Guards the chunk content, always taken without the chunks lock held
+	pthread_rwlock_t lock;
+
+	/// The encoded MapChunk packet, built on the first send and dropped when the chunk changes
+	CDSharedBuffer* packet;
+	unsigned int    version;
+
+	int  references;
+	bool loading;
+
+	struct _SVWorldChunk* previous;
+	struct _SVWorldChunk* next;
+
+	/// Blocks changed since the last flush by index in the chunk, guarded by the chunk lock. While
+	/// queued in the world's changed list, guarded by the chunks lock, the chunk stays referenced.
+	struct {
+		uint16_t item[SV_WORLD_CHUNK_CHANGES];
+		size_t   length;
+		bool     overflow;
+
+		bool                  queued;
+		struct _SVWorldChunk* next;
+	} changes;
+
+	/// Changed since it was last written back through World.chunk=. While queued in the world's
+	/// dirty list, guarded by the chunks lock, the chunk stays referenced.
+	struct {
+		bool                  queued;
+		struct _SVWorldChunk* next;
+	} dirty;
+
+	/// Players that have the chunk loaded, they hold a reference on it
+	struct {
+		SVPlayer** item;
+		size_t     length;
+		size_t     size;
+	} subscribers;
+} SVWorldChunk;
+
+/**
+ * A block and what it's made of
+ */
+typedef struct _SVWorldBlock {
+	SVBlockPosition position;
+
+	uint8_t type;
+	uint8_t metadata;
+} SVWorldBlock;
+
+/**
+ * The entities in a chunk, a cell of the world's spatial index
+ */
+typedef struct _SVWorldCell {
+	SVChunkPosition position;
+
+	SVEntity** item;
+	size_t     length;
+	size_t     size;
+} SVWorldCell;
+
 typedef struct _SVWorld {
 	CDServer* server;
 
@@ -66,6 +162,26 @@ typedef struct _SVWorld {
 				short sunset;
 				short night;
 			} rate;
+
+			struct {
+				/// Megabytes of packed chunks the cache keeps
+				int  memory;
+				int  compression;
+				bool hugepages;
+			} chunks;
+
+			/// Observers within near blocks of an entity get its updates every near period ticks,
+			/// within middle blocks every middle period ticks and every far period ticks past that
+			struct {
+				struct {
+					int distance;
+					int period;
+				} near, middle;
+
+				struct {
+					int period;
+				} far;
+			} tracking;
 		} cache;
 	} config;
 
@@ -85,8 +201,54 @@ typedef struct _SVWorld {
 	/// All world entities (including players)
 	CDMap*  entities;
 
+	/// The entities by the chunk they're in, updated as they move
+	struct {
+		CDMap*           cells;
+		pthread_rwlock_t lock;
+	} grid;
+
 	SVBlockPosition spawnPosition;
-	CDSet*          chunks;
+
+	struct {
+		/// Cached chunks by position
+		CDMap* entries;
+
+		/// Unreferenced chunks, most recently released first
+		struct {
+			SVWorldChunk* head;
+			SVWorldChunk* tail;
+		} unused;
+
+		/// Cached chunks, and bytes they take against the limit
+		size_t length;
+		size_t memory;
+		size_t limit;
+
+		/// Chunks with changed blocks waiting for SV_WorldFlushChanges
+		SVWorldChunk* changed;
+
+		/// Chunks with changed blocks waiting for SV_WorldSaveChunks
+		SVWorldChunk* dirty;
+
+		/// Expanded chunks and compression buffers, only needed while loading, sending or saving
+		struct {
+			CDSlabPool* chunks;
+			CDSlabPool* buffers;
+		} slabs;
+
+		struct {
+			uint64_t hits;
+			uint64_t misses;
+			uint64_t evictions;
+			uint64_t compressions;
+			uint64_t changes;
+			uint64_t resends;
+			uint64_t saves;
+		} stats;
+
+		pthread_mutex_t lock;
+		pthread_cond_t  loaded;
+	} chunks;
 
 	SVEntityId lastGeneratedEntityId;
 
@@ -118,6 +280,40 @@ bool SV_WorldAddPlayer (SVWorld* self, SVPlayer* player);
  */
 void SV_WorldRemovePlayer (SVWorld* self, SVPlayer* player);
 
+/**
+ * Add an entity to the world and to the spatial index at its current position.
+ */
+void SV_WorldAddEntity (SVWorld* self, SVEntity* entity);
+
+/**
+ * Remove an entity from the world and from the spatial index.
+ */
+void SV_WorldRemoveEntity (SVWorld* self, SVEntity* entity);
+
+/**
+ * Set the position of an entity, moving it in the spatial index when it
+ * enters another chunk.
+ */
+void SV_WorldMoveEntity (SVWorld* self, SVEntity* entity, SVPrecisePosition position);
+
+typedef void (*SVWorldEntityCallback) (SVWorld* world, SVEntity* entity, CDPointer context);
+
+/**
+ * Call the callback on every entity in the chunks at most radius chunks away
+ * from center on either axis.
+ *
+ * The spatial index is read locked while iterating, the callback must not
+ * add, remove or move entities.
+ */
+void SV_WorldForEachInChunks (SVWorld* self, SVChunkPosition center, int radius, SVWorldEntityCallback callback, CDPointer context);
+
+/**
+ * Get the entities within radius blocks of a position
+ *
+ * @return A List of SVEntity, the caller destroys it
+ */
+CDList* SV_WorldQueryRadius (SVWorld* self, SVPrecisePosition center, double radius);
+
 void SV_WorldBroadcastBuffer (SVWorld* self, CDBuffer* buffer);
 
 void SV_WorldBroadcastPacket (SVWorld* self, SVPacket* packet);
@@ -128,8 +324,90 @@ uint16_t SV_WorldGetTime (SVWorld* self);
 
 uint16_t SV_WorldSetTime (SVWorld* self, uint16_t time);
 
-SVChunk* SV_WorldGetChunk (SVWorld* self, int x, int z);
+/**
+ * Borrow the cached chunk, loading it through World.chunk on a miss.
+ *
+ * Concurrent misses on the same chunk wait for a single load. The returned
+ * handle is referenced and its chunk can't be evicted until it's given back
+ * with SV_WorldReleaseChunk, with SVChunkRead or SVChunkWrite its lock is
+ * held as well. Never acquire a second chunk for writing while holding one.
+ *
+ * @return The handle, the packed chunk is its chunk field, or NULL if it
+ *         couldn't be loaded, errno is set
+ */
+SVWorldChunk* SV_WorldAcquireChunk (SVWorld* self, int x, int z, SVChunkAccess access);
+
+/**
+ * Give back a handle taken with SV_WorldAcquireChunk with the same access,
+ * once nobody references the chunk it becomes a candidate for eviction.
+ */
+void SV_WorldReleaseChunk (SVWorld* self, SVWorldChunk* chunk, SVChunkAccess access);
 
+/**
+ * Get the encoded MapChunk packet for a chunk referenced but not locked by the
+ * caller, it's compressed once and shared by every send until the chunk changes.
+ *
+ * @return A reference to the packet, drop it with CD_DestroySharedBuffer, or
+ *         NULL if the chunk couldn't be compressed
+ */
+CDSharedBuffer* SV_WorldGetChunkPacket (SVWorld* self, SVWorldChunk* chunk);
+
+/**
+ * Replace a chunk with the content of an expanded one and write it through
+ * World.chunk=, a cached copy is repacked in place so handles stay valid
+ */
 void SV_WorldSetChunk (SVWorld* self, SVChunk* chunk);
 
+/**
+ * Get a block, loading its chunk in the cache if needed
+ *
+ * @return false if the chunk couldn't be loaded or the position is out of the world, errno is set
+ */
+bool SV_WorldGetBlock (SVWorld* self, SVBlockPosition position, SVWorldBlock* result);
+
+/**
+ * Change a block in the cached chunk, players see the change on the next
+ * SV_WorldFlushChanges.
+ *
+ * @return false if the chunk couldn't be loaded or the position is out of the world, errno is set
+ */
+bool SV_WorldSetBlock (SVWorld* self, SVBlockPosition position, uint8_t type, uint8_t metadata);
+
+/**
+ * Change many blocks, consecutive blocks in the same chunk share the lookup
+ *
+ * @return false if any of the blocks couldn't be changed, the others are
+ */
+bool SV_WorldSetBlocks (SVWorld* self, SVWorldBlock* blocks, size_t length);
+
+typedef void (*SVWorldChangesCallback) (SVWorld* world, SVChunkPosition position, CDSharedBuffer* packet, CDPointer context);
+
+/**
+ * Send out the block changes since the last flush: for every changed chunk
+ * the callback gets a MultiBlockChange packet, or the whole MapChunk when
+ * more than SV_WORLD_CHUNK_CHANGES blocks changed.
+ */
+void SV_WorldFlushChanges (SVWorld* self, SVWorldChangesCallback callback, CDPointer context);
+
+/**
+ * Write the chunks changed since the last save back through World.chunk=,
+ * expanded one at a time. SV_WorldSave does it before World.save.
+ */
+void SV_WorldSaveChunks (SVWorld* self);
+
+/**
+ * Subscribe a player to the packets about a chunk, the player must hold a
+ * reference on the chunk until it unsubscribes
+ */
+void SV_WorldSubscribeChunk (SVWorld* self, SVChunkPosition position, SVPlayer* player);
+
+void SV_WorldUnsubscribeChunk (SVWorld* self, SVChunkPosition position, SVPlayer* player);
+
+/**
+ * Send a buffer to the players subscribed to a chunk
+ */
+void SV_ChunkBroadcastSharedBuffer (SVWorld* world, SVChunkPosition position, CDSharedBuffer* buffer);
+
+void SV_ChunkBroadcastPacket (SVWorld* world, SVChunkPosition position, SVPacket* packet);
+
 #endif
@@ -91,7 +91,13 @@ typedef enum _SVStringColor {
 } SVStringColor;
 
 /**
- * Check if a String is valid for Minecraft
+ * Build the lookup table of the characters Minecraft clients can render, it's
+ * built once and on demand if this wasn't called.
+ */
+void SV_InitializeCharset (void);
+
+/**
+ * Check if a String is valid for Minecraft, a valid String is marked as clean
  *
  * @return true if valid, false otherwise
  */
@@ -101,6 +107,8 @@ bool SV_StringIsValid (CDString* self);
  * Get a sanitized String to send to Minecraft clients, replaces unknown characters
  * with ?.
  *
+ * The result is marked as clean, so is the String if nothing had to be replaced.
+ *
  * @return The sanitized String
  */
 SVString SV_StringSanitize (SVString self);
@@ -437,6 +445,8 @@ typedef struct _SVData {
 		SVTypeIntIntInt
 	} type;
 
+	uint8_t index;
+
 	union {
 		SVByte    b;
 		SVShort   s;
@@ -475,10 +485,38 @@ SVMetadata* SV_ConcatDatas (SVMetadata* metadata, SVData** data, size_t length);
 
 SVMetadata* SV_AppendData (SVMetadata* metadata, SVData* data);
 
+/**
+ * The bytes SV_MetadataToByteArray writes for the metadata, terminator included
+ */
+size_t SV_MetadataSize (SVMetadata* self);
+
+/**
+ * Write the metadata in wire format, strings are written as they are
+ *
+ * @return The bytes written, always SV_MetadataSize
+ */
+size_t SV_MetadataToByteArray (SVMetadata* self, uint8_t* array);
+
 SVMetadata* SV_MetadataFromEvent (struct bufferevent* event);
 
 void SV_ChunkToByteArray (SVChunk* chunk, uint8_t* array);
 
+/**
+ * The most SV_ChunkCompress can write for a chunk
+ */
+size_t SV_ChunkCompressBound (void);
+
+/**
+ * Deflate the chunk data in MapChunk order straight from the chunk arrays,
+ * using a zlib stream reused by the calling thread.
+ *
+ * @param level The zlib compression level
+ * @param output Where to write, SV_ChunkCompressBound bytes are always enough
+ *
+ * @return The compressed length, 0 on failure
+ */
+size_t SV_ChunkCompress (SVChunk* chunk, int level, uint8_t* output, size_t length);
+
 static inline
 SVBlockPosition
 SV_ChunkPositionToBlockPosition (SVChunkPosition position)
@@ -608,6 +646,16 @@ SV_PrecisePositionToAbsolutePosition(SVPrecisePosition position)
 	};
 }
 
+/**
+ * Convert an angle in degrees to the 256ths of a turn packets use
+ */
+static inline
+SVByte
+SV_AngleToByte (SVFloat angle)
+{
+	return (SVByte) ((int) (angle * 256.0f / 360.0f) & 0xFF);
+}
+
 #define SV_ChunkPositionEqual(a, b)     ((a.x == b.x) && (a.z == b.z))
 #define SV_BlockPositionEqual(a, b)     ((a.x == b.x) && (a.y == b.y) && (a.z == b.z))
 #define SV_AbsolutePositionEqueal(a, b) ((a.x == b.x) && (a.y == b.y) && (a.z == b.z))
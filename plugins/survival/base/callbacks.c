@@ -27,8 +27,6 @@
  * here.
  * @inmodule Survival
  */
-#include <zlib.h>
-
 #include <craftd/Logger.h>
 
 #include <craftd/protocols/survival/World.h>
@@ -55,79 +53,92 @@ cdsurvival_SendPreChunk (CDServer* server, SVPlayer* player, SVChunkPosition* co
 }
 
 
+/**
+ * Send a chunk to the player, on success the chunk stays referenced in the
+ * world cache, subscribed and marked in Player.chunkView until it's unloaded.
+ */
 static
 bool
 cdsurvival_SendChunk (CDServer* server, SVPlayer* player, SVChunkPosition* coord)
 {
-	DO {
-		SDEBUG(server, "sending chunk (%d, %d)", coord->x, coord->z);
+	SVChunkView*  view   = (SVChunkView*) CD_DynamicGet(player, "Player.chunkView");
+	CDMap*        chunks = (CDMap*) CD_DynamicGet(player, "Player.chunks");
+	SVWorldChunk* chunk;
 
-		SVChunk* chunk = CD_malloc(sizeof(SVChunk));
-		CDError  status;
+	if (view && SV_ChunkViewHas(view, *coord)) {
+		return true;
+	}
 
-		CD_EventDispatchWithError(status, server, "World.chunk", player->world, coord->x, coord->z, chunk);
+	DO {
+		SDEBUG(server, "sending chunk (%d, %d)", coord->x, coord->z);
 
-		if (status != CDOk) {
-			CD_free(chunk);
+		chunk = SV_WorldAcquireChunk(player->world, coord->x, coord->z, SVChunkReference);
 
+		if (!chunk) {
 			return false;
 		}
 
-		uLongf written = compressBound(81920);
-		Bytef* buffer  = CD_malloc(written);
-		Bytef* data    = CD_malloc(81920);
+		// subscribe before encoding, changes from now on either are in the packet or follow it
+		if (view) {
+			SV_WorldSubscribeChunk(player->world, *coord, player);
+		}
 
-		SV_ChunkToByteArray(chunk, data);
+		CDSharedBuffer* packet = SV_WorldGetChunkPacket(player->world, chunk);
 
-		if (compress(buffer, &written, (Bytef*) data, 81920) != Z_OK) {
-			SERR(server, "zlib compress failure");
+		if (!packet) {
+			if (view) {
+				SV_WorldUnsubscribeChunk(player->world, *coord, player);
+			}
 
-			CD_free(chunk);
-			CD_free(data);
+			SV_WorldReleaseChunk(player->world, chunk, SVChunkReference);
 
 			return false;
 		}
 
-		SDEBUG(server, "compressed to %ld bytes", written);
+		CD_ClientSendSharedBuffer(player->client, packet);
+		CD_DestroySharedBuffer(packet);
+	}
 
-		CD_free(chunk);
-		CD_free(data);
+	// the view keeps the chunk until it's unloaded
+	if (view) {
+		SV_ChunkViewSet(view, *coord, true);
+		CD_MapPut(chunks, SV_ChunkPositionToId(*coord), (CDPointer) chunk);
+	}
+	else {
+		SV_WorldReleaseChunk(player->world, chunk, SVChunkReference);
+	}
 
-		SVPacketMapChunk pkt = {
-			.response = {
-				.position = SV_ChunkPositionToBlockPosition(*coord),
+	return true;
+}
 
-				.size = {
-					.x = 16,
-					.y = 128,
-					.z = 16
-				},
+static
+void
+cdsurvival_ChunkRelease (SVChunkView* self, SVChunkPosition coord, SVPlayer* player)
+{
+	assert(self);
+	assert(player);
 
-				.length = written,
-				.item   = (SVByte*) buffer
-			}
-		};
+	CDMap*        chunks = (CDMap*) CD_DynamicGet(player, "Player.chunks");
+	SVWorldChunk* chunk  = (SVWorldChunk*) CD_MapDelete(chunks, SV_ChunkPositionToId(coord));
 
-		SVPacket response = { SVResponse, SVMapChunk, (CDPointer) &pkt };
+	SV_WorldUnsubscribeChunk(player->world, coord, player);
 
-		SV_PlayerSendPacketAndCleanData(player, &response);
+	if (chunk) {
+		SV_WorldReleaseChunk(player->world, chunk, SVChunkReference);
 	}
-
-	return true;
 }
 
 static
 void
-cdsurvival_ChunkRadiusUnload (CDSet* self, SVChunkPosition* coord, SVPlayer* player)
+cdsurvival_ChunkRadiusUnload (SVChunkView* self, SVChunkPosition coord, SVPlayer* player)
 {
 	assert(self);
-	assert(coord);
 	assert(player);
 
 	DO {
 		SVPacketPreChunk pkt = {
 			.response = {
-				.position = *coord,
+				.position = coord,
 				.mode = false
 			}
 		};
@@ -137,192 +148,264 @@ cdsurvival_ChunkRadiusUnload (CDSet* self, SVChunkPosition* coord, SVPlayer* pla
 		SV_PlayerSendPacketAndCleanData(player, &response);
 	}
 
-	CD_free(coord);
+	cdsurvival_ChunkRelease(self, coord, player);
 }
 
+/* Chunks a single job sends before the player's strand yields the worker */
+#define CDSURVIVAL_CHUNK_BUDGET 2
+
+/**
+ * The chunks a player still has to receive, nearest first. It's only touched
+ * from jobs on the player's strand.
+ */
+typedef struct _CDSurvivalChunkQueue {
+	SVChunkPosition* item;
+
+	size_t length;
+	size_t next;
+
+	bool scheduled;
+} CDSurvivalChunkQueue;
+
 static
-void
-cdsurvival_ChunkMemberFree (CDSet* self, SVChunkPosition* coord, void* _)
+CDSurvivalChunkQueue*
+cdsurvival_CreateChunkQueue (size_t size)
 {
-	assert(self);
-	assert(coord);
+	CDSurvivalChunkQueue* self = CD_malloc(sizeof(CDSurvivalChunkQueue));
+
+	self->item      = CD_malloc(sizeof(SVChunkPosition) * size);
+	self->length    = 0;
+	self->next      = 0;
+	self->scheduled = false;
 
-	CD_free(coord);
+	return self;
 }
 
 static
 void
-cdsurvival_ChunkRadiusLoad (CDSet* self, SVChunkPosition* coord, SVPlayer* player)
+cdsurvival_DestroyChunkQueue (CDSurvivalChunkQueue* self)
 {
-	assert(self);
-	assert(coord);
-	assert(player);
-
-    cdsurvival_SendPreChunk(player->client->server, player, coord);
-	cdsurvival_SendChunk(player->client->server, player, coord);
+	CD_free(self->item);
+	CD_free(self);
 }
 
+typedef struct _CDSurvivalChunkPrefetch {
+	SVWorld*        world;
+	SVChunkPosition position;
+} CDSurvivalChunkPrefetch;
+
+/**
+ * Load and compress a chunk on whatever worker is free, so the pump of the
+ * player only has to reference the cached packet.
+ */
 static
 void
-cdsurvival_SendChunkRadius (SVPlayer* player, SVChunkPosition* area, int radius)
+cdsurvival_ChunkPrefetch (CDSurvivalChunkPrefetch* self)
 {
-	CDSet* loadedChunks = (CDSet*) CD_DynamicGet(player, "Player.loadedChunks");
-	CDSet* oldChunks    = loadedChunks;
-	CDSet* newChunks    = CD_CreateSetWith(400, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition);
-
-	for (int x = -radius; x < radius; x++) {
-		for (int z = -radius; z < radius; z++) {
-			if ((x * x + z * z) <= (radius * radius)) {
-				SVChunkPosition* coord = CD_malloc(sizeof(SVChunkPosition));
-				coord->x          = x + area->x;
-				coord->z          = z + area->z;
-
-				CD_SetPut(newChunks, (CDPointer) coord);
-			}
-		}
-	}
+	SVWorldChunk* chunk = SV_WorldAcquireChunk(self->world, self->position.x, self->position.z, SVChunkReference);
 
-	CDSet* toRemove = CD_SetMinus(oldChunks, newChunks);
-	CDSet* toAdd    = CD_SetMinus(newChunks, oldChunks);
+	if (chunk) {
+		CDSharedBuffer* packet = SV_WorldGetChunkPacket(self->world, chunk);
 
-	CD_SetMap(toRemove, (CDSetApply) cdsurvival_ChunkRadiusUnload, (CDPointer) player);
-	CD_SetMap(toAdd, (CDSetApply) cdsurvival_ChunkRadiusLoad, (CDPointer) player);
-
-	CD_DestroySet(toRemove);
-	CD_DestroySet(toAdd);
+		if (packet) {
+			CD_DestroySharedBuffer(packet);
+		}
 
-	if (oldChunks) {
-		CD_DestroySet(oldChunks);
+		SV_WorldReleaseChunk(self->world, chunk, SVChunkReference);
 	}
 
-	CD_DynamicPut(player, "Player.loadedChunks", (CDPointer) newChunks);
+	CD_free(self);
 }
 
+static void cdsurvival_ChunkQueuePump (CDClient* client);
+
 static
-bool
-cdsurvival_CoordInRadius(SVChunkPosition *coord, SVChunkPosition *centerCoord, int radius)
+void
+cdsurvival_ChunkQueueSchedule (CDClient* client, CDSurvivalChunkQueue* queue, bool drain)
 {
-	if (coord->x >= centerCoord->x - radius &&
-		coord->x <= centerCoord->x + radius &&
-		coord->z >= centerCoord->z - radius &&
-		coord->z <= centerCoord->z + radius)
-	{
-		return true;
+	if (queue->scheduled) {
+		return;
 	}
 
-	return false;
-}
+	CDJob* job = CD_CreateJob(CDCustomJob, (CDPointer) CD_CreateCustomJob(
+		(CDCustomJobCallback) cdsurvival_ChunkQueuePump, (CDPointer) client));
 
-static
-bool
-cdsurvival_DistanceGreater (SVPrecisePosition a, SVPrecisePosition b, int maxDistance)
-{
-	return (abs( a.x - b.x ) > maxDistance ||
-			abs( a.y - b.y ) > maxDistance ||
-			abs( a.z - b.z ) > maxDistance);
+	queue->scheduled = true;
+
+	if (drain) {
+		CD_ClientAddJobOnDrain(client, job);
+	}
+	else {
+		CD_ClientAddJob(client, job);
+	}
 }
 
+/**
+ * Send the nearest queued chunks, a few at a time and only while the client
+ * keeps up with what it's been sent already.
+ */
 static
-SVRelativePosition
-cdsurvival_RelativeMove (SVPrecisePosition* a, SVPrecisePosition* b)
+void
+cdsurvival_ChunkQueuePump (CDClient* client)
 {
-	SVAbsolutePosition absoluteA = SV_PrecisePositionToAbsolutePosition(*a);
-	SVAbsolutePosition absoluteB = SV_PrecisePositionToAbsolutePosition(*b);
+	SVPlayer*             player = (SVPlayer*) CD_DynamicGet(client, "Client.player");
+	CDSurvivalChunkQueue* queue  = NULL;
 
-	return (SVRelativePosition) {
-		.x = absoluteA.x - absoluteB.x,
-		.y = absoluteA.y - absoluteB.y,
-		.z = absoluteA.z - absoluteB.z
-	};
+	if (player) {
+		queue = (CDSurvivalChunkQueue*) CD_DynamicGet(player, "Player.chunkQueue");
+	}
+
+	if (!queue) {
+		return;
+	}
+
+	queue->scheduled = false;
+
+	for (int sent = 0; queue->next < queue->length; sent++) {
+		if (CD_ClientGetStatus(client) == CDClientDisconnect) {
+			return;
+		}
+
+		if (CD_ClientIsCongested(client)) {
+			cdsurvival_ChunkQueueSchedule(client, queue, true);
+			return;
+		}
+
+		if (sent == CDSURVIVAL_CHUNK_BUDGET) {
+			cdsurvival_ChunkQueueSchedule(client, queue, false);
+			return;
+		}
+
+		SVChunkPosition coord = queue->item[queue->next++];
+
+		cdsurvival_SendPreChunk(client->server, player, &coord);
+		cdsurvival_SendChunk(client->server, player, &coord);
+	}
+
+	queue->length = queue->next = 0;
 }
 
 static
 void
-cdsurvival_SendPacketToAllInRegion(SVPlayer *player, SVPacket *pkt)
+cdsurvival_ChunkRadiusQueue (SVChunkView* self, SVChunkPosition coord, SVPlayer* player)
 {
-    CDList *seenPlayers = (CDList *) CD_DynamicGet(player, "Player.seenPlayers");
-
-    CD_LIST_FOREACH(seenPlayers, it)
-    {
-        if ( player != (SVPlayer *) CD_ListIteratorValue(it) ) {
-            SV_PlayerSendPacket( (SVPlayer *) CD_ListIteratorValue(it), pkt );
-        } else {
-            CERR("We have a player with himself in the List????");
-        }
-    }
+	CDSurvivalChunkQueue* queue = (CDSurvivalChunkQueue*) CD_DynamicGet(player, "Player.chunkQueue");
+
+	queue->item[queue->length++] = coord;
 }
 
+/**
+ * Move the player's view to the given area. Chunks out of the window are
+ * unloaded right away, the ones past the margin once the grace period is
+ * over (see cdsurvival_ExpireChunks), the missing ones are queued nearest first and streamed by
+ * cdsurvival_ChunkQueuePump.
+ */
 static
 void
-cdsurvival_SendUpdatePos(SVPlayer* player, SVPrecisePosition* newPosition, bool andLook, SVFloat pitch, SVFloat yaw)
+cdsurvival_SendChunkRadius (SVPlayer* player, SVChunkPosition* area)
 {
-	if (cdsurvival_DistanceGreater(player->entity.position, *newPosition, 4) || true) {
-		DO {
-			SVPacketEntityTeleport pkt;
+	SVChunkView*          view  = (SVChunkView*) CD_DynamicGet(player, "Player.chunkView");
+	CDSurvivalChunkQueue* queue = (CDSurvivalChunkQueue*) CD_DynamicGet(player, "Player.chunkQueue");
 
-			pkt.response.entity   = player->entity;
-			pkt.response.position = SV_PrecisePositionToAbsolutePosition(*newPosition);
+	// whatever was still queued gets queued again if it's still in range
+	queue->length = queue->next = 0;
 
-			if (andLook) {
-				pkt.response.pitch = pitch;
-				pkt.response.rotation = yaw;
-			}
-			else {
-				pkt.response.pitch = player->pitch;
-				pkt.response.rotation = player->yaw;
-			}
+	SV_ChunkViewMove(view, *area, time(NULL),
+		(SVChunkViewCallback) cdsurvival_ChunkRadiusUnload,
+		(SVChunkViewCallback) cdsurvival_ChunkRadiusQueue, (CDPointer) player);
 
-			SVPacket response = { SVResponse, SVEntityTeleport, (CDPointer)  &pkt };
+	if (queue->length > 0) {
+		cdsurvival_ChunkQueueSchedule(player->client, queue, false);
+	}
 
-			cdsurvival_SendPacketToAllInRegion(player, &response);
-		}
+	if (queue->length <= CDSURVIVAL_CHUNK_BUDGET) {
+		return;
 	}
-	else {
-		if (andLook) {
-			SVPacketEntityLookMove pkt = {
-				.response = {
-					.entity   = player->entity,
-					.position = SV_RelativeMove(&player->entity.position, newPosition),
-					.yaw      = yaw,
-					.pitch    = pitch
-				}
-			};
 
+	// the first ones are about to be sent, prepare the rest in the background, all submitted at once
+	size_t  length = queue->length - CDSURVIVAL_CHUNK_BUDGET;
+	CDJob** jobs   = CD_malloc(sizeof(CDJob*) * length);
 
-			SVPacket response = { SVResponse, SVEntityLookMove, (CDPointer) &pkt };
+	for (size_t i = 0; i < length; i++) {
+		CDSurvivalChunkPrefetch* prefetch = CD_malloc(sizeof(CDSurvivalChunkPrefetch));
 
-			SV_RegionBroadcastPacket(player, &response);
-		}
-		else {
-			SVPacketEntityRelativeMove pkt = {
-				.response = {
-					.entity   = player->entity,
-					.position = SV_RelativeMove(&player->entity.position, newPosition)
-				}
-			};
+		prefetch->world    = player->world;
+		prefetch->position = queue->item[CDSURVIVAL_CHUNK_BUDGET + i];
 
-			SVPacket response = { SVResponse, SVEntityRelativeMove, (CDPointer) &pkt };
+		jobs[i] = CD_CreateJob(CDCustomJob, (CDPointer) CD_CreateCustomJob(
+			(CDCustomJobCallback) cdsurvival_ChunkPrefetch, (CDPointer) prefetch));
+	}
 
-			SV_RegionBroadcastPacket(player, &response);
-		}
+	CD_AddJobs(player->client->server->workers, jobs, length);
+
+	CD_free(jobs);
+}
+
+/**
+ * Unload the chunks that have been past the player's view margin for longer
+ * than the grace period, called as the player's movement packets come in.
+ */
+static
+void
+cdsurvival_ExpireChunks (SVPlayer* player)
+{
+	SVChunkView* view = (SVChunkView*) CD_DynamicGet(player, "Player.chunkView");
+
+	if (!view) {
+		return;
 	}
+
+	SV_ChunkViewExpire(view, time(NULL), (SVChunkViewCallback) cdsurvival_ChunkRadiusUnload, (CDPointer) player);
 }
 
+static
+bool
+cdsurvival_CoordInRadius(SVChunkPosition *coord, SVChunkPosition *centerCoord, int radius)
+{
+	if (coord->x >= centerCoord->x - radius &&
+		coord->x <= centerCoord->x + radius &&
+		coord->z >= centerCoord->z - radius &&
+		coord->z <= centerCoord->z + radius)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+static
+void
+cdsurvival_SendPacketToAllInRegion(SVPlayer *player, SVPacket *pkt)
+{
+    SV_RegionBroadcastPacket(player, pkt);
+}
+
+/**
+ * Spawn a player to another one, the tracker lock has to be held
+ */
 static
 void
 cdsurvival_SendNamedPlayerSpawn(SVPlayer *player, SVPlayer *other)
 {
+	// spawn it where the tracker told near observers it is, the tracker moves it to its tier after
+	CDSurvivalTracked*     tracked = (CDSurvivalTracked*) CD_DynamicGet(other, "Player.tracked");
+	CDSurvivalTrackedState state   = tracked ? tracked->tiers[0] : (CDSurvivalTrackedState) {
+		.position = SV_PrecisePositionToAbsolutePosition(other->entity.position),
+		.yaw      = SV_AngleToByte(other->yaw),
+		.pitch    = SV_AngleToByte(other->pitch)
+	};
+
 	DO {
 		SVPacketNamedEntitySpawn pkt = {
 			.response = {
 				.entity   = other->entity,
 				.name     = other->username,
-				.pitch    = other->pitch,
-				.rotation = other->yaw,
+				.pitch    = state.pitch,
+				.rotation = state.yaw,
 
 				.itemId = 0,
 
-				.position = SV_PrecisePositionToAbsolutePosition(other->entity.position)
+				.position = state.position
 			}
 		};
 
@@ -353,9 +436,9 @@ cdsurvival_SendNamedPlayerSpawn(SVPlayer *player, SVPlayer *other)
 		SVPacketEntityTeleport pkt = {
 			.response = {
 				.entity   = other->entity,
-				.pitch    = other->pitch,
-				.rotation = 0,
-				.position = SV_PrecisePositionToAbsolutePosition(other->entity.position)
+				.pitch    = state.pitch,
+				.rotation = state.yaw,
+				.position = state.position
 			}
 		};
 
@@ -384,47 +467,84 @@ cdsurvival_SendDestroyEntity (SVPlayer* player, SVEntity* entity)
 	}
 }
 
+/**
+ * Show each other a player and another one in range that it doesn't see yet
+ */
 static
 void
-cdsurvival_CheckPlayersInRegion (CDServer* server, SVPlayer* player, SVChunkPosition *coord, int radius)
+cdsurvival_ShowPlayer (SVWorld* world, SVEntity* entity, SVPlayer* player)
 {
-	CDList* seenPlayers = (CDList*) CD_DynamicGet(player, "Player.seenPlayers");;
+	if (entity->type != SVEntityPlayer || entity == &player->entity) {
+		return;
+	}
 
-	CD_HASH_FOREACH(player->world->players, it) {
-		SVPlayer* otherPlayer = (SVPlayer *) CD_HashIteratorValue(it);
+	SVPlayer* other = (SVPlayer*) entity;
 
-		// If we are the player to check just skip
-		if (otherPlayer == player) {
-			continue;
-		}
+	pthread_mutex_lock(&_tracker.lock);
 
-		SVChunkPosition chunkPos = SV_PrecisePositionToChunkPosition(otherPlayer->entity.position);
+	CDMap* visible      = (CDMap*) CD_DynamicGet(player, "Player.visible");
+	CDMap* otherVisible = (CDMap*) CD_DynamicGet(other, "Player.visible");
 
-		if (cdsurvival_CoordInRadius(&chunkPos, coord, radius)) {
-			/* If the player is in range, but not in the list. */
-			if (!CD_ListContains(seenPlayers, (CDPointer) otherPlayer)) {
-				CD_ListPush(seenPlayers, (CDPointer) otherPlayer);
-				cdsurvival_SendNamedPlayerSpawn(player, otherPlayer);
+	// not logged in yet or logging out, it looks around itself when it logs in
+	if (!otherVisible || CD_MapHasKey(visible, other->entity.id)) {
+		goto done;
+	}
 
-				CDList *otherSeenPlayers = (CDList *) CD_DynamicGet(otherPlayer, "Player.seenPlayers");
-				CD_ListPush(otherSeenPlayers, (CDPointer) player);
-				cdsurvival_SendNamedPlayerSpawn(otherPlayer, player);
-			}
-		}
-		else {
-			/* If the player is out of range but in the list */
-			if (CD_ListContains(seenPlayers, (CDPointer) otherPlayer)) {
-				CDList *otherSeenPlayers = (CDList *) CD_DynamicGet(otherPlayer, "Player.seenPlayers");
+	CD_MapPut(visible, other->entity.id, (CDPointer) other);
+	cdsurvival_SendNamedPlayerSpawn(player, other);
 
-				CD_ListDeleteAll(seenPlayers, (CDPointer) otherPlayer);
-				CD_ListDeleteAll(otherSeenPlayers, (CDPointer) player);
+	CD_MapPut(otherVisible, player->entity.id, (CDPointer) player);
+	cdsurvival_SendNamedPlayerSpawn(other, player);
 
-				/* Should send both players an update. */
-				cdsurvival_SendDestroyEntity(player, &otherPlayer->entity);
-				cdsurvival_SendDestroyEntity(otherPlayer, &player->entity);
-			}
+	done: {
+		pthread_mutex_unlock(&_tracker.lock);
+	}
+}
+
+/**
+ * Update who the player sees from the given chunk: the players it sees that
+ * went out of range are hidden, then the ones in the chunks around it are
+ * shown, both ways.
+ */
+static
+void
+cdsurvival_CheckPlayersInRegion (CDServer* server, SVPlayer* player, SVChunkPosition *coord, int radius)
+{
+	CDList* hidden = CD_CreateList();
+
+	pthread_mutex_lock(&_tracker.lock);
+
+	CDMap* visible = (CDMap*) CD_DynamicGet(player, "Player.visible");
+
+	CD_MAP_FOREACH(visible, it) {
+		SVPlayer*       other    = (SVPlayer*) CD_MapIteratorValue(it);
+		SVChunkPosition chunkPos = SV_PrecisePositionToChunkPosition(other->entity.position);
+
+		if (!cdsurvival_CoordInRadius(&chunkPos, coord, radius)) {
+			CD_ListPush(hidden, (CDPointer) other);
 		}
 	}
+
+	CD_LIST_FOREACH(hidden, it) {
+		SVPlayer* other        = (SVPlayer*) CD_ListIteratorValue(it);
+		CDMap*    otherVisible = (CDMap*) CD_DynamicGet(other, "Player.visible");
+
+		CD_MapDelete(visible, other->entity.id);
+		CD_MapDelete(otherVisible, player->entity.id);
+
+		cdsurvival_TrackerForget(player, other);
+		cdsurvival_TrackerForget(other, player);
+
+		cdsurvival_SendDestroyEntity(player, &other->entity);
+		cdsurvival_SendDestroyEntity(other, &player->entity);
+	}
+
+	pthread_mutex_unlock(&_tracker.lock);
+
+	CD_DestroyList(hidden);
+
+	SV_WorldForEachInChunks(player->world, *coord, radius,
+		(SVWorldEntityCallback) cdsurvival_ShowPlayer, (CDPointer) player);
 }
 
 static
@@ -510,7 +630,7 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 		} break;
 
 		case SVOnGround: {
-			// Stub.  Probably not needed
+			cdsurvival_ExpireChunks(player);
 		} break;
 
 		case SVPlayerPosition: {
@@ -523,14 +643,14 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 			SVChunkPosition curChunk = SV_PrecisePositionToChunkPosition(player->entity.position);
 
 			if (!SV_ChunkPositionEqual(newChunk, curChunk)) {
-				cdsurvival_SendChunkRadius(player, &newChunk, 10);
+				cdsurvival_SendChunkRadius(player, &newChunk);
 
 				cdsurvival_CheckPlayersInRegion(server, player, &newChunk, 5);
 			}
 
-			cdsurvival_SendUpdatePos(player, &data->request.position, false, 0, 0);
+			SV_WorldMoveEntity(world, &player->entity, data->request.position);
 
-			player->entity.position = data->request.position;
+			cdsurvival_ExpireChunks(player);
 		} break;
 
 		case SVPlayerLook: {
@@ -538,20 +658,11 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 
 			SVPacketPlayerLook* data = (SVPacketPlayerLook*) packet->data;
 
+			// the tracker sends the change on its next tick
 			player->yaw   = data->request.yaw;
 			player->pitch = data->request.pitch;
 
-			DO {
-			  SVPacketEntityLook pkt;
-
-			  pkt.response.entity = player->entity;
-			  pkt.response.pitch = player->pitch;
-			  pkt.response.yaw = player->yaw;
-
-			  SVPacket response = { SVResponse, SVEntityLook, (CDPointer) &pkt };
-
-			  cdsurvival_SendPacketToAllInRegion(player, &response);
-			}
+			cdsurvival_ExpireChunks(player);
 		} break;
 
 		case SVPlayerMoveLook: {
@@ -564,16 +675,17 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 			SVChunkPosition newChunk = SV_PrecisePositionToChunkPosition(data->request.position);
 
 			if (!SV_ChunkPositionEqual(oldChunk, newChunk)) {
-				cdsurvival_SendChunkRadius(player, &newChunk, 10);
+				cdsurvival_SendChunkRadius(player, &newChunk);
 
 				cdsurvival_CheckPlayersInRegion(server, player, &newChunk, 5);
 			}
 
-			cdsurvival_SendUpdatePos(player, &data->request.position, true, data->request.pitch, data->request.yaw);
+			SV_WorldMoveEntity(world, &player->entity, data->request.position);
+
+			player->yaw   = data->request.yaw;
+			player->pitch = data->request.pitch;
 
-			player->entity.position = data->request.position;
-			player->yaw             = data->request.yaw;
-			player->pitch           = data->request.pitch;
+			cdsurvival_ExpireChunks(player);
 		} break;
                 
         case SVPlayerDigging: {
@@ -584,47 +696,17 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
                     (data->request.status == SVStartedDigging && world->mode == SVModeCreative)) {
                 SVPrecisePosition a = SV_BlockPositionToPrecisePosition(data->request.position);
                 if(!SV_IsDistanceGreater(player->entity.position, a, 6)) {
-                    SVChunkPosition pos = SV_BlockPositionToChunkPosition(data->request.position);
-                    SVChunk* chunk = SV_WorldGetChunk(world, pos.x, pos.z);
-
-                    SVInteger iPos = data->request.position.y + 128 * (
-                            (data->request.position.z & 0xF) + 16 *
-                            (data->request.position.x & 0xF));
-
-                    SVBlock block = {
-                        .blockPosition = {
-                            .x = data->request.position.x,
-                            .y = data->request.position.y,
-                            .z = data->request.position.z
-                        },
-                        .chunkPosition = {
-                            .x = pos.x,
-                            .z = pos.z
-                        },
-                        .type = chunk->blocks[iPos],
-                        .data = {
-                            .blockType = chunk->blocks[iPos],
-                            .data = chunk->data[iPos],
-                        }
-                    };
-
-                    DEBUG("Break info: Chunk X:%i Chunk Z:%i Block Type:0x%.2X Block Data:0x%.2X\n",
-                            pos.x, pos.z, chunk->blocks[iPos], chunk->data[iPos]);
-
-                    SVPacketBlockChange pkt = {
-                        .response = {
-                            .position = {
-                                .x = data->request.position.x,
-                                .y = data->request.position.y,
-                                .z = data->request.position.z
-                            },
-                            .type = SVAir,
-                            .metadata = SVAir
-                        }
-                    };
-
-                    SVPacket response = { SVResponse, SVBlockChange, (CDPointer) &pkt};
-                    SV_WorldBroadcastPacket(world, &response); //Maybe send to all in region?
+                    SVWorldBlock block;
+
+                    if (!SV_WorldGetBlock(world, data->request.position, &block)) {
+                        break;
+                    }
+
+                    SDEBUG(server, "%s broke block 0x%.2X:0x%.2X at (%d, %d, %d)", CD_StringContent(player->username),
+                            block.type, block.metadata, block.position.x, block.position.y, block.position.z);
+
+                    // the players that have the chunk loaded see it on the next flush
+                    SV_WorldSetBlock(world, data->request.position, SVAir, 0);
                 }
                 else {
                     SERR(server, "Player %s tried to dig past max dig limit! Hacking?",
@@ -715,25 +797,6 @@ cdsurvival_PlayerLogin (CDServer* server, SVPlayer* player, int status)
 
     SVChunkPosition spawnChunk = SV_BlockPositionToChunkPosition(player->world->spawnPosition);
 
-    // [TODO] Move this to a chunk handling plugin and make configurable!
-    int maxRadius = 10;
-
-    // Send out the pre chunk messages to the client. Order here
-    // isn't important.
-    DO {
-
-        for (int i = -maxRadius; i <= maxRadius; i++) {
-            for (int j = -maxRadius; j <= maxRadius; j++) {
-                SVChunkPosition coords = {
-                    .x = spawnChunk.x + i,
-                    .z = spawnChunk.z + j
-                };
-                if (!cdsurvival_SendPreChunk(server, player, &coords))
-                    return false;
-            }
-        }
-    }
-
     DO {
         SVPrecisePosition pos = SV_BlockPositionToPrecisePosition(player->world->spawnPosition);
         SVPacketPlayerMoveLook pkt = {
@@ -759,53 +822,8 @@ cdsurvival_PlayerLogin (CDServer* server, SVPlayer* player, int status)
 	}
 
 
-    // Send out the chunk data emenating from the spawn chunk
-    DO {
-        SVChunkPosition coords = {
-            .x = spawnChunk.x,
-            .z = spawnChunk.z
-        };
-
-        if (!cdsurvival_SendChunk(server, player, &coords)) {
-            return false;
-        }
-
-        for (int r = 1; r <= maxRadius; r++) {
-            int j,k;
-
-            j = k = -r;
-
-            for (; j <= r; j++) {
-                coords.x = spawnChunk.x+j;
-                coords.z = spawnChunk.z+k;
-                if (!cdsurvival_SendChunk(server, player, &coords))
-                    return false;
-            }
-
-            for (j = r, k+=1; k <= r; k++) {
-                coords.x = spawnChunk.x+j;
-                coords.z = spawnChunk.z+k;
-                if (!cdsurvival_SendChunk(server, player, &coords))
-                    return false;
-            }
-
-
-            for (k = r, j-=1; j >= -r; j--) {
-                coords.x = spawnChunk.x+j;
-                coords.z = spawnChunk.z+k;
-                if (!cdsurvival_SendChunk(server, player, &coords))
-                    return false;
-            }
-
-
-            for (j = -r, k-=1; k > -r; k--) {
-                coords.x = spawnChunk.x+j;
-                coords.z = spawnChunk.z+k;
-                if (!cdsurvival_SendChunk(server, player, &coords))
-                    return false;
-            }
-        }
-    }
+    // Stream the chunks around the spawn, nearest first, without holding the worker
+    cdsurvival_SendChunkRadius(player, &spawnChunk);
 
     return true;
 }
@@ -859,10 +877,19 @@ cdsurvival_PlayerPreLogin (CDServer* server, SVPlayer* player)
         SV_PlayerSendPacket(player, &packet);
 	}
 
-	CD_DynamicPut(player, "Player.loadedChunks", (CDPointer) CD_CreateSetWith(
-		400, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition));
+	DO {
+		SVChunkView* view = SV_CreateChunkView(_config.view.radius, _config.view.margin, _config.view.grace);
+
+		CD_DynamicPut(player, "Player.chunkView", (CDPointer) view);
+		CD_DynamicPut(player, "Player.chunks", (CDPointer) CD_CreateMap());
+		CD_DynamicPut(player, "Player.chunkQueue", (CDPointer) cdsurvival_CreateChunkQueue(view->order.length));
+	}
 
-	CD_DynamicPut(player, "Player.seenPlayers", (CDPointer) CD_CreateList());
+	pthread_mutex_lock(&_tracker.lock);
+	CD_DynamicPut(player, "Player.tracked", (CDPointer) cdsurvival_CreateTracked(player));
+	CD_DynamicPut(player, "Player.tiers", (CDPointer) CD_CreateMap());
+	CD_DynamicPut(player, "Player.visible", (CDPointer) CD_CreateMap());
+	pthread_mutex_unlock(&_tracker.lock);
 
 	SVChunkPosition playerChunk = SV_PrecisePositionToChunkPosition(player->entity.position);
 
@@ -879,28 +906,63 @@ cdsurvival_PlayerLogout (CDServer* server, SVPlayer* player)
 {
 	assert(player);
 
-	CDList* seenPlayers = (CDList*) CD_DynamicDelete(player, "Player.seenPlayers");
+	// out of the world first so the tracker stops looking at it as an observer
+	SV_WorldRemovePlayer(player->world, player);
+
+	pthread_mutex_lock(&_tracker.lock);
 
-	if (seenPlayers) {
-		CD_LIST_FOREACH(seenPlayers, it) {
-			SVPlayer* other            = (SVPlayer*) CD_ListIteratorValue(it);
-			CDList*   otherSeenPlayers = (CDList*) CD_DynamicGet(other, "Player.seenPlayers");
+	CDMap* visible = (CDMap*) CD_DynamicDelete(player, "Player.visible");
+
+	if (visible) {
+		CD_MAP_FOREACH(visible, it) {
+			SVPlayer* other        = (SVPlayer*) CD_MapIteratorValue(it);
+			CDMap*    otherVisible = (CDMap*) CD_DynamicGet(other, "Player.visible");
 
 			cdsurvival_SendDestroyEntity(other, &player->entity);
-			CD_ListDeleteAll(otherSeenPlayers, (CDPointer) player);
+			CD_MapDelete(otherVisible, player->entity.id);
+
+			cdsurvival_TrackerForget(other, player);
 		}
 
-		CD_DestroyList(seenPlayers);
+		CD_DestroyMap(visible);
 	}
 
-	CDSet* chunks = (CDSet*) CD_DynamicDelete(player, "Player.loadedChunks");
+	CDMap* tiers = (CDMap*) CD_DynamicDelete(player, "Player.tiers");
 
-	if (chunks) {
-		CD_SetMap(chunks, (CDSetApply) cdsurvival_ChunkMemberFree, CDNull);
-		CD_DestroySet(chunks);
+	if (tiers) {
+		CD_DestroyMap(tiers);
 	}
 
-	SV_WorldRemovePlayer(player->world, player);
+	CDSurvivalTracked* tracked = (CDSurvivalTracked*) CD_DynamicDelete(player, "Player.tracked");
+
+	if (tracked) {
+		cdsurvival_DestroyTracked(tracked);
+	}
+
+	pthread_mutex_unlock(&_tracker.lock);
+
+	CDSurvivalChunkQueue* queue = (CDSurvivalChunkQueue*) CD_DynamicDelete(player, "Player.chunkQueue");
+
+	if (queue) {
+		cdsurvival_DestroyChunkQueue(queue);
+	}
+
+	SVChunkView* view = (SVChunkView*) CD_DynamicDelete(player, "Player.chunkView");
+
+	if (view) {
+		SDEBUG(server, "%s kept %" PRIu64 " chunks loaded across boundary crossings", CD_StringContent(player->username), view->stats.kept);
+
+		CD_AtomicAdd(&_stats.kept, view->stats.kept);
+
+		SV_ChunkViewClear(view, (SVChunkViewCallback) cdsurvival_ChunkRelease, (CDPointer) player);
+		SV_DestroyChunkView(view);
+	}
+
+	CDMap* chunks = (CDMap*) CD_DynamicDelete(player, "Player.chunks");
+
+	if (chunks) {
+		CD_DestroyMap(chunks);
+	}
 
 	return true;
 }
@@ -36,6 +36,26 @@ static struct {
 	pthread_mutex_t login;
 } _lock;
 
+// packets that never change, encoded once when the plugin is loaded
+static struct {
+	CDSharedBuffer* keepAlive;
+} _cache;
+
+static struct {
+	struct {
+		int radius;
+		int margin;
+		int grace;
+	} view;
+} _config;
+
+static struct {
+	uint64_t kept;
+} _stats;
+
+// Sends how players move to the ones seeing them, once a tick
+#include "tracker.c"
+
 #include "callbacks.c"
 
 //Callbacks specific to player inventory management
@@ -96,17 +116,47 @@ static
 void
 cdsurvival_KeepAlive (void* _, void* __, CDServer* server)
 {
-	SVPacketKeepAlive pkt;
-	pkt.keepAliveID = 0;
+	CD_LIST_FOREACH(server->clients, it) {
+		CD_ClientSendSharedBuffer((CDClient*) CD_ListIteratorValue(it), _cache.keepAlive);
+	}
+}
 
-	SVPacket  packet = { SVResponse, SVKeepAlive, (CDPointer) &pkt };
-	CDBuffer* buffer = SV_PacketToBuffer(&packet);
+/* Seconds between two flushes of the changed blocks */
+#define CDSURVIVAL_CHANGES_TICK 0.05
 
-	CD_LIST_FOREACH(server->clients, it) {
-		CD_ClientSendBuffer((CDClient*) CD_ListIteratorValue(it), buffer);
+/**
+ * Send the changes in a chunk to the players that have it loaded
+ */
+static
+void
+cdsurvival_SendChanges (SVWorld* world, SVChunkPosition position, CDSharedBuffer* packet, CDPointer _)
+{
+	SV_ChunkBroadcastSharedBuffer(world, position, packet);
+}
+
+static
+void
+cdsurvival_FlushChanges (void* _, void* __, CDServer* server)
+{
+	CDList* worlds = (CDList*) CD_DynamicGet(server, "World.list");
+
+	CD_LIST_FOREACH(worlds, it) {
+		SV_WorldFlushChanges((SVWorld*) CD_ListIteratorValue(it), cdsurvival_SendChanges, CDNull);
 	}
+}
+
+/* Seconds between two saves of the changed chunks, far apart so the flushes stay light */
+#define CDSURVIVAL_SAVE_TICK 30
+
+static
+void
+cdsurvival_SaveWorlds (void* _, void* __, CDServer* server)
+{
+	CDList* worlds = (CDList*) CD_DynamicGet(server, "World.list");
 
-	CD_DestroyBuffer(buffer);
+	CD_LIST_FOREACH(worlds, it) {
+		SV_WorldSave((SVWorld*) CD_ListIteratorValue(it));
+	}
 }
 
 static
@@ -188,12 +238,51 @@ CD_PluginInitialize (CDPlugin* self)
 
 	CD_InitializeSurvivalProtocol(self->server);
 
+	DO { // Initialize configuration stuff
+		_config.view.radius = 10;
+		_config.view.margin = 2;
+		_config.view.grace  = 5;
+
+		C_SAVE(C_PATH(self->config, "view.radius"), C_INT, _config.view.radius);
+		C_SAVE(C_PATH(self->config, "view.margin"), C_INT, _config.view.margin);
+		C_SAVE(C_PATH(self->config, "view.grace"), C_INT, _config.view.grace);
+
+		if (_config.view.radius < 1 || _config.view.radius >= SV_CHUNK_VIEW_SIZE / 2) {
+			_config.view.radius = 10;
+		}
+
+		if (_config.view.margin < 0 || _config.view.radius + _config.view.margin >= SV_CHUNK_VIEW_SIZE / 2) {
+			_config.view.margin = SV_CHUNK_VIEW_SIZE / 2 - 1 - _config.view.radius;
+		}
+
+		if (_config.view.grace < 0) {
+			_config.view.grace = 0;
+		}
+	}
+
 	pthread_mutex_init(&_lock.login, NULL);
 
+	DO {
+		SVPacketKeepAlive pkt = {
+			.keepAliveID = 0
+		};
+
+		SVPacket packet = { SVResponse, SVKeepAlive, (CDPointer) &pkt };
+
+		_cache.keepAlive = SV_PacketToSharedBuffer(&packet);
+	}
+
 	CD_DynamicPut(self, "Event.timeIncrease", CD_SetInterval(self->server->timeloop, 1,  (event_callback_fn) cdsurvival_TimeIncrease, CDNull));
 	CD_DynamicPut(self, "Event.timeUpdate",   CD_SetInterval(self->server->timeloop, 30, (event_callback_fn) cdsurvival_TimeUpdate, CDNull));
 	CD_DynamicPut(self, "Event.keepAlive",    CD_SetInterval(self->server->timeloop, 10, (event_callback_fn) cdsurvival_KeepAlive, CDNull));
 
+	pthread_mutex_init(&_tracker.lock, NULL);
+	_tracker.batch = CD_CreatePacketBatch();
+
+	CD_DynamicPut(self, "Event.tracker", CD_SetInterval(self->server->timeloop, CDSURVIVAL_TRACKER_TICK, (event_callback_fn) cdsurvival_TrackerTick, CDNull));
+	CD_DynamicPut(self, "Event.changes", CD_SetInterval(self->server->timeloop, CDSURVIVAL_CHANGES_TICK, (event_callback_fn) cdsurvival_FlushChanges, CDNull));
+	CD_DynamicPut(self, "Event.save",    CD_SetInterval(self->server->timeloop, CDSURVIVAL_SAVE_TICK, (event_callback_fn) cdsurvival_SaveWorlds, CDNull));
+
 	#ifdef HAVE_JSON
 	CD_EventRegister(self->server, "RPC.JSON", cdsurvival_JSON);
 	#endif
@@ -237,6 +326,21 @@ CD_PluginFinalize (CDPlugin* self)
 	CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.timeIncrease"));
 	CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.timeUpdate"));
 	CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.keepAlive"));
+	CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.tracker"));
+	CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.changes"));
+	CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.save"));
+
+	CD_DestroyPacketBatch(_tracker.batch);
+	pthread_mutex_destroy(&_tracker.lock);
+
+	SLOG(self->server, LOG_INFO, "entity tracker: %" PRIu64 " updates, %" PRIu64 " teleports, %" PRIu64 " resyncs, "
+		"%" PRIu64 "/%" PRIu64 "/%" PRIu64 " packets sent to near/middle/far observers",
+		_tracker.stats.updates, _tracker.stats.teleports, _tracker.stats.resyncs,
+		_tracker.stats.sent[0], _tracker.stats.sent[1], _tracker.stats.sent[2]);
+
+	CD_DestroySharedBuffer(_cache.keepAlive);
+
+	SLOG(self->server, LOG_INFO, "chunk views: %" PRIu64 " chunks kept loaded across boundary crossings", _stats.kept);
 
 	#ifdef HAVE_JSON
 	CD_EventUnregister(self->server, "RPC.JSON", cdsurvival_JSON);
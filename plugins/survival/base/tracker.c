@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * The entity tracker. Instead of relaying every movement packet as it comes,
+ * what observers were last told about each player is compared to where the
+ * player is, and the smallest packet describing the change is queued to
+ * everyone seeing it in one batch per observer.
+ *
+ * Observers are put in tiers by how far they are from what they see, the
+ * farther ones get updates less often. Each tier keeps its own idea of
+ * where players are so their updates stay consistent, an observer changing
+ * tier gets a teleport to the state of the new one.
+ *
+ * The tick runs on the timeloop while logins, logouts and view changes run
+ * on workers, so Player.visible, Player.tiers and Player.tracked are only
+ * touched with the tracker lock held.
+ */
+
+/* Seconds between two ticks of the tracker */
+#define CDSURVIVAL_TRACKER_TICK 0.05
+
+/* Ticks between two teleports, they correct whatever the relative moves got wrong */
+#define CDSURVIVAL_TRACKER_TELEPORT 400
+
+/* Blocks past the border of a tier an observer has to go to change tier */
+#define CDSURVIVAL_TRACKER_SLACK 4
+
+/* Near, middle and far */
+#define CDSURVIVAL_TRACKER_TIERS 3
+
+typedef struct _CDSurvivalTrackedState {
+	/// What observers in the tier were last told
+	SVAbsolutePosition position;
+	SVByte             yaw;
+	SVByte             pitch;
+
+	unsigned int teleported;
+
+	/// The update for the current tick, encoded once for every observer
+	CDBuffer*    update;
+	unsigned int tick;
+
+	/// A teleport to the state, for observers just entering the tier
+	CDBuffer*    resync;
+	unsigned int resynced;
+} CDSurvivalTrackedState;
+
+typedef struct _CDSurvivalTracked {
+	CDSurvivalTrackedState tiers[CDSURVIVAL_TRACKER_TIERS];
+} CDSurvivalTracked;
+
+static struct {
+	pthread_mutex_t lock;
+
+	CDPacketBatch* batch;
+	unsigned int   tick;
+
+	struct {
+		uint64_t updates;
+		uint64_t teleports;
+		uint64_t resyncs;
+		uint64_t sent[CDSURVIVAL_TRACKER_TIERS];
+	} stats;
+} _tracker;
+
+static
+CDSurvivalTracked*
+cdsurvival_CreateTracked (SVPlayer* player)
+{
+	CDSurvivalTracked* self = CD_malloc(sizeof(CDSurvivalTracked));
+
+	for (int i = 0; i < CDSURVIVAL_TRACKER_TIERS; i++) {
+		CDSurvivalTrackedState* state = &self->tiers[i];
+
+		state->position   = SV_PrecisePositionToAbsolutePosition(player->entity.position);
+		state->yaw        = SV_AngleToByte(player->yaw);
+		state->pitch      = SV_AngleToByte(player->pitch);
+		state->teleported = _tracker.tick;
+		state->update     = NULL;
+		state->tick       = _tracker.tick;
+		state->resync     = NULL;
+		state->resynced   = _tracker.tick;
+	}
+
+	return self;
+}
+
+static
+void
+cdsurvival_DestroyTracked (CDSurvivalTracked* self)
+{
+	for (int i = 0; i < CDSURVIVAL_TRACKER_TIERS; i++) {
+		if (self->tiers[i].update) {
+			CD_DestroyBuffer(self->tiers[i].update);
+		}
+
+		if (self->tiers[i].resync) {
+			CD_DestroyBuffer(self->tiers[i].resync);
+		}
+	}
+
+	CD_free(self);
+}
+
+static
+CDBuffer*
+cdsurvival_TrackedTeleport (CDSurvivalTrackedState* self, SVPlayer* player)
+{
+	SVPacketEntityTeleport pkt = {
+		.response = {
+			.entity   = player->entity,
+			.position = self->position,
+			.rotation = self->yaw,
+			.pitch    = self->pitch
+		}
+	};
+
+	SVPacket packet = { SVResponse, SVEntityTeleport, (CDPointer) &pkt };
+
+	return SV_PacketToBuffer(&packet);
+}
+
+/**
+ * Encode the change since what observers in a tier were last told and
+ * remember it as told
+ *
+ * @return The encoded packet or NULL if nothing changed
+ */
+static
+CDBuffer*
+cdsurvival_TrackedEncode (CDSurvivalTrackedState* self, SVPlayer* player)
+{
+	SVAbsolutePosition position = SV_PrecisePositionToAbsolutePosition(player->entity.position);
+	SVByte             yaw      = SV_AngleToByte(player->yaw);
+	SVByte             pitch    = SV_AngleToByte(player->pitch);
+	CDBuffer*          result   = NULL;
+
+	int dx = position.x - self->position.x;
+	int dy = position.y - self->position.y;
+	int dz = position.z - self->position.z;
+
+	bool moved  = dx || dy || dz;
+	bool looked = yaw != self->yaw || pitch != self->pitch;
+
+	// relative moves only go up to 4 blocks on each axis
+	bool far = dx < INT8_MIN || dx > INT8_MAX || dy < INT8_MIN || dy > INT8_MAX || dz < INT8_MIN || dz > INT8_MAX;
+
+	if (far || _tracker.tick - self->teleported >= CDSURVIVAL_TRACKER_TELEPORT) {
+		self->position   = position;
+		self->yaw        = yaw;
+		self->pitch      = pitch;
+		self->teleported = _tracker.tick;
+
+		_tracker.stats.teleports++;
+
+		return cdsurvival_TrackedTeleport(self, player);
+	}
+	else if (moved && looked) {
+		SVPacketEntityLookMove pkt = {
+			.response = {
+				.entity   = player->entity,
+				.position = { dx, dy, dz },
+				.yaw      = yaw,
+				.pitch    = pitch
+			}
+		};
+
+		SVPacket packet = { SVResponse, SVEntityLookMove, (CDPointer) &pkt };
+
+		result = SV_PacketToBuffer(&packet);
+	}
+	else if (moved) {
+		SVPacketEntityRelativeMove pkt = {
+			.response = {
+				.entity   = player->entity,
+				.position = { dx, dy, dz }
+			}
+		};
+
+		SVPacket packet = { SVResponse, SVEntityRelativeMove, (CDPointer) &pkt };
+
+		result = SV_PacketToBuffer(&packet);
+	}
+	else if (looked) {
+		SVPacketEntityLook pkt = {
+			.response = {
+				.entity = player->entity,
+				.yaw    = yaw,
+				.pitch  = pitch
+			}
+		};
+
+		SVPacket packet = { SVResponse, SVEntityLook, (CDPointer) &pkt };
+
+		result = SV_PacketToBuffer(&packet);
+	}
+	else {
+		return NULL;
+	}
+
+	self->position = position;
+	self->yaw      = yaw;
+	self->pitch    = pitch;
+
+	_tracker.stats.updates++;
+
+	return result;
+}
+
+static
+int
+cdsurvival_TrackerPeriod (SVWorld* world, int tier)
+{
+	switch (tier) {
+		case 0:  return world->config.cache.tracking.near.period;
+		case 1:  return world->config.cache.tracking.middle.period;
+		default: return world->config.cache.tracking.far.period;
+	}
+}
+
+/**
+ * Get the tier an observer is in for a player, it has to go a bit past the
+ * border of its previous tier to change so walking along it doesn't keep
+ * switching.
+ *
+ * @param previous The previous tier, -1 if there's none
+ */
+static
+int
+cdsurvival_TrackerTier (SVWorld* world, SVPlayer* observer, SVPlayer* player, int previous)
+{
+	double near   = world->config.cache.tracking.near.distance;
+	double middle = world->config.cache.tracking.middle.distance;
+
+	double dx = observer->entity.position.x - player->entity.position.x;
+	double dy = observer->entity.position.y - player->entity.position.y;
+	double dz = observer->entity.position.z - player->entity.position.z;
+
+	double distance = dx * dx + dy * dy + dz * dz;
+
+	if (previous == 0) {
+		near += CDSURVIVAL_TRACKER_SLACK;
+	}
+	else if (previous == 1) {
+		near   -= CDSURVIVAL_TRACKER_SLACK;
+		middle += CDSURVIVAL_TRACKER_SLACK;
+	}
+	else if (previous == 2) {
+		middle -= CDSURVIVAL_TRACKER_SLACK;
+	}
+
+	if (near > 0 && distance < near * near) {
+		return 0;
+	}
+
+	if (middle > 0 && distance < middle * middle) {
+		return 1;
+	}
+
+	return 2;
+}
+
+/**
+ * Get the update of a player for a tier in the current tick, it's encoded
+ * the first time an observer in the tier asks for it. Tiers only look at the
+ * player every period ticks, so once it stops its last state goes out at the
+ * next one.
+ */
+static
+CDBuffer*
+cdsurvival_TrackedUpdate (SVWorld* world, SVPlayer* player, CDSurvivalTracked* tracked, int tier)
+{
+	CDSurvivalTrackedState* self = &tracked->tiers[tier];
+
+	if (self->tick == _tracker.tick) {
+		return self->update;
+	}
+
+	if (self->update) {
+		CD_DestroyBuffer(self->update);
+		self->update = NULL;
+	}
+
+	// staggered by entity so the players of a tier aren't all looked at on the same tick
+	if ((_tracker.tick + (unsigned int) player->entity.id) % cdsurvival_TrackerPeriod(world, tier) == 0) {
+		self->update = cdsurvival_TrackedEncode(self, player);
+	}
+
+	self->tick = _tracker.tick;
+
+	return self->update;
+}
+
+static
+CDBuffer*
+cdsurvival_TrackedResync (SVPlayer* player, CDSurvivalTracked* tracked, int tier)
+{
+	CDSurvivalTrackedState* self = &tracked->tiers[tier];
+
+	if (!self->resync || self->resynced != _tracker.tick) {
+		if (self->resync) {
+			CD_DestroyBuffer(self->resync);
+		}
+
+		self->resync   = cdsurvival_TrackedTeleport(self, player);
+		self->resynced = _tracker.tick;
+
+		_tracker.stats.resyncs++;
+	}
+
+	return self->resync;
+}
+
+/**
+ * Forget the tier an observer was in for a player it doesn't see anymore,
+ * the tracker lock has to be held
+ */
+static
+void
+cdsurvival_TrackerForget (SVPlayer* observer, SVPlayer* player)
+{
+	CDMap* tiers = (CDMap*) CD_DynamicGet(observer, "Player.tiers");
+
+	if (tiers) {
+		CD_MapDelete(tiers, player->entity.id);
+	}
+}
+
+static
+void
+cdsurvival_TrackerTick (void* _, void* __, CDServer* server)
+{
+	CDList* worlds = (CDList*) CD_DynamicGet(server, "World.list");
+
+	pthread_mutex_lock(&_tracker.lock);
+
+	_tracker.tick++;
+
+	CD_LIST_FOREACH(worlds, it) {
+		SVWorld* world = (SVWorld*) CD_ListIteratorValue(it);
+
+		CD_HASH_FOREACH(world->players, jt) {
+			SVPlayer* observer = (SVPlayer*) CD_HashIteratorValue(jt);
+			CDMap*    visible  = (CDMap*) CD_DynamicGet(observer, "Player.visible");
+			CDMap*    tiers    = (CDMap*) CD_DynamicGet(observer, "Player.tiers");
+
+			if (!visible || !tiers || CD_ClientGetStatus(observer->client) == CDClientDisconnect) {
+				continue;
+			}
+
+			CD_MAP_FOREACH(visible, kt) {
+				SVPlayer*          player  = (SVPlayer*) CD_MapIteratorValue(kt);
+				CDSurvivalTracked* tracked = (CDSurvivalTracked*) CD_DynamicGet(player, "Player.tracked");
+
+				if (!tracked) {
+					continue;
+				}
+
+				int       previous = (int) CD_MapGet(tiers, player->entity.id) - 1;
+				int       tier     = cdsurvival_TrackerTier(world, observer, player, previous);
+				CDBuffer* update   = cdsurvival_TrackedUpdate(world, player, tracked, tier);
+
+				// the observer knows the state of its previous tier, move it to the new one
+				if (tier != previous) {
+					CD_MapPut(tiers, player->entity.id, (CDPointer) (tier + 1));
+
+					update = cdsurvival_TrackedResync(player, tracked, tier);
+				}
+
+				if (update) {
+					CD_PacketBatchAddCopy(_tracker.batch, update);
+
+					_tracker.stats.sent[tier]++;
+				}
+			}
+
+			CD_PacketBatchSend(_tracker.batch, observer->client);
+		}
+	}
+
+	pthread_mutex_unlock(&_tracker.lock);
+}
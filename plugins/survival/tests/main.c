@@ -28,6 +28,9 @@
 
 #include <craftd/protocols/survival.h>
 
+#include <time.h>
+#include <zlib.h>
+
 #include "tinytest/tinytest.h"
 #include "tinytest/tinytest_macros.h"
 
@@ -502,70 +505,1628 @@ static struct testcase_t cd_utils_Regexp_tests[] = {
 	END_OF_TESTCASES
 };
 
+static
+void*
+cdtest_Slab_thread (void* pool)
+{
+	void* a = CD_SlabAlloc(pool);
+	void* b = CD_SlabAlloc(pool);
+
+	CD_SlabFree(pool, a);
+	CD_SlabFree(pool, b);
+
+	return NULL;
+}
+
 static
 void
-cdtest_events_provided (void* data)
+cdtest_Slab_reuse (void* data)
 {
-	puts("\n---");
+	CDSlabPool* pool = CD_CreateSlabPool(100000, true);
+	void*       slabs[8];
+	pthread_t   thread;
 
-	CD_HASH_FOREACH(_server->event.provided, it) {
-		CDString* output  = CD_CreateStringFromFormat("%s (", (char*) CD_HashIteratorKey(it));
-		CDList*   params  = (CDList*) CD_HashIteratorValue(it);
-		int       length  = CD_ListLength(params);
-		int       current = 1;
+	for (size_t i = 0; i < ARRAY_SIZE(slabs); i++) {
+		slabs[i] = CD_SlabAlloc(pool);
 
-		CD_LIST_FOREACH(params, it) {
-			output = CD_AppendCString(output, (char*) CD_ListIteratorValue(it));
+		tt_int_op((uintptr_t) slabs[i] % 64, ==, 0);
+		memset(slabs[i], i, 100000);
+	}
 
-			if (current < length) {
-				output = CD_AppendCString(output, ", ");
-			}
+	tt_int_op(pool->stats.live, ==, 8);
+	tt_int_op(pool->blocks.length, ==, 1);
 
-			current++;
-		}
+	for (size_t i = 0; i < ARRAY_SIZE(slabs); i++) {
+		CD_SlabFree(pool, slabs[i]);
+	}
 
-		output = CD_AppendCString(output, ")");
+	tt_int_op(pool->stats.live, ==, 0);
+	tt_int_op(pool->stats.cached, ==, 8);
 
-		puts(CD_StringContent(output));
+	// the thread's slabs come back to the pool when it exits
+	pthread_create(&thread, NULL, cdtest_Slab_thread, pool);
+	pthread_join(thread, NULL);
 
-		CD_DestroyString(output);
+	tt_int_op(pool->stats.cached, ==, 8);
+	tt_assert(pool->caches && pool->caches->next == NULL);
+
+	for (size_t i = 0; i < ARRAY_SIZE(slabs); i++) {
+		slabs[i] = CD_SlabAlloc(pool);
 	}
 
-	puts("---");
+	tt_int_op(pool->stats.live, ==, 8);
+	tt_int_op(pool->stats.cached, ==, 0);
+	tt_int_op(pool->blocks.length, ==, 1);
 
 	end: {
+		CD_DestroySlabPool(pool);
+	}
+}
+
+static struct testcase_t cd_utils_Slab_tests[] = {
+	{ "reuse", cdtest_Slab_reuse, },
+
+	END_OF_TESTCASES
+};
+
+/* Transcode UTF-8 to UCS-2 and back, checking the length agrees with the transcoding */
+static
+bool
+cdtest_TranscodeRoundTrip (const uint8_t* input, size_t size)
+{
+	uint8_t ucs2[256];
+	uint8_t utf8[384];
+	size_t  length;
+
+	assert(size * 2 <= sizeof(ucs2));
+
+	length = SV_UTF8ToUCS2(input, size, ucs2);
 
+	if (length != SV_UTF8ToUCS2Length(input, size)) {
+		return false;
 	}
+
+	return SV_UCS2ToUTF8(ucs2, length, utf8) == size && memcmp(utf8, input, size) == 0;
 }
 
-static struct testcase_t cd_events_tests[] = {
-	{ "provided", cdtest_events_provided, },
+static
+void
+cdtest_Transcode_ascii (void* data)
+{
+	uint8_t input[64];
+	uint8_t output[128];
+
+	for (size_t i = 0; i < sizeof(input); i++) {
+		input[i] = 'a' + (i % 26);
+	}
+
+	// runs around the 16 characters and 8 characters vector widths
+	for (size_t size = 0; size <= 40; size++) {
+		tt_int_op(SV_UTF8ToUCS2(input, size, output), ==, size);
+
+		for (size_t i = 0; i < size; i++) {
+			tt_int_op(output[i * 2],     ==, 0);
+			tt_int_op(output[i * 2 + 1], ==, input[i]);
+		}
+
+		tt_assert(cdtest_TranscodeRoundTrip(input, size));
+	}
+
+	// a 2 byte sequence in every position of a run breaks the vectors there
+	for (size_t at = 0; at < 39; at++) {
+		uint8_t mixed[40];
+
+		memcpy(mixed, input, sizeof(mixed));
+		mixed[at]     = 0xC3;
+		mixed[at + 1] = 0xA9;
+
+		tt_int_op(SV_UTF8ToUCS2(mixed, sizeof(mixed), output), ==, sizeof(mixed) - 1);
+		tt_int_op(output[at * 2],     ==, 0x00);
+		tt_int_op(output[at * 2 + 1], ==, 0xE9);
+
+		if (at + 2 < sizeof(mixed)) {
+			tt_int_op(output[(at + 1) * 2 + 1], ==, mixed[at + 2]);
+		}
+
+		tt_assert(cdtest_TranscodeRoundTrip(mixed, sizeof(mixed)));
+	}
+
+	end: {}
+}
+
+static
+void
+cdtest_Transcode_sequences (void* data)
+{
+	// é, € and 中
+	const uint8_t input[]    = { 'x', 0xC3, 0xA9, 0xE2, 0x82, 0xAC, 0xE4, 0xB8, 0xAD, 'y' };
+	const uint8_t expected[] = { 0x00, 'x', 0x00, 0xE9, 0x20, 0xAC, 0x4E, 0x2D, 0x00, 'y' };
+	uint8_t       output[sizeof(input) * 2];
+
+	tt_int_op(SV_UTF8ToUCS2(input, sizeof(input), output), ==, 5);
+	tt_assert(memcmp(output, expected, sizeof(expected)) == 0);
+
+	tt_assert(cdtest_TranscodeRoundTrip(input, sizeof(input)));
+
+	end: {}
+}
+
+static
+void
+cdtest_Transcode_invalid (void* data)
+{
+	struct {
+		const char* input;
+		size_t      length;
+	} replaced[] = {
+		{ "\xE2\x82",         2 }, // truncated, the lead and the continuation are replaced on their own
+		{ "\xC3",             1 }, // truncated
+		{ "\x80",             1 }, // continuation without a lead
+		{ "\xFF",             1 }, // never valid
+		{ "\xC3" "A",         2 }, // the lead is replaced and the next character kept
+		{ "\xF0\x9F\x98\x80", 1 }  // outside the BMP
+	};
+
+	uint8_t output[16];
+	uint8_t back[24];
+
+	for (size_t i = 0; i < sizeof(replaced) / sizeof(replaced[0]); i++) {
+		const uint8_t* input = (const uint8_t*) replaced[i].input;
+		size_t         size  = strlen(replaced[i].input);
+
+		tt_int_op(SV_UTF8ToUCS2(input, size, output), ==, replaced[i].length);
+		tt_int_op(SV_UTF8ToUCS2Length(input, size), ==, replaced[i].length);
+
+		tt_int_op(output[0], ==, 0xFF);
+		tt_int_op(output[1], ==, 0xFD);
+
+		// U+FFFD goes back as ?
+		tt_int_op(SV_UCS2ToUTF8(output, 1, back), ==, 1);
+		tt_int_op(back[0], ==, '?');
+	}
+
+	end: {}
+}
+
+static
+void
+cdtest_Transcode_reverse (void* data)
+{
+	// U+FFFD becomes ? and U+FFFF is dropped, runs around the vector width included
+	uint8_t input[2 * 20];
+	uint8_t output[3 * 20];
+
+	for (size_t i = 0; i < 20; i++) {
+		input[i * 2]     = 0x00;
+		input[i * 2 + 1] = 'A' + i;
+	}
+
+	input[3 * 2]  = 0xFF; input[3 * 2 + 1]  = 0xFD;
+	input[11 * 2] = 0xFF; input[11 * 2 + 1] = 0xFF;
+
+	tt_int_op(SV_UCS2ToUTF8(input, 20, output), ==, 19);
+	tt_int_op(output[3],  ==, '?');
+	tt_int_op(output[10], ==, 'A' + 10);
+	tt_int_op(output[11], ==, 'A' + 12);
+	tt_int_op(output[18], ==, 'A' + 19);
+
+	end: {}
+}
+
+static struct testcase_t cd_protocols_survival_Buffer_tests[] = {
+	{ "transcode/ascii",     cdtest_Transcode_ascii, },
+	{ "transcode/sequences", cdtest_Transcode_sequences, },
+	{ "transcode/invalid",   cdtest_Transcode_invalid, },
+	{ "transcode/reverse",   cdtest_Transcode_reverse, },
 
 	END_OF_TESTCASES
 };
 
-static struct testgroup_t cd_groups[] = {
-	{ "utils/String/",           cd_utils_String_tests },
-	{ "utils/String/UTF8/",      cd_utils_String_UTF8_tests },
-	{ "utils/String/Minecraft/", cd_utils_String_Minecraft_tests },
-	{ "utils/Hash/",             cd_utils_Hash_tests },
-	{ "utils/Map/",              cd_utils_Map_tests },
-	{ "utils/List/",             cd_utils_List_tests },
-	{ "utils/Set/",              cd_utils_Set_tests },
-	{ "utils/Regexp/",           cd_utils_Regexp_tests },
+/* An EntityMetadata request with one entry of every type */
+static const uint8_t cdtest_PacketMetadata[] = {
+	0x28, 0x00, 0x00, 0x00, 0x2A,
+	0x00, 0x05,
+	0x20, 0x01, 0x02,
+	0x80, 0x00, 0x03, 'a', 'b', 'c',
+	0xA0, 0x00, 0x01, 0x02, 0x00, 0x03,
+	0xC0, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03,
+	0x7F
+};
 
-//    { "events/", cd_events_tests },
+/* A WindowItems response with an empty slot between two items */
+static const uint8_t cdtest_PacketWindowItems[] = {
+	0x68, 0x01, 0x00, 0x03,
+	0x00, 0x05, 0x02, 0x00, 0x00,
+	0xFF, 0xFF,
+	0x01, 0x00, 0x01, 0x00, 0x07
+};
 
-	END_OF_GROUPS
+/* An UpdateSign request with lines of 2, 0, 1 and 3 characters */
+static const uint8_t cdtest_PacketUpdateSign[] = {
+	0x82, 0x00, 0x00, 0x00, 0x01, 0x00, 0x40, 0x00, 0x00, 0x00, 0x02,
+	0x00, 0x02, 0x00, 'h', 0x00, 'i',
+	0x00, 0x00,
+	0x00, 0x01, 0x00, 'x',
+	0x00, 0x03, 0x00, 'a', 0x00, 'b', 0x00, 'c'
+};
+
+static const uint8_t cdtest_PacketKeepAlive[] = {
+	0x00, 0x00, 0x00, 0x00, 0x17
 };
 
+/* Append data in pieces of step bytes, each in its own evbuffer chain */
+static
+void
+cdtest_PacketAdd (CDBuffers* buffers, const uint8_t* data, size_t size, size_t step)
+{
+	for (size_t offset = 0; offset < size; offset += step) {
+		evbuffer_add_reference(buffers->input->raw, data + offset, (offset + step < size) ? step : size - offset, NULL, NULL);
+	}
+}
+
+/* Feed a packet one byte at a time, it has to be parsable with the last byte and not before */
+static
 bool
-CD_PluginInitialize (CDPlugin* self)
+cdtest_PacketFeed (CDBuffers* buffers, const uint8_t* data, size_t size)
 {
-	puts("");
+	for (size_t i = 0; i < size; i++) {
+		cdtest_PacketAdd(buffers, data + i, 1, 1);
+
+		if (SV_PacketParsable(buffers) != (i == size - 1)) {
+			return false;
+		}
+
+		// the low watermark is never below what's needed to go on
+		if (i < size - 1 && (errno != EAGAIN || ((SVPacketParser*) buffers->parser)->needed <= i + 1)) {
+			return false;
+		}
+	}
+
+	evbuffer_drain(buffers->input->raw, size);
+
+	return true;
+}
+
+static
+void
+cdtest_PacketLength_bytewise (void* data)
+{
+	struct event_base*  base    = event_base_new();
+	struct bufferevent* raw     = bufferevent_socket_new(base, -1, 0);
+	CDBuffers*          buffers = CD_WrapBuffers(raw);
+
+	// the tests play the socket, bufferevents only let the socket add input
+	evbuffer_unfreeze(buffers->input->raw, 0);
+
+	tt_assert(cdtest_PacketFeed(buffers, cdtest_PacketMetadata, sizeof(cdtest_PacketMetadata)));
+	tt_assert(cdtest_PacketFeed(buffers, cdtest_PacketWindowItems, sizeof(cdtest_PacketWindowItems)));
+	tt_assert(cdtest_PacketFeed(buffers, cdtest_PacketUpdateSign, sizeof(cdtest_PacketUpdateSign)));
+	tt_assert(cdtest_PacketFeed(buffers, cdtest_PacketKeepAlive, sizeof(cdtest_PacketKeepAlive)));
+
+	end: {
+		CD_DestroyBuffers(buffers);
+		bufferevent_free(raw);
+		event_base_free(base);
+	}
+}
+
+static
+void
+cdtest_PacketLength_resume (void* data)
+{
+	struct event_base*  base    = event_base_new();
+	struct bufferevent* raw     = bufferevent_socket_new(base, -1, 0);
+	CDBuffers*          buffers = CD_WrapBuffers(raw);
+	SVPacketParser*     parser;
+
+	// the tests play the socket, bufferevents only let the socket add input
+	evbuffer_unfreeze(buffers->input->raw, 0);
+
+	// the scan stops at the first metadata entry it can't see the type of, or the string length of
+	cdtest_PacketAdd(buffers, cdtest_PacketMetadata, 8, 3);
+	tt_assert(!SV_PacketParsable(buffers));
+	tt_int_op(errno, ==, EAGAIN);
+
+	parser = (SVPacketParser*) buffers->parser;
+
+	tt_int_op(parser->needed, ==, 11);
+
+	cdtest_PacketAdd(buffers, cdtest_PacketMetadata + 8, 4, 2);
+	tt_assert(!SV_PacketParsable(buffers));
+	tt_int_op(parser->needed, ==, 13);
+
+	cdtest_PacketAdd(buffers, cdtest_PacketMetadata + 12, sizeof(cdtest_PacketMetadata) - 12, 5);
+	tt_assert(SV_PacketParsable(buffers));
+	evbuffer_drain(buffers->input->raw, sizeof(cdtest_PacketMetadata));
+
+	// window items resume from the first item that wasn't there
+	cdtest_PacketAdd(buffers, cdtest_PacketWindowItems, 11, 4);
+	tt_assert(!SV_PacketParsable(buffers));
+	tt_int_op(parser->index, ==, 2);
+	tt_int_op(parser->needed, ==, 13);
+
+	cdtest_PacketAdd(buffers, cdtest_PacketWindowItems + 11, 2, 2);
+	tt_assert(!SV_PacketParsable(buffers));
+	tt_assert(parser->complete);
+	tt_int_op(parser->needed, ==, sizeof(cdtest_PacketWindowItems));
+
+	cdtest_PacketAdd(buffers, cdtest_PacketWindowItems + 13, sizeof(cdtest_PacketWindowItems) - 13, 1);
+	tt_assert(SV_PacketParsable(buffers));
+	evbuffer_drain(buffers->input->raw, sizeof(cdtest_PacketWindowItems));
+
+	// nothing is peeked before the fixed part is there, then sign lines are read up to the missing one
+	cdtest_PacketAdd(buffers, cdtest_PacketUpdateSign, 11, 11);
+	tt_assert(!SV_PacketParsable(buffers));
+	tt_int_op(parser->needed, ==, 19);
+
+	cdtest_PacketAdd(buffers, cdtest_PacketUpdateSign + 11, 8, 3);
+	tt_assert(!SV_PacketParsable(buffers));
+	tt_int_op(parser->needed, ==, 21);
+
+	end: {
+		CD_DestroyBuffers(buffers);
+		bufferevent_free(raw);
+		event_base_free(base);
+	}
+}
+
+static
+void
+cdtest_PacketLength_chains (void* data)
+{
+	struct event_base*  base    = event_base_new();
+	struct bufferevent* raw     = bufferevent_socket_new(base, -1, 0);
+	CDBuffers*          buffers = CD_WrapBuffers(raw);
+	SVPacket*           packet  = NULL;
+
+	// the tests play the socket, bufferevents only let the socket add input
+	evbuffer_unfreeze(buffers->input->raw, 0);
+
+	// the packet is decoded from pieces spread over many chains and leaves the next one alone
+	cdtest_PacketAdd(buffers, cdtest_PacketWindowItems, sizeof(cdtest_PacketWindowItems), 3);
+	cdtest_PacketAdd(buffers, cdtest_PacketKeepAlive, sizeof(cdtest_PacketKeepAlive), 2);
+
+	tt_assert(SV_PacketParsable(buffers));
+	tt_assert(packet = SV_PacketFromBuffers(buffers, true));
+	tt_int_op(evbuffer_get_length(buffers->input->raw), ==, sizeof(cdtest_PacketKeepAlive));
+
+	SVPacketWindowItems* items = (SVPacketWindowItems*) packet->data;
+
+	tt_int_op(items->response.length, ==, 3);
+	tt_int_op(items->response.item[0].id, ==, 5);
+	tt_int_op(items->response.item[0].count, ==, 2);
+	tt_int_op(items->response.item[2].id, ==, 256);
+	tt_int_op(items->response.item[2].damage, ==, 7);
+
+	SV_DestroyPacket(packet);
+	packet = NULL;
+
+	tt_assert(SV_PacketParsable(buffers));
+	evbuffer_drain(buffers->input->raw, sizeof(cdtest_PacketKeepAlive));
+
+	cdtest_PacketAdd(buffers, cdtest_PacketUpdateSign, sizeof(cdtest_PacketUpdateSign), 3);
+	cdtest_PacketAdd(buffers, cdtest_PacketMetadata, sizeof(cdtest_PacketMetadata), 4);
+
+	tt_assert(SV_PacketParsable(buffers));
+	tt_assert(packet = SV_PacketFromBuffers(buffers, false));
+	tt_int_op(evbuffer_get_length(buffers->input->raw), ==, sizeof(cdtest_PacketMetadata));
+
+	SVPacketUpdateSign* sign = (SVPacketUpdateSign*) packet->data;
+
+	tt_assert(CD_StringIsEqual(sign->request.first, "hi"));
+	tt_assert(CD_StringIsEqual(sign->request.second, ""));
+	tt_assert(CD_StringIsEqual(sign->request.fourth, "abc"));
+
+	SV_DestroyPacket(packet);
+	packet = NULL;
+
+	tt_assert(SV_PacketParsable(buffers));
+	tt_assert(packet = SV_PacketFromBuffers(buffers, false));
+	tt_int_op(evbuffer_get_length(buffers->input->raw), ==, 0);
+
+	SVPacketEntityMetadata* metadata = (SVPacketEntityMetadata*) packet->data;
+
+	tt_int_op(metadata->request.entity.id, ==, 42);
+	tt_int_op(metadata->request.metadata->length, ==, 5);
+	tt_assert(CD_StringIsEqual(metadata->request.metadata->item[2]->data.S, "abc"));
+	tt_int_op(metadata->request.metadata->item[4]->data.iii.third, ==, 3);
+
+	end: {
+		if (packet) {
+			SV_DestroyPacket(packet);
+		}
+
+		CD_DestroyBuffers(buffers);
+		bufferevent_free(raw);
+		event_base_free(base);
+	}
+}
+
+static
+void
+cdtest_PacketLength_invalid (void* data)
+{
+	struct event_base*  base    = event_base_new();
+	struct bufferevent* raw     = bufferevent_socket_new(base, -1, 0);
+	CDBuffers*          buffers = CD_WrapBuffers(raw);
+	uint8_t             packet[sizeof(cdtest_PacketMetadata)];
+
+	// the tests play the socket, bufferevents only let the socket add input
+	evbuffer_unfreeze(buffers->input->raw, 0);
+
+	// an unknown metadata type can't be skipped
+	memcpy(packet, cdtest_PacketMetadata, sizeof(packet));
+	packet[7] = 0xE0;
+
+	cdtest_PacketAdd(buffers, packet, sizeof(packet), 1);
+
+	tt_assert(!SV_PacketParsable(buffers));
+	tt_int_op(errno, ==, EILSEQ);
+
+	end: {
+		CD_DestroyBuffers(buffers);
+		bufferevent_free(raw);
+		event_base_free(base);
+	}
+}
+
+/* Smallest size of a Packet on the wire according to its format */
+static
+size_t
+cdtest_PacketFormatLength (const SVPacketFormat* format)
+{
+	size_t length = SVByteSize;
+
+	for (size_t i = 0; i < format->length; i++) {
+		const SVPacketField* field = &format->field[i];
+
+		if (field->flags & SV_FIELD_GUARDED) {
+			continue;
+		}
+
+		switch (field->type) {
+			case SVFieldString:
+			case SVFieldString16:
+			case SVFieldItem:     length += SVShortSize; break;
+			case SVFieldMetadata: length += SVByteSize;  break;
+
+			default: length += SV_PacketFieldSize(field);
+		}
+	}
+
+	return length;
+}
+
+static
+void
+cdtest_PacketSchema_lengths (void* data)
+{
+	for (int type = 0; type < 256; type++) {
+		const SVPacketFormat* request  = &SVPacketFormats[SVRequest][type];
+		const SVPacketFormat* response = &SVPacketFormats[SVResponse][type];
+
+		for (int chain = SVRequest; chain <= SVPing; chain++) {
+			const SVPacketFormat* format = &SVPacketFormats[chain][type];
+
+			if (format->size == 0) {
+				continue;
+			}
+
+			tt_assert(SVPacketName[type]);
+			tt_int_op(cdtest_PacketFormatLength(format), ==, SVPacketLength[type]);
+		}
+
+		if (request->size == 0 || response->size == 0) {
+			continue;
+		}
+
+		// the length scan doesn't know the chain
+		tt_int_op(request->length, ==, response->length);
+
+		for (size_t i = 0; i < request->length; i++) {
+			tt_int_op(request->field[i].type,  ==, response->field[i].type);
+			tt_int_op(request->field[i].flags, ==, response->field[i].flags);
+		}
+	}
+
+	end: {}
+}
+
+/* Decode a Packet and encode it back */
+static
+CDBuffer*
+cdtest_PacketRecode (SVPacketChain chain, const uint8_t* data, size_t size)
+{
+	CDBuffer* input  = CD_CreateBuffer();
+	CDBuffer* output = NULL;
+	SVPacket  packet = { chain };
+
+	CD_BufferAdd(input, (CDPointer) data, size);
+
+	packet.type = (uint8_t) SV_BufferRemoveByte(input);
+	packet.data = SV_GetPacketDataFromBuffer(&packet, input);
+
+	if (packet.data && CD_BufferEmpty(input)) {
+		output = SV_PacketToBuffer(&packet);
+	}
+
+	SV_DestroyPacketData(&packet);
+	CD_free((void*) packet.data);
+	CD_DestroyBuffer(input);
+
+	return output;
+}
+
+static
+void
+cdtest_PacketSchema_recode (void* data)
+{
+	struct {
+		SVPacketChain  chain;
+		const uint8_t* data;
+		size_t         size;
+	} packets[] = {
+		{ SVRequest,  cdtest_PacketMetadata,    sizeof(cdtest_PacketMetadata) },
+		{ SVResponse, cdtest_PacketWindowItems, sizeof(cdtest_PacketWindowItems) },
+		{ SVRequest,  cdtest_PacketUpdateSign,  sizeof(cdtest_PacketUpdateSign) },
+		{ SVResponse, cdtest_PacketKeepAlive,   sizeof(cdtest_PacketKeepAlive) }
+	};
+
+	CDBuffer* output = NULL;
+
+	for (size_t i = 0; i < sizeof(packets) / sizeof(packets[0]); i++) {
+		tt_assert(output = cdtest_PacketRecode(packets[i].chain, packets[i].data, packets[i].size));
+		tt_int_op(CD_BufferLength(output), ==, packets[i].size);
+		tt_assert(memcmp(evbuffer_pullup(output->raw, -1), packets[i].data, packets[i].size) == 0);
+
+		CD_DestroyBuffer(output);
+		output = NULL;
+	}
+
+	end: {
+		if (output) {
+			CD_DestroyBuffer(output);
+		}
+	}
+}
+
+static
+void
+cdtest_PacketSchema_fields (void* data)
+{
+	SVPacketSpawnObject object = { .response = {
+		.entity   = { .id = 7 },
+		.type     = SVArrow,
+		.position = { 1, 2, 3 },
+		.flag     = 0,
+		.u1 = 4, .u2 = 5, .u3 = 6
+	}};
+
+	SVByte           item[] = { 1, 2, 3 };
+	SVPacketMapChunk chunk  = { .response = {
+		.position = { 16, 0, -32 },
+		.size     = { 16, (SVByte) 128, 16 },
+		.length   = 3,
+		.item     = item
+	}};
+
+	SVPacket  packet = { SVResponse, SVSpawnObject, (CDPointer) &object };
+	SVPacket  result = { SVResponse };
+	CDBuffer* output = NULL;
+
+	// the guarded shorts are only sent with a flag
+	tt_assert(output = SV_PacketToBuffer(&packet));
+	tt_int_op(CD_BufferLength(output), ==, SVPacketLength[SVSpawnObject]);
+	CD_DestroyBuffer(output);
+
+	object.response.flag = 1;
+
+	tt_assert(output = SV_PacketToBuffer(&packet));
+	tt_int_op(CD_BufferLength(output), ==, SVPacketLength[SVSpawnObject] + SVShortSize * 3);
+
+	result.type = (uint8_t) SV_BufferRemoveByte(output);
+	tt_assert(result.data = SV_GetPacketDataFromBuffer(&result, output));
+	tt_assert(CD_BufferEmpty(output));
+	tt_int_op(((SVPacketSpawnObject*) result.data)->response.type,       ==, SVArrow);
+	tt_int_op(((SVPacketSpawnObject*) result.data)->response.position.z, ==, 3);
+	tt_int_op(((SVPacketSpawnObject*) result.data)->response.u1,         ==, 4);
+	tt_int_op(((SVPacketSpawnObject*) result.data)->response.u3,         ==, 6);
+
+	CD_free((void*) result.data);
+	result.data = (CDPointer) NULL;
+	CD_DestroyBuffer(output);
+
+	// sizes go on the wire minus one, a whole chunk column height fits a byte
+	packet.type = SVMapChunk;
+	packet.data = (CDPointer) &chunk;
+
+	tt_assert(output = SV_PacketToBuffer(&packet));
+	tt_int_op(CD_BufferLength(output), ==, SVPacketLength[SVMapChunk] + 3);
+	tt_int_op(evbuffer_pullup(output->raw, -1)[12], ==, 127);
+
+	result.type = (uint8_t) SV_BufferRemoveByte(output);
+	tt_assert(result.data = SV_GetPacketDataFromBuffer(&result, output));
+	tt_int_op(((SVPacketMapChunk*) result.data)->response.position.z, ==, -32);
+	tt_int_op((uint8_t) ((SVPacketMapChunk*) result.data)->response.size.y, ==, 128);
+	tt_int_op(((SVPacketMapChunk*) result.data)->response.length, ==, 3);
+	tt_assert(memcmp(((SVPacketMapChunk*) result.data)->response.item, item, sizeof(item)) == 0);
+
+	end: {
+		if (result.data) {
+			SV_DestroyPacketData(&result);
+			CD_free((void*) result.data);
+		}
+
+		if (output) {
+			CD_DestroyBuffer(output);
+		}
+	}
+}
+
+static struct testcase_t cd_protocols_survival_Packet_tests[] = {
+	{ "length/bytewise", cdtest_PacketLength_bytewise, },
+	{ "length/resume",   cdtest_PacketLength_resume, },
+	{ "length/chains",   cdtest_PacketLength_chains, },
+	{ "length/invalid",  cdtest_PacketLength_invalid, },
+	{ "schema/lengths",  cdtest_PacketSchema_lengths, },
+	{ "schema/recode",   cdtest_PacketSchema_recode, },
+	{ "schema/fields",   cdtest_PacketSchema_fields, },
+
+	END_OF_TESTCASES
+};
+
+/* Fill a chunk with terrain-like data: stone, dirt and grass under a rolling surface */
+static
+void
+cdtest_ChunkFill (SVChunk* chunk, int seed)
+{
+	memset(chunk, 0, sizeof(SVChunk));
+
+	for (int x = 0; x < 16; x++) {
+		for (int z = 0; z < 16; z++) {
+			int height = 60 + ((x * 7 + z * 3 + seed) % 9);
+
+			for (int y = 0; y < 128; y++) {
+				int index = y + (z * 128) + (x * 128 * 16);
+
+				if (y < height - 4) {
+					chunk->blocks[index] = ((x * y + z + seed) % 97 == 0) ? SVCoalOre : SVStone;
+				}
+				else if (y < height) {
+					chunk->blocks[index] = SVDirt;
+				}
+				else if (y == height) {
+					chunk->blocks[index] = SVGrass;
+				}
+				else {
+					chunk->skyLight[index / 2] = 0xFF;
+				}
+			}
+
+			chunk->heightMap[z * 16 + x] = height + 1;
+		}
+	}
+}
+
+static
+void
+cdtest_Chunk_compress (void* data)
+{
+	SVChunk* chunk  = CD_malloc(sizeof(SVChunk));
+	uint8_t* flat   = CD_malloc(81920);
+	uint8_t* output = CD_malloc(SV_ChunkCompressBound());
+	uint8_t* input  = CD_malloc(81920);
+
+	cdtest_ChunkFill(chunk, 42);
+	SV_ChunkToByteArray(chunk, flat);
+
+	for (int level = 1; level <= 9; level++) {
+		size_t length   = SV_ChunkCompress(chunk, level, output, SV_ChunkCompressBound());
+		uLongf inflated = 81920;
+
+		tt_assert(length > 0);
+		tt_int_op(uncompress(input, &inflated, output, length), ==, Z_OK);
+		tt_int_op(inflated, ==, 81920);
+		tt_assert(memcmp(input, flat, 81920) == 0);
+	}
+
+	end: {
+		CD_free(chunk);
+		CD_free(flat);
+		CD_free(output);
+		CD_free(input);
+	}
+}
+
+/* Expand the chunks of a square around the spawn of the default world, false if there's no world */
+static
+bool
+cdtest_ChunkLoadWorld (SVChunk* chunks, int side)
+{
+	CDList*  worlds = (CDList*) CD_DynamicGet(_server, "World.list");
+	SVWorld* world  = worlds ? (SVWorld*) CD_ListFirst(worlds) : NULL;
+
+	if (!world) {
+		return false;
+	}
+
+	SVChunkPosition spawn = SV_BlockPositionToChunkPosition(world->spawnPosition);
+
+	for (int i = 0; i < side * side; i++) {
+		int           x     = spawn.x - side / 2 + i % side;
+		int           z     = spawn.z - side / 2 + i / side;
+		SVWorldChunk* chunk = SV_WorldAcquireChunk(world, x, z, SVChunkRead);
+
+		if (!chunk) {
+			return false;
+		}
+
+		SV_PackedChunkExpand(chunk->chunk, &chunks[i]);
+		SV_WorldReleaseChunk(world, chunk, SVChunkRead);
+	}
+
+	return true;
+}
+
+static
+void
+cdtest_Chunk_compressBenchmark (void* data)
+{
+	const int rounds = 200;
+	const int side   = 4;
+
+	SVChunk* chunks = CD_malloc(sizeof(SVChunk) * side * side);
+	uint8_t* output = CD_malloc(SV_ChunkCompressBound());
+
+	puts("");
+
+	// the chunks the persistence plugin loads or generates for the default world, made up ones without a world
+	if (cdtest_ChunkLoadWorld(chunks, side)) {
+		puts("  chunks around the spawn of the default world");
+	}
+	else {
+		puts("  no world to load chunks from, using generated ones");
+
+		for (int i = 0; i < side * side; i++) {
+			cdtest_ChunkFill(&chunks[i], i * 13);
+		}
+	}
+
+	for (int level = 1; level <= 9; level++) {
+		struct timespec start, stop;
+		size_t          total = 0;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for (int i = 0; i < rounds; i++) {
+			size_t length = SV_ChunkCompress(&chunks[i % (side * side)], level, output, SV_ChunkCompressBound());
+
+			tt_assert(length > 0);
+
+			total += length;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+
+		double elapsed = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+		printf("  level %d: %7.1f MB/s, ratio %5.1f\n", level,
+			(81920.0 * rounds) / (1024 * 1024) / elapsed, (81920.0 * rounds) / total);
+	}
+
+	end: {
+		CD_free(chunks);
+		CD_free(output);
+	}
+}
+
+static
+void
+cdtest_ChunkView_unloadCount (SVChunkView* self, SVChunkPosition position, int* count)
+{
+	count[0]++;
+}
+
+static
+void
+cdtest_ChunkView_loadMark (SVChunkView* self, SVChunkPosition position, int* count)
+{
+	count[1]++;
+
+	SV_ChunkViewSet(self, position, true);
+}
+
+static
+void
+cdtest_ChunkView_move (void* data)
+{
+	SVChunkView* view     = SV_CreateChunkView(2, 0, 0);
+	int          count[2] = { 0, 0 };
+
+	SV_ChunkViewMove(view, (SVChunkPosition) { 100, -100 }, 0,
+		(SVChunkViewCallback) cdtest_ChunkView_unloadCount, (SVChunkViewCallback) cdtest_ChunkView_loadMark, (CDPointer) count);
+
+	tt_int_op(count[0], ==, 0);
+	tt_int_op(count[1], ==, 13);
+	tt_assert(SV_ChunkViewHas(view, (SVChunkPosition) { 102, -100 }));
+	tt_assert(!SV_ChunkViewHas(view, (SVChunkPosition) { 102, -99 }));
+
+	// one step on x drops the back column and loads the front one
+	count[0] = count[1] = 0;
+
+	SV_ChunkViewMove(view, (SVChunkPosition) { 101, -100 }, 0,
+		(SVChunkViewCallback) cdtest_ChunkView_unloadCount, (SVChunkViewCallback) cdtest_ChunkView_loadMark, (CDPointer) count);
+
+	tt_int_op(count[0], ==, 5);
+	tt_int_op(count[1], ==, 5);
+	tt_assert(!SV_ChunkViewHas(view, (SVChunkPosition) { 98, -100 }));
+	tt_assert(SV_ChunkViewHas(view, (SVChunkPosition) { 103, -100 }));
+
+	count[0] = 0;
+
+	SV_ChunkViewClear(view, (SVChunkViewCallback) cdtest_ChunkView_unloadCount, (CDPointer) count);
+
+	tt_int_op(count[0], ==, 13);
+
+	end: {
+		SV_DestroyChunkView(view);
+	}
+}
+
+static
+void
+cdtest_ChunkView_hysteresis (void* data)
+{
+	SVChunkView* view     = SV_CreateChunkView(2, 1, 10);
+	int          count[2] = { 0, 0 };
+
+	SV_ChunkViewMove(view, (SVChunkPosition) { 0, 0 }, 0,
+		(SVChunkViewCallback) cdtest_ChunkView_unloadCount, (SVChunkViewCallback) cdtest_ChunkView_loadMark, (CDPointer) count);
+
+	// stepping over the border and back only loads the new column once
+	count[0] = count[1] = 0;
+
+	SV_ChunkViewMove(view, (SVChunkPosition) { 1, 0 }, 1,
+		(SVChunkViewCallback) cdtest_ChunkView_unloadCount, (SVChunkViewCallback) cdtest_ChunkView_loadMark, (CDPointer) count);
+	SV_ChunkViewMove(view, (SVChunkPosition) { 0, 0 }, 2,
+		(SVChunkViewCallback) cdtest_ChunkView_unloadCount, (SVChunkViewCallback) cdtest_ChunkView_loadMark, (CDPointer) count);
+
+	tt_int_op(count[0], ==, 0);
+	tt_int_op(count[1], ==, 5);
+	tt_int_op(view->stats.kept, ==, 5);
+	tt_assert(SV_ChunkViewHas(view, (SVChunkPosition) { 3, 0 }));
+
+	// past the margin chunks wait for the grace period
+	count[0] = 0;
+
+	SV_ChunkViewMove(view, (SVChunkPosition) { 2, 0 }, 3,
+		(SVChunkViewCallback) cdtest_ChunkView_unloadCount, (SVChunkViewCallback) cdtest_ChunkView_loadMark, (CDPointer) count);
+
+	tt_int_op(count[0], ==, 0);
+	tt_assert(SV_ChunkViewHas(view, (SVChunkPosition) { -2, 0 }));
+
+	SV_ChunkViewExpire(view, 12, (SVChunkViewCallback) cdtest_ChunkView_unloadCount, (CDPointer) count);
+
+	tt_int_op(count[0], ==, 0);
+
+	SV_ChunkViewExpire(view, 13, (SVChunkViewCallback) cdtest_ChunkView_unloadCount, (CDPointer) count);
+
+	tt_int_op(count[0], ==, 3);
+	tt_assert(!SV_ChunkViewHas(view, (SVChunkPosition) { -2, 0 }));
+	tt_assert(!SV_ChunkViewHas(view, (SVChunkPosition) { -1, 1 }));
+	tt_assert(SV_ChunkViewHas(view, (SVChunkPosition) { -1, 0 }));
+
+	end: {
+		SV_DestroyChunkView(view);
+	}
+}
+
+static
+void
+cdtest_Chunk_sections (void* data)
+{
+	SVChunk*       chunk    = CD_malloc(sizeof(SVChunk));
+	SVChunk*       expanded = CD_malloc(sizeof(SVChunk));
+	SVPackedChunk* packed   = NULL;
+	uint8_t        type;
+	uint8_t        metadata;
+
+	cdtest_ChunkFill(chunk, 42);
+	chunk->position = (SVChunkPosition) { 3, -4 };
+
+	packed = SV_CreatePackedChunk(chunk);
+
+	// the air and the stone under the surface are uniform sections
+	tt_assert(SV_PackedChunkSize(packed) < sizeof(SVChunk) / 8);
+
+	SV_PackedChunkExpand(packed, expanded);
+	tt_assert(memcmp(chunk, expanded, sizeof(SVChunk)) == 0);
+
+	// a change in a uniform section gives it a palette, filling the palette widens it
+	for (int i = 0; i < 40; i++) {
+		SVBlockPosition position = { 48 + i % 16, 100 + i / 16, -64 + i % 7 };
+		int             index    = position.y + 128 * ((position.z & 15) + 16 * (position.x & 15));
+
+		tt_assert(SV_PackedChunkSetBlock(packed, position, SVStone + i, i & 15));
+
+		chunk->blocks[index]    = SVStone + i;
+		chunk->data[index >> 1] = (index & 1)
+			? (chunk->data[index >> 1] & 0x0F) | ((i & 15) << 4)
+			: (chunk->data[index >> 1] & 0xF0) | (i & 15);
+	}
+
+	tt_assert(!SV_PackedChunkSetBlock(packed, (SVBlockPosition) { 48, 100, -64 }, SVStone, 0));
+
+	SV_PackedChunkGetBlock(packed, (SVBlockPosition) { 49, 100, -63 }, &type, &metadata);
+	tt_int_op(type, ==, SVStone + 1);
+	tt_int_op(metadata, ==, 1);
+
+	SV_PackedChunkExpand(packed, expanded);
+	tt_assert(memcmp(chunk, expanded, sizeof(SVChunk)) == 0);
+
+	end: {
+		if (packed) {
+			SV_DestroyPackedChunk(packed);
+		}
+
+		CD_free(chunk);
+		CD_free(expanded);
+	}
+}
+
+static struct testcase_t cd_protocols_survival_Chunk_tests[] = {
+	{ "compress",   cdtest_Chunk_compress, },
+	{ "sections",   cdtest_Chunk_sections, },
+	{ "benchmark",  cdtest_Chunk_compressBenchmark, TT_OFF_BY_DEFAULT },
+	{ "view",       cdtest_ChunkView_move, },
+	{ "hysteresis", cdtest_ChunkView_hysteresis, },
+
+	END_OF_TESTCASES
+};
+
+static
+void
+cdtest_World_gridCount (SVWorld* world, SVEntity* entity, int* count)
+{
+	(*count)++;
+}
+
+static
+void
+cdtest_World_grid (void* data)
+{
+	SVWorld  world;
+	SVEntity entities[3] = {
+		{ .id = 1, .position = {   0.5, 64,   0.5 } },
+		{ .id = 2, .position = {  20.0, 64,  -3.0 } },
+		{ .id = 3, .position = { 200.0, 64, 200.0 } }
+	};
+	CDList* found = NULL;
+	int     count = 0;
+
+	memset(&world, 0, sizeof(SVWorld));
+
+	world.entities   = CD_CreateMap();
+	world.grid.cells = CD_CreateMap();
+	pthread_rwlock_init(&world.grid.lock, NULL);
+
+	for (int i = 0; i < 3; i++) {
+		SV_WorldAddEntity(&world, &entities[i]);
+	}
+
+	tt_int_op(CD_MapLength(world.grid.cells), ==, 3);
+
+	SV_WorldForEachInChunks(&world, (SVChunkPosition) { 0, 0 }, 1, (SVWorldEntityCallback) cdtest_World_gridCount, (CDPointer) &count);
+	tt_int_op(count, ==, 2);
+
+	found = SV_WorldQueryRadius(&world, entities[0].position, 10);
+	tt_int_op(CD_ListLength(found), ==, 1);
+
+	CD_DestroyList(found);
+	found = NULL;
+
+	// moving in the same chunk keeps the cell, crossing one moves the entity
+	SV_WorldMoveEntity(&world, &entities[1], (SVPrecisePosition) { 21.0, 64, -2.0 });
+	SV_WorldMoveEntity(&world, &entities[2], (SVPrecisePosition) { 5.0, 64, 5.0 });
+
+	tt_int_op(CD_MapLength(world.grid.cells), ==, 2);
+
+	found = SV_WorldQueryRadius(&world, entities[0].position, 10);
+	tt_int_op(CD_ListLength(found), ==, 2);
+
+	SV_WorldRemoveEntity(&world, &entities[0]);
+	SV_WorldRemoveEntity(&world, &entities[2]);
+
+	tt_int_op(CD_MapLength(world.grid.cells), ==, 1);
+	tt_int_op(CD_MapLength(world.entities), ==, 1);
+
+	end: {
+		if (found) {
+			CD_DestroyList(found);
+		}
+
+		SV_WorldRemoveEntity(&world, &entities[1]);
+
+		CD_DestroyMap(world.grid.cells);
+		CD_DestroyMap(world.entities);
+		pthread_rwlock_destroy(&world.grid.lock);
+	}
+}
+
+/* World.chunk handler of the World tests, chunks with x -7 fail to load */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t  changed;
+
+	int  loads;
+	bool hold;
+	bool waiting;
+} cdtest_WorldLoader = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+static
+bool
+cdtest_WorldLoadChunk (CDServer* server, SVWorld* world, int x, int z, SVChunk* chunk, CDError* error)
+{
+	pthread_mutex_lock(&cdtest_WorldLoader.lock);
+
+	cdtest_WorldLoader.loads++;
+	cdtest_WorldLoader.waiting = true;
+
+	pthread_cond_broadcast(&cdtest_WorldLoader.changed);
+
+	// the single flight test keeps the load going while others ask for the chunk
+	while (cdtest_WorldLoader.hold) {
+		pthread_cond_wait(&cdtest_WorldLoader.changed, &cdtest_WorldLoader.lock);
+	}
+
+	cdtest_WorldLoader.waiting = false;
+
+	pthread_mutex_unlock(&cdtest_WorldLoader.lock);
+
+	if (x == -7) {
+		*error = 1;
+	}
+	else {
+		cdtest_ChunkFill(chunk, 0);
+	}
+
+	return true;
+}
+
+static
+void
+cdtest_WorldCacheSetup (SVWorld* world, CDServer* server)
+{
+	memset(server, 0, sizeof(CDServer));
+	memset(world, 0, sizeof(SVWorld));
+
+	// a server of its own, so only the test loads chunks
+	server->logger          = _server->logger;
+	server->event.callbacks = CD_CreateHash();
+
+	CD_EventRegister(server, "World.chunk", cdtest_WorldLoadChunk);
+
+	world->server         = server;
+	world->chunks.limit   = SIZE_MAX;
+	world->chunks.entries = CD_CreateMap();
+	pthread_mutex_init(&world->chunks.lock, NULL);
+	pthread_cond_init(&world->chunks.loaded, NULL);
+
+	world->chunks.slabs.chunks  = CD_CreateSlabPool(sizeof(SVChunk), false);
+	world->chunks.slabs.buffers = CD_CreateSlabPool(SV_ChunkCompressBound(), false);
+
+	cdtest_WorldLoader.loads   = 0;
+	cdtest_WorldLoader.hold    = false;
+	cdtest_WorldLoader.waiting = false;
+}
+
+static
+void
+cdtest_WorldCacheTeardown (SVWorld* world, CDServer* server)
+{
+	CD_MAP_FOREACH(world->chunks.entries, it) {
+		SVWorldChunk* entry = (SVWorldChunk*) CD_MapIteratorValue(it);
+
+		if (entry->chunk) {
+			SV_DestroyPackedChunk(entry->chunk);
+		}
+
+		if (entry->packet) {
+			CD_DestroySharedBuffer(entry->packet);
+		}
+
+		if (entry->subscribers.item) {
+			CD_free(entry->subscribers.item);
+		}
+
+		pthread_rwlock_destroy(&entry->lock);
+
+		CD_free(entry);
+	}
+
+	CD_DestroyMap(world->chunks.entries);
+	pthread_cond_destroy(&world->chunks.loaded);
+	pthread_mutex_destroy(&world->chunks.lock);
+
+	CD_DestroySlabPool(world->chunks.slabs.chunks);
+	CD_DestroySlabPool(world->chunks.slabs.buffers);
+
+	CDList* callbacks = (CDList*) CD_HashGet(server->event.callbacks, "World.chunk");
+
+	CD_LIST_FOREACH(callbacks, it) {
+		CD_DestroyEventCallback((CDEventCallback*) CD_ListIteratorValue(it));
+	}
+
+	CD_DestroyList(callbacks);
+	CD_DestroyHash(server->event.callbacks);
+}
+
+static
+void
+cdtest_World_blocksFlush (SVWorld* world, SVChunkPosition position, CDSharedBuffer* packet, CDSharedBuffer** result)
+{
+	*result = CD_ReferenceSharedBuffer(packet);
+}
+
+static
+void
+cdtest_World_blocks (void* data)
+{
+	SVWorld         world;
+	CDServer        server;
+	SVWorldChunk*   entry;
+	CDSharedBuffer* packet = NULL;
+	SVWorldBlock    block;
+	SVWorldBlock    blocks[] = {
+		{ { 1,  64, 2 }, SVStone, 0 },
+		{ { 3, -1,  3 }, SVStone, 0 },
+		{ { 4,  10, 5 }, SVDirt,  0 }
+	};
+
+	cdtest_WorldCacheSetup(&world, &server);
+
+	// the test holds a reference, so the chunk never leaves the cache
+	tt_assert((entry = SV_WorldAcquireChunk(&world, 0, 0, SVChunkReference)));
+	world.chunks.limit = 1;
+
+	tt_assert(SV_WorldSetBlock(&world, (SVBlockPosition) { 1, 64, 2 }, SVGlass, 3));
+	tt_assert(SV_WorldGetBlock(&world, (SVBlockPosition) { 1, 64, 2 }, &block));
+	tt_int_op(block.type, ==, SVGlass);
+	tt_int_op(block.metadata, ==, 3);
+
+	// a pending change keeps the chunk referenced until the flush and until the save
+	tt_int_op(entry->references, ==, 3);
+	tt_assert(world.chunks.changed == entry);
+	tt_assert(world.chunks.dirty == entry);
+
+	// changing the same block again doesn't add a change, a bad height fails alone
+	tt_assert(!SV_WorldSetBlocks(&world, blocks, 3));
+	tt_int_op(entry->changes.length, ==, 2);
+	tt_assert(SV_WorldGetBlock(&world, (SVBlockPosition) { 4, 10, 5 }, &block));
+	tt_int_op(block.type, ==, SVDirt);
+
+	SV_WorldFlushChanges(&world, (SVWorldChangesCallback) cdtest_World_blocksFlush, (CDPointer) &packet);
+
+	tt_assert(packet);
+	tt_int_op(packet->length, ==, 19);
+	tt_int_op(packet->data[0], ==, SVMultiBlockChange);
+	tt_int_op(packet->data[11], ==, 0x12);
+	tt_int_op(packet->data[12], ==, 0x40);
+
+	tt_assert(world.chunks.changed == NULL);
+
+	// the flush only sends, the chunk stays referenced until it's saved
+	tt_int_op(entry->references, ==, 2);
+	tt_assert(world.chunks.dirty == entry);
+
+	SV_WorldSaveChunks(&world);
+
+	tt_int_op(entry->references, ==, 1);
+	tt_assert(world.chunks.dirty == NULL);
+	tt_int_op(world.chunks.stats.saves, ==, 1);
+
+	CD_DestroySharedBuffer(packet);
+	packet = NULL;
+
+	// past the limit the whole chunk is sent again
+	for (int i = 0; i <= SV_WORLD_CHUNK_CHANGES; i++) {
+		SV_WorldSetBlock(&world, (SVBlockPosition) { 0, i, 0 }, SVStone, 0);
+	}
+
+	tt_assert(entry->changes.overflow);
+
+	SV_WorldFlushChanges(&world, (SVWorldChangesCallback) cdtest_World_blocksFlush, (CDPointer) &packet);
+
+	tt_assert(packet);
+	tt_int_op(packet->data[0], ==, SVMapChunk);
+	tt_int_op(world.chunks.stats.resends, ==, 1);
+
+	end: {
+		if (packet) {
+			CD_DestroySharedBuffer(packet);
+		}
+
+		cdtest_WorldCacheTeardown(&world, &server);
+	}
+}
+
+static
+void
+cdtest_World_subscribers (void* data)
+{
+	SVWorld       world;
+	CDServer      server;
+	SVWorldChunk* entry;
+	SVPlayer      players[5];
+
+	cdtest_WorldCacheSetup(&world, &server);
+
+	tt_assert((entry = SV_WorldAcquireChunk(&world, 0, -1, SVChunkReference)));
+
+	for (int i = 0; i < 5; i++) {
+		SV_WorldSubscribeChunk(&world, entry->position, &players[i]);
+	}
+
+	// chunks that aren't cached have nobody to keep track of
+	SV_WorldSubscribeChunk(&world, (SVChunkPosition) { 1, 1 }, &players[0]);
+
+	tt_int_op(entry->subscribers.length, ==, 5);
+
+	SV_WorldUnsubscribeChunk(&world, entry->position, &players[1]);
+	SV_WorldUnsubscribeChunk(&world, entry->position, &players[1]);
+
+	tt_int_op(entry->subscribers.length, ==, 4);
+
+	for (size_t i = 0; i < entry->subscribers.length; i++) {
+		tt_assert(entry->subscribers.item[i] != &players[1]);
+	}
+
+	end: {
+		cdtest_WorldCacheTeardown(&world, &server);
+	}
+}
+
+static
+bool
+cdtest_WorldTouchChunk (SVWorld* world, int x, int z)
+{
+	SVWorldChunk* chunk = SV_WorldAcquireChunk(world, x, z, SVChunkReference);
+
+	if (!chunk) {
+		return false;
+	}
+
+	SV_WorldReleaseChunk(world, chunk, SVChunkReference);
+
+	return true;
+}
+
+static
+void
+cdtest_World_cacheEviction (void* data)
+{
+	SVWorld       world;
+	CDServer      server;
+	SVWorldChunk* chunk;
+	size_t        size;
+
+	cdtest_WorldCacheSetup(&world, &server);
+
+	// chunks on both sides of 0 don't share an id
+	tt_assert(cdtest_WorldTouchChunk(&world, -1, 0));
+	size = world.chunks.memory;
+	tt_assert(size > 0);
+
+	// every chunk is filled the same, so room for two and a half
+	world.chunks.limit = size * 2 + size / 2;
+
+	tt_assert(cdtest_WorldTouchChunk(&world, 0, -1));
+	tt_int_op(world.chunks.length, ==, 2);
+
+	// (-1, 0) is used again, so (0, -1) is the least recently used
+	tt_assert(cdtest_WorldTouchChunk(&world, -1, 0));
+	tt_int_op(cdtest_WorldLoader.loads, ==, 2);
+
+	tt_assert(cdtest_WorldTouchChunk(&world, -1, -1));
+	tt_int_op(world.chunks.length, ==, 2);
+	tt_int_op(world.chunks.memory, ==, size * 2);
+	tt_int_op(world.chunks.stats.evictions, ==, 1);
+
+	tt_assert(cdtest_WorldTouchChunk(&world, -1, 0));
+	tt_int_op(cdtest_WorldLoader.loads, ==, 3);
+
+	tt_assert(cdtest_WorldTouchChunk(&world, 0, -1));
+	tt_int_op(cdtest_WorldLoader.loads, ==, 4);
+	tt_int_op(world.chunks.stats.evictions, ==, 2);
+
+	// referenced chunks stay past the limit, they go once given back
+	world.chunks.limit = 0;
+
+	tt_assert((chunk = SV_WorldAcquireChunk(&world, 0, -1, SVChunkReference)));
+	tt_int_op(world.chunks.length, ==, 2);
+
+	cdtest_WorldTouchChunk(&world, -1, 0);
+	tt_int_op(world.chunks.length, ==, 1);
+
+	SV_WorldReleaseChunk(&world, chunk, SVChunkReference);
+	tt_int_op(world.chunks.length, ==, 0);
+	tt_int_op(world.chunks.memory, ==, 0);
+	tt_assert(world.chunks.unused.head == NULL && world.chunks.unused.tail == NULL);
+
+	end: {
+		cdtest_WorldCacheTeardown(&world, &server);
+	}
+}
+
+typedef struct _cdtest_WorldAcquire {
+	SVWorld*      world;
+	int           x;
+	int           z;
+	SVWorldChunk* result;
+} cdtest_WorldAcquire;
+
+static
+void*
+cdtest_WorldAcquireThread (cdtest_WorldAcquire* self)
+{
+	self->result = SV_WorldAcquireChunk(self->world, self->x, self->z, SVChunkReference);
+
+	return NULL;
+}
+
+/* Ask for a chunk from two threads, the second one only once the first is loading it */
+static
+void
+cdtest_WorldAcquireConcurrently (SVWorld* world, cdtest_WorldAcquire* acquires)
+{
+	pthread_t threads[2];
+	uint64_t  hits;
+
+	pthread_mutex_lock(&world->chunks.lock);
+	hits = world->chunks.stats.hits;
+	pthread_mutex_unlock(&world->chunks.lock);
+
+	cdtest_WorldLoader.hold = true;
+
+	pthread_create(&threads[0], NULL, (void* (*)(void*)) cdtest_WorldAcquireThread, &acquires[0]);
+
+	pthread_mutex_lock(&cdtest_WorldLoader.lock);
+	while (!cdtest_WorldLoader.waiting) {
+		pthread_cond_wait(&cdtest_WorldLoader.changed, &cdtest_WorldLoader.lock);
+	}
+	pthread_mutex_unlock(&cdtest_WorldLoader.lock);
+
+	pthread_create(&threads[1], NULL, (void* (*)(void*)) cdtest_WorldAcquireThread, &acquires[1]);
+
+	// the hit is counted under the chunks lock right before waiting on the load
+	while (true) {
+		pthread_mutex_lock(&world->chunks.lock);
+
+		if (world->chunks.stats.hits > hits) {
+			pthread_mutex_unlock(&world->chunks.lock);
+			break;
+		}
+
+		pthread_mutex_unlock(&world->chunks.lock);
+		sched_yield();
+	}
+
+	pthread_mutex_lock(&cdtest_WorldLoader.lock);
+	cdtest_WorldLoader.hold = false;
+	pthread_cond_broadcast(&cdtest_WorldLoader.changed);
+	pthread_mutex_unlock(&cdtest_WorldLoader.lock);
+
+	pthread_join(threads[0], NULL);
+	pthread_join(threads[1], NULL);
+}
+
+static
+void
+cdtest_World_cacheSingleLoad (void* data)
+{
+	SVWorld             world;
+	CDServer            server;
+	cdtest_WorldAcquire acquires[2];
+
+	cdtest_WorldCacheSetup(&world, &server);
+
+	acquires[0] = acquires[1] = (cdtest_WorldAcquire) { &world, 2, -3, NULL };
+
+	cdtest_WorldAcquireConcurrently(&world, acquires);
+
+	tt_int_op(cdtest_WorldLoader.loads, ==, 1);
+	tt_assert(acquires[0].result);
+	tt_assert(acquires[0].result == acquires[1].result);
+	tt_int_op(world.chunks.stats.misses, ==, 1);
+	tt_int_op(world.chunks.stats.hits, ==, 1);
+
+	// both references have to be given back before it can go
+	world.chunks.limit = 0;
+
+	SV_WorldReleaseChunk(&world, acquires[0].result, SVChunkReference);
+	tt_int_op(world.chunks.length, ==, 1);
+
+	SV_WorldReleaseChunk(&world, acquires[1].result, SVChunkReference);
+	tt_int_op(world.chunks.length, ==, 0);
+
+	end: {
+		cdtest_WorldCacheTeardown(&world, &server);
+	}
+}
+
+static
+void
+cdtest_World_cacheFailedLoad (void* data)
+{
+	SVWorld             world;
+	CDServer            server;
+	cdtest_WorldAcquire acquires[2];
+
+	cdtest_WorldCacheSetup(&world, &server);
+
+	tt_assert(!SV_WorldAcquireChunk(&world, -7, 1, SVChunkReference));
+	tt_int_op(world.chunks.length, ==, 0);
+	tt_int_op(world.chunks.memory, ==, 0);
+
+	// whoever waited on a failed load gets nothing and the entry goes with the last of them
+	acquires[0] = acquires[1] = (cdtest_WorldAcquire) { &world, -7, 1, NULL };
+
+	cdtest_WorldAcquireConcurrently(&world, acquires);
+
+	tt_int_op(cdtest_WorldLoader.loads, ==, 2);
+	tt_assert(!acquires[0].result);
+	tt_assert(!acquires[1].result);
+	tt_int_op(world.chunks.length, ==, 0);
+	tt_assert(world.chunks.unused.head == NULL);
+
+	// a failure isn't remembered, the next ask loads again
+	tt_assert(!cdtest_WorldTouchChunk(&world, -7, 1));
+	tt_int_op(cdtest_WorldLoader.loads, ==, 3);
+
+	tt_assert(cdtest_WorldTouchChunk(&world, -6, 1));
+	tt_int_op(world.chunks.length, ==, 1);
+
+	end: {
+		cdtest_WorldCacheTeardown(&world, &server);
+	}
+}
+
+static
+void
+cdtest_World_cacheReplace (void* data)
+{
+	SVWorld         world;
+	CDServer        server;
+	SVWorldChunk*   chunk;
+	SVPackedChunk*  packed;
+	CDSharedBuffer* packet;
+	SVChunk*        replacement = CD_malloc(sizeof(SVChunk));
+	uint8_t         type;
+	uint8_t         metadata;
+
+	cdtest_WorldCacheSetup(&world, &server);
+
+	tt_assert((chunk = SV_WorldAcquireChunk(&world, 1, 2, SVChunkReference)));
+	tt_assert((packet = SV_WorldGetChunkPacket(&world, chunk)));
+	CD_DestroySharedBuffer(packet);
+
+	packed = chunk->chunk;
+
+	SV_PackedChunkGetBlock(packed, (SVBlockPosition) { 0, 62, 0 }, &type, &metadata);
+	tt_int_op(type, ==, SVAir);
+
+	// the ground is 5 blocks higher with that seed
+	cdtest_ChunkFill(replacement, 5);
+	replacement->position = (SVChunkPosition) { 1, 2 };
+
+	SV_WorldSetChunk(&world, replacement);
+
+	// the handle still has the same chunk, with the new content and no stale packet
+	tt_assert(chunk->chunk == packed);
+	tt_assert(chunk->packet == NULL);
+	tt_int_op(world.chunks.memory, ==, SV_PackedChunkSize(packed));
+
+	SV_PackedChunkGetBlock(packed, (SVBlockPosition) { 0, 62, 0 }, &type, &metadata);
+	tt_int_op(type, ==, SVDirt);
+
+	SV_WorldReleaseChunk(&world, chunk, SVChunkReference);
+
+	end: {
+		CD_free(replacement);
+
+		cdtest_WorldCacheTeardown(&world, &server);
+	}
+}
+
+static struct testcase_t cd_protocols_survival_World_tests[] = {
+	{ "grid",        cdtest_World_grid, },
+	{ "blocks",      cdtest_World_blocks, },
+	{ "subscribers", cdtest_World_subscribers, },
+
+	{ "cache/eviction", cdtest_World_cacheEviction, },
+	{ "cache/single",   cdtest_World_cacheSingleLoad, },
+	{ "cache/failed",   cdtest_World_cacheFailedLoad, },
+	{ "cache/replace",  cdtest_World_cacheReplace, },
+
+	END_OF_TESTCASES
+};
+
+static
+void
+cdtest_events_provided (void* data)
+{
+	puts("\n---");
+
+	CD_HASH_FOREACH(_server->event.provided, it) {
+		CDString* output  = CD_CreateStringFromFormat("%s (", (char*) CD_HashIteratorKey(it));
+		CDList*   params  = (CDList*) CD_HashIteratorValue(it);
+		int       length  = CD_ListLength(params);
+		int       current = 1;
+
+		CD_LIST_FOREACH(params, it) {
+			output = CD_AppendCString(output, (char*) CD_ListIteratorValue(it));
+
+			if (current < length) {
+				output = CD_AppendCString(output, ", ");
+			}
+
+			current++;
+		}
+
+		output = CD_AppendCString(output, ")");
+
+		puts(CD_StringContent(output));
+
+		CD_DestroyString(output);
+	}
+
+	puts("---");
+
+	end: {
+
+	}
+}
+
+static struct testcase_t cd_events_tests[] = {
+	{ "provided", cdtest_events_provided, },
+
+	END_OF_TESTCASES
+};
+
+static struct testgroup_t cd_groups[] = {
+	{ "utils/String/",           cd_utils_String_tests },
+	{ "utils/String/UTF8/",      cd_utils_String_UTF8_tests },
+	{ "utils/String/Minecraft/", cd_utils_String_Minecraft_tests },
+	{ "utils/Hash/",             cd_utils_Hash_tests },
+	{ "utils/Map/",              cd_utils_Map_tests },
+	{ "utils/List/",             cd_utils_List_tests },
+	{ "utils/Set/",              cd_utils_Set_tests },
+	{ "utils/Regexp/",           cd_utils_Regexp_tests },
+	{ "utils/Slab/",             cd_utils_Slab_tests },
+
+	{ "protocols/survival/Buffer/", cd_protocols_survival_Buffer_tests },
+	{ "protocols/survival/Packet/", cd_protocols_survival_Packet_tests },
+	{ "protocols/survival/Chunk/",  cd_protocols_survival_Chunk_tests },
+	{ "protocols/survival/World/",  cd_protocols_survival_World_tests },
+
+//    { "events/", cd_events_tests },
+
+	END_OF_GROUPS
+};
+
+bool
+CD_PluginInitialize (CDPlugin* self)
+{
+	puts("");
+
+	// benchmarks only run when asked for in the plugin configuration
+	const char* arguments[] = { "tests", "..", "+protocols/survival/Chunk/benchmark" };
+	bool        benchmark   = false;
+
+	C_SAVE(C_PATH(self->config, "benchmark"), C_BOOL, benchmark);
 
 	_server = self->server;
-	tinytest_main(0, NULL, cd_groups);
+	tinytest_main(benchmark ? 3 : 0, benchmark ? arguments : NULL, cd_groups);
 
 	puts("");
 
@@ -129,3 +129,61 @@ CD_BufferRemoveBuffer (CDBuffer* self)
 
 	return result;
 }
+
+CDSharedBuffer*
+CD_CreateSharedBuffer (CDBuffer* data)
+{
+	size_t          length = CD_BufferLength(data);
+	CDSharedBuffer* self   = CD_malloc(sizeof(CDSharedBuffer) + length);
+
+	self->references = 1;
+	self->length     = length;
+
+	evbuffer_copyout(data->raw, self->data, length);
+
+	return self;
+}
+
+CDSharedBuffer*
+CD_ReferenceSharedBuffer (CDSharedBuffer* self)
+{
+	assert(self);
+
+	CD_AtomicIncrement(&self->references);
+
+	return self;
+}
+
+void
+CD_DestroySharedBuffer (CDSharedBuffer* self)
+{
+	assert(self);
+
+	if (CD_AtomicDecrement(&self->references) == 0) {
+		CD_free(self);
+	}
+}
+
+static
+void
+cd_SharedBufferCleanup (const void* data, size_t length, void* self)
+{
+	CD_DestroySharedBuffer((CDSharedBuffer*) self);
+}
+
+void
+CD_BufferAddSharedBuffer (CDBuffer* self, CDSharedBuffer* data)
+{
+	assert(self);
+	assert(data);
+
+	if (data->length == 0) {
+		return;
+	}
+
+	CD_AtomicIncrement(&data->references);
+
+	if (evbuffer_add_reference(self->raw, data->data, data->length, cd_SharedBufferCleanup, data) != 0) {
+		CD_DestroySharedBuffer(data);
+	}
+}
@@ -35,6 +35,7 @@ CD_CreateBuffers (void)
 
 	self->raw      = NULL;
 	self->external = false;
+	self->parser   = CDNull;
 
 	return self;
 }
@@ -49,6 +50,7 @@ CD_WrapBuffers (CDRawBuffers buffers)
 
 	self->raw      = buffers;
 	self->external = true;
+	self->parser   = CDNull;
 
 	return self;
 }
@@ -61,6 +63,7 @@ CD_DestroyBuffers (CDBuffers* self)
 	CD_DestroyBuffer(self->input);
 	CD_DestroyBuffer(self->output);
 
+	CD_free((void*) self->parser);
 	CD_free(self);
 }
 
@@ -31,14 +31,13 @@ CD_CreateClient (CDServer* server)
 {
 	CDClient* self = CD_malloc(sizeof(CDClient));
 
-	if (pthread_rwlock_init(&self->lock.status, NULL) != 0) {
-		CD_abort("pthread rwlock failed to initialize");
-	}
-
-	self->server = server;
+	self->server  = server;
+	self->reactor = NULL;
+	self->strand  = CD_CreateStrand();
 
 	self->status = CDClientConnect;
 	self->jobs   = 0;
+	self->drain  = NULL;
 
 	self->buffers = NULL;
 
@@ -63,13 +62,100 @@ CD_DestroyClient (CDClient* self)
 		CD_DestroyBuffers(self->buffers);
 	}
 
-	CD_DestroyDynamic(DYNAMIC(self));
+	if (self->drain) {
+		CD_DestroyJob(self->drain);
+	}
 
-	pthread_rwlock_destroy(&self->lock.status);
+	CD_DestroyStrand(self->strand);
+
+	CD_DestroyDynamic(DYNAMIC(self));
 
 	CD_free(self);
 }
 
+CDClientStatus
+CD_ClientGetStatus (CDClient* self)
+{
+	assert(self);
+
+	return CD_AtomicGet(&self->status);
+}
+
+bool
+CD_ClientChangeStatus (CDClient* self, CDClientStatus from, CDClientStatus to)
+{
+	assert(self);
+
+	return CD_AtomicCompareAndSwap(&self->status, from, to);
+}
+
+bool
+CD_ClientAddJob (CDClient* self, CDJob* job)
+{
+	assert(self);
+	assert(job);
+
+	return CD_StrandAddJob(self->server->workers, self->strand, job);
+}
+
+bool
+CD_ClientDisconnect (CDClient* self)
+{
+	assert(self);
+
+	if (CD_AtomicSwap(&self->status, CDClientDisconnect) == CDClientDisconnect) {
+		return false;
+	}
+
+	return CD_StrandCloseWithJob(self->server->workers, self->strand,
+		CD_CreateExternalJob(CDClientDisconnectJob, (CDPointer) self));
+}
+
+bool
+CD_ClientAddJobOnDrain (CDClient* self, CDJob* job)
+{
+	assert(self);
+	assert(job);
+
+	if (!CD_AtomicCompareAndSwap(&self->drain, NULL, job)) {
+		CD_DestroyJob(job);
+
+		return false;
+	}
+
+	// the output may have drained before the Job was set, it has to be as low as
+	// the reactor's low watermark for the senders to get some hysteresis
+	if (!self->buffers || CD_BufferLength(self->buffers->output) < CD_CLIENT_WATERMARK / 2) {
+		CD_ClientDrained(self);
+	}
+
+	return true;
+}
+
+void
+CD_ClientDrained (CDClient* self)
+{
+	assert(self);
+
+	CDJob* job = CD_AtomicSwap(&self->drain, NULL);
+
+	if (job) {
+		CD_ClientAddJob(self, job);
+	}
+}
+
+bool
+CD_ClientIsCongested (CDClient* self)
+{
+	assert(self);
+
+	if (!self->buffers) {
+		return false;
+	}
+
+	return CD_BufferLength(self->buffers->output) >= CD_CLIENT_WATERMARK;
+}
+
 void
 CD_ClientSendBuffer (CDClient* self, CDBuffer* buffer)
 {
@@ -82,5 +168,25 @@ CD_ClientSendBuffer (CDClient* self, CDBuffer* buffer)
 
 	CD_BufferAddBuffer(self->buffers->output, buffer);
 
-	CD_BuffersFlush(self->buffers);
+	// when corked the reactor writes everything queued during the iteration at once
+	if (!self->server->config->cache.connection.cork) {
+		CD_BuffersFlush(self->buffers);
+	}
+}
+
+void
+CD_ClientSendSharedBuffer (CDClient* self, CDSharedBuffer* buffer)
+{
+	assert(self);
+	assert(buffer);
+
+	if (!self->buffers) {
+		return;
+	}
+
+	CD_BufferAddSharedBuffer(self->buffers->output, buffer);
+
+	if (!self->server->config->cache.connection.cork) {
+		CD_BuffersFlush(self->buffers);
+	}
 }
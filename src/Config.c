@@ -43,8 +43,11 @@ CD_ParseConfig (const char* path)
 
 	self->cache.daemonize = true;
 
-	self->cache.connection.port    = 25565;
-	self->cache.connection.backlog = 16;
+	self->cache.connection.port     = 25565;
+	self->cache.connection.backlog  = 16;
+	self->cache.connection.reactors = 1;
+	self->cache.connection.batch    = 16;
+	self->cache.connection.cork     = true;
 
 	self->cache.connection.bind.ipv4.sin_family      = AF_INET;
 	self->cache.connection.bind.ipv4.sin_addr.s_addr = INADDR_ANY;
@@ -68,8 +71,22 @@ CD_ParseConfig (const char* path)
 		C_SAVE(C_GET(server, "workers"), C_INT, self->cache.workers);
 
 		C_IN(connection, server, "connection") {
-			C_SAVE(C_GET(connection, "port"),    C_INT, self->cache.connection.port);
-			C_SAVE(C_GET(connection, "backlog"), C_INT, self->cache.connection.backlog);
+			C_SAVE(C_GET(connection, "port"),     C_INT, self->cache.connection.port);
+			C_SAVE(C_GET(connection, "backlog"),  C_INT, self->cache.connection.backlog);
+			C_SAVE(C_GET(connection, "reactors"), C_INT, self->cache.connection.reactors);
+			C_SAVE(C_GET(connection, "batch"),    C_INT, self->cache.connection.batch);
+			C_SAVE(C_GET(connection, "cork"),     C_BOOL, self->cache.connection.cork);
+
+			if (self->cache.connection.reactors < 1) {
+				self->cache.connection.reactors = 1;
+			}
+
+			if (self->cache.connection.batch < 1) {
+				self->cache.connection.batch = 1;
+			}
+			else if (self->cache.connection.batch > CD_CONFIG_MAX_BATCH) {
+				self->cache.connection.batch = CD_CONFIG_MAX_BATCH;
+			}
 
 			self->cache.connection.bind.ipv4.sin_port  = htons(self->cache.connection.port);
 			self->cache.connection.bind.ipv6.sin6_port = htons(self->cache.connection.port);
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/common.h>
+#include <craftd/Deque.h>
+
+static
+CDDequeArray*
+cd_CreateDequeArray (size_t size)
+{
+	CDDequeArray* self = CD_malloc(sizeof(CDDequeArray) + sizeof(CDPointer) * size);
+
+	self->previous = NULL;
+	self->size     = size;
+
+	return self;
+}
+
+static
+CDDequeArray*
+cd_DequeGrow (CDDeque* self, CDDequeArray* array, int64_t bottom, int64_t top)
+{
+	CDDequeArray* grown = cd_CreateDequeArray(array->size * 2);
+
+	for (int64_t i = top; i < bottom; i++) {
+		grown->item[i & (grown->size - 1)] = array->item[i & (array->size - 1)];
+	}
+
+	// thieves may still be reading the old array, it's freed with the Deque
+	grown->previous = array;
+
+	CD_AtomicSet(&self->array, grown);
+
+	return grown;
+}
+
+CDDeque*
+CD_CreateDeque (void)
+{
+	CDDeque* self = CD_malloc(sizeof(CDDeque));
+
+	self->top    = 0;
+	self->bottom = 0;
+	self->array  = cd_CreateDequeArray(CD_DEQUE_DEFAULT_SIZE);
+
+	return self;
+}
+
+void
+CD_DestroyDeque (CDDeque* self)
+{
+	assert(self);
+
+	CDDequeArray* array = self->array;
+
+	while (array) {
+		CDDequeArray* previous = array->previous;
+
+		CD_free(array);
+
+		array = previous;
+	}
+
+	CD_free(self);
+}
+
+void
+CD_DequePush (CDDeque* self, CDPointer data)
+{
+	assert(self);
+
+	int64_t       bottom = self->bottom;
+	int64_t       top    = CD_AtomicGet(&self->top);
+	CDDequeArray* array  = self->array;
+
+	if (bottom - top >= (int64_t) array->size) {
+		array = cd_DequeGrow(self, array, bottom, top);
+	}
+
+	array->item[bottom & (array->size - 1)] = data;
+
+	CD_AtomicSet(&self->bottom, bottom + 1);
+}
+
+CDPointer
+CD_DequeTake (CDDeque* self)
+{
+	assert(self);
+
+	int64_t       bottom = self->bottom - 1;
+	CDDequeArray* array  = self->array;
+	int64_t       top;
+	CDPointer     result = CDNull;
+
+	CD_AtomicSet(&self->bottom, bottom);
+	CD_AtomicFence();
+
+	top = CD_AtomicGet(&self->top);
+
+	if (top <= bottom) {
+		result = array->item[bottom & (array->size - 1)];
+
+		if (top == bottom) {
+			// last item, race against the thieves for it
+			if (!CD_AtomicCompareAndSwap(&self->top, top, top + 1)) {
+				result = CDNull;
+			}
+
+			CD_AtomicSet(&self->bottom, bottom + 1);
+		}
+	}
+	else {
+		CD_AtomicSet(&self->bottom, bottom + 1);
+	}
+
+	return result;
+}
+
+CDPointer
+CD_DequeSteal (CDDeque* self)
+{
+	int64_t   top;
+	int64_t   bottom;
+	CDPointer result = CDNull;
+
+	assert(self);
+
+	top = CD_AtomicGet(&self->top);
+	CD_AtomicFence();
+	bottom = CD_AtomicGet(&self->bottom);
+
+	if (top < bottom) {
+		CDDequeArray* array = CD_AtomicGet(&self->array);
+
+		result = array->item[top & (array->size - 1)];
+
+		if (!CD_AtomicCompareAndSwap(&self->top, top, top + 1)) {
+			result = CDNull;
+		}
+	}
+
+	return result;
+}
+
+size_t
+CD_DequeLength (CDDeque* self)
+{
+	assert(self);
+
+	int64_t bottom = CD_AtomicGet(&self->bottom);
+	int64_t top    = CD_AtomicGet(&self->top);
+
+	return bottom > top ? bottom - top : 0;
+}
@@ -33,6 +33,7 @@ CD_CreateJob (CDJobType type, CDPointer data)
 	self->type     = type;
 	self->data     = data;
 	self->external = false;
+	self->next     = NULL;
 
 	return self;
 }
@@ -45,6 +46,7 @@ CD_CreateExternalJob (CDJobType type, CDPointer data)
 	self->type     = type;
 	self->data     = data;
 	self->external = true;
+	self->next     = NULL;
 
 	return self;
 }
@@ -85,12 +87,14 @@ CD_CreateCustomJob (CDCustomJobCallback callback, CDPointer data)
 }
 
 CDClientProcessJobData*
-CD_CreateClientProcessJob (CDClient* client, void* packet)
+CD_CreateClientProcessJob (CDClient* client, void** packets, size_t length)
 {
-	CDClientProcessJobData* self = CD_malloc(sizeof(CDClientProcessJobData));
+	CDClientProcessJobData* self = CD_malloc(sizeof(CDClientProcessJobData) + sizeof(void*) * length);
 
 	self->client = client;
-	self->packet = packet;
+	self->length = length;
+
+	memcpy(self->packet, packets, sizeof(void*) * length);
 
 	return self;
 }
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/PacketBatch.h>
+#include <craftd/Client.h>
+#include <craftd/Server.h>
+
+CDPacketBatch*
+CD_CreatePacketBatch (void)
+{
+	CDPacketBatch* self = CD_malloc(sizeof(CDPacketBatch));
+
+	self->buffer = CD_CreateBuffer();
+	self->length = 0;
+
+	return self;
+}
+
+void
+CD_DestroyPacketBatch (CDPacketBatch* self)
+{
+	assert(self);
+
+	CD_DestroyBuffer(self->buffer);
+
+	CD_free(self);
+}
+
+void
+CD_PacketBatchAdd (CDPacketBatch* self, CDBuffer* data)
+{
+	assert(self);
+	assert(data);
+
+	// moving only relinks the chains, the packet bytes aren't copied
+	evbuffer_add_buffer(self->buffer->raw, data->raw);
+
+	self->length++;
+}
+
+void
+CD_PacketBatchAddCopy (CDPacketBatch* self, CDBuffer* data)
+{
+	assert(self);
+	assert(data);
+
+	size_t length = evbuffer_get_length(data->raw);
+
+	evbuffer_add(self->buffer->raw, evbuffer_pullup(data->raw, length), length);
+
+	self->length++;
+}
+
+size_t
+CD_PacketBatchLength (CDPacketBatch* self)
+{
+	assert(self);
+
+	return self->length;
+}
+
+size_t
+CD_PacketBatchSize (CDPacketBatch* self)
+{
+	assert(self);
+
+	return CD_BufferLength(self->buffer);
+}
+
+void
+CD_PacketBatchSend (CDPacketBatch* self, CDClient* client)
+{
+	assert(self);
+	assert(client);
+
+	if (self->length == 0) {
+		return;
+	}
+
+	if (client->buffers) {
+		evbuffer_add_buffer(client->buffers->output->raw, self->buffer->raw);
+
+		if (!client->server->config->cache.connection.cork) {
+			CD_BuffersFlush(client->buffers);
+		}
+	}
+	else {
+		CD_BufferDrain(self->buffer, CD_BufferLength(self->buffer));
+	}
+
+	self->length = 0;
+}
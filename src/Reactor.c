@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/Reactor.h>
+#include <craftd/Server.h>
+#include <craftd/Client.h>
+
+/* Seconds between two wakeups of the idle event, it only has to exist */
+#define CD_REACTOR_IDLE 3600
+
+static
+void
+cd_ReactorIdle (evutil_socket_t fd, short event, void* arg)
+{
+}
+
+CDReactor*
+CD_CreateReactor (CDServer* server)
+{
+	CDReactor* self = CD_malloc(sizeof(CDReactor));
+
+	self->server   = server;
+	self->id       = 0;
+	self->thread   = 0;
+	self->listener = NULL;
+	self->socket   = -1;
+
+	if ((self->base = event_base_new()) == NULL) {
+		CD_free(self);
+
+		return NULL;
+	}
+
+	// an event base with nothing pending returns from its loop right away, the
+	// Reactors that only get Clients handed to them would spin until the first
+	DO {
+		struct timeval interval = { CD_REACTOR_IDLE, 0 };
+
+		self->idle = event_new(self->base, -1, EV_PERSIST, cd_ReactorIdle, NULL);
+
+		event_add(self->idle, &interval);
+	}
+
+	self->disconnecting = CD_CreateList();
+
+	return self;
+}
+
+void
+CD_DestroyReactor (CDReactor* self)
+{
+	assert(self);
+
+	CD_ReactorCleanDisconnects(self);
+
+	if (self->listener) {
+		event_free(self->listener);
+	}
+
+	event_free(self->idle);
+
+	if (self->socket >= 0) {
+		evutil_closesocket(self->socket);
+	}
+
+	event_base_free(self->base);
+
+	CD_DestroyList(self->disconnecting);
+
+	CD_free(self);
+}
+
+bool
+CD_RunReactor (CDReactor* self)
+{
+	assert(self);
+
+	SDEBUG(self->server, "reactor %d started", self->id);
+
+	while (self->server->running) {
+		event_base_loop(self->base, 0);
+
+		CD_ReactorCleanDisconnects(self);
+	}
+
+	SDEBUG(self->server, "reactor %d stopped", self->id);
+
+	return true;
+}
+
+void
+CD_ReactorFlush (CDReactor* self, bool now)
+{
+	struct timeval interval = { 0, 0 };
+
+	assert(self);
+
+	if (now) {
+		event_base_loopbreak(self->base);
+	}
+
+	// loopexit is backed by a timer, so unlike loopbreak it isn't lost when the
+	// thread is between two iterations of the loop
+	event_base_loopexit(self->base, &interval);
+}
+
+void
+CD_ReactorCleanDisconnects (CDReactor* self)
+{
+	if (CD_ListLength(self->disconnecting) > 0) {
+		CDPointer* disconnected = CD_ListClear(self->disconnecting);
+
+		for (size_t i = 0; disconnected[i] != CDNull; i++) {
+			CDClient* client = (CDClient*) CD_ListDelete(self->server->clients, disconnected[i]);
+
+			if (client) {
+				CD_DestroyClient(client);
+			}
+		}
+
+		CD_free(disconnected);
+	}
+}
@@ -30,6 +30,11 @@
 #include <craftd/common.h>
 #include <signal.h>
 
+#ifndef WIN32
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
 CDServer* CDMainServer = NULL;
 
 static
@@ -65,8 +70,14 @@ CD_CreateServer (const char* path)
 	self->plugins          = CD_CreatePlugins(self);
 	self->scriptingEngines = CD_CreateScriptingEngines(self);
 
-	self->clients       = CD_CreateList();
-	self->disconnecting = CD_CreateList();
+	self->clients = CD_CreateList();
+
+	self->reactors.length     = 0;
+	self->reactors.item       = NULL;
+	self->reactors.distribute = false;
+	self->reactors.last       = 0;
+
+	self->event.base = NULL;
 
 	self->running = false;
 
@@ -114,19 +125,25 @@ CD_DestroyServer (CDServer* self)
 
 	CD_StopServer(self);
 
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		if (self->reactors.item[i]->thread) {
+			pthread_join(self->reactors.item[i]->thread, NULL);
+		}
+	}
+
 	if (self->workers) {
 		CD_DestroyWorkers(self->workers);
 	}
 
-	if (self->event.listener) {
-		event_free(self->event.listener);
-		self->event.listener = NULL;
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		CD_DestroyReactor(self->reactors.item[i]);
 	}
 
-	if (self->event.base) {
-		event_base_free(self->event.base);
-		self->event.base = NULL;
-	}
+	CD_free(self->reactors.item);
+
+	self->reactors.length = 0;
+	self->reactors.item   = NULL;
+	self->event.base      = NULL;
 
 	if (self->config) {
 		CD_DestroyConfig(self->config);
@@ -176,32 +193,45 @@ cd_ReadCallback (struct bufferevent* event, CDClient* client)
 	  return;
 	}
 
-	pthread_rwlock_wrlock(&client->lock.status);
-
 	SDEBUG(self, "read data from %s, %d byte/s available", client->ip, CD_BufferLength(client->buffers->input));
 
-	if (client->status == CDClientIdle) {
-		void* packet;
+	// batches of packets go on the client strand in order, the parsing stops when too many are waiting
+	while (CD_ClientGetStatus(client) != CDClientDisconnect && CD_AtomicGet(&client->jobs) < CD_CLIENT_MAX_PENDING) {
+		void*  packets[self->config->cache.connection.batch];
+		size_t length = 0;
+		bool   more   = true;
 
-		if (self->protocol->parsable(client->buffers)) {
-			if ((packet = self->protocol->parse(client->buffers, false))) {
-				CD_BufferReadIn(client->buffers, CDNull, CDNull);
+		while (length < self->config->cache.connection.batch) {
+			if (!self->protocol->parsable(client->buffers)) {
+				if (errno == EILSEQ) {
+					CD_ServerKick(self, client, CD_CreateStringFromCString("bad packet"));
+				}
 
-				client->status = CDClientProcess;
-				client->jobs++;
+				more = false;
+				break;
+			}
 
-				CD_AddJob(self->workers, CD_CreateJob(CDClientProcessJob,
-					(CDPointer) CD_CreateClientProcessJob(client, packet)));
+			if (!(packets[length] = self->protocol->parse(client->buffers, false))) {
+				more = false;
+				break;
 			}
+
+			length++;
 		}
-		else {
-			if (errno == EILSEQ) {
-				CD_ServerKick(self, client, CD_CreateStringFromCString("bad packet"));
-			}
+
+		if (length > 0) {
+			CD_BufferReadIn(client->buffers, CDNull, CDNull);
+
+			CD_AtomicIncrement(&client->jobs);
+
+			CD_ClientAddJob(client, CD_CreateJob(CDClientProcessJob,
+				(CDPointer) CD_CreateClientProcessJob(client, packets, length)));
 		}
-	}
 
-	pthread_rwlock_unlock(&client->lock.status);
+		if (!more) {
+			break;
+		}
+	}
 }
 
 static
@@ -214,10 +244,6 @@ cd_ErrorCallback (struct bufferevent* event, short error, CDClient* client)
 		return;
 	}
 
-	pthread_rwlock_wrlock(&client->lock.status);
-
-	client->status = CDClientDisconnect;
-
 	CDServer* self = client->server;
 
 	if (error & BEV_EVENT_ERROR) {
@@ -231,9 +257,27 @@ cd_ErrorCallback (struct bufferevent* event, short error, CDClient* client)
 
 	SLOG(self, LOG_INFO, "%s[%p] errored/disconnected", client->ip, ERROR(client));
 
-	CD_AddJob(client->server->workers, CD_CreateExternalJob(CDClientDisconnectJob, (CDPointer) client));
+	CD_ClientDisconnect(client);
+}
+
+static
+void
+cd_WriteCallback (struct bufferevent* event, CDClient* client)
+{
+	assert(client);
 
-	pthread_rwlock_unlock(&client->lock.status);
+	#ifdef TCP_CORK
+	// the output drained, uncork to push out the last partial segment and cork again
+	if (client->server->config->cache.connection.cork && evbuffer_get_length(bufferevent_get_output(event)) == 0) {
+		int off = 0;
+		int on  = 1;
+
+		setsockopt(client->socket, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+		setsockopt(client->socket, IPPROTO_TCP, TCP_CORK, &on, sizeof(on));
+	}
+	#endif
+
+	CD_ClientDrained(client);
 }
 
 static
@@ -256,15 +300,19 @@ cd_LogCallback (int priority, const char* message)
 
 static
 void
-cd_Accept (evutil_socket_t listener, short event, CDServer* self)
+cd_Accept (evutil_socket_t listener, short event, CDReactor* reactor)
 {
+	CDServer*               self = reactor->server;
 	CDClient*               client;
 	struct sockaddr_storage storage;
 	socklen_t               length = sizeof(storage);
 	int                     fd     = accept(listener, (struct sockaddr*) &storage, &length);
 
 	if (fd < 0) {
-		SERR(self, "accept error: %s", strerror(-fd));
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			SERR(self, "accept error: %s", strerror(errno));
+		}
+
 		return;
 	}
 
@@ -286,6 +334,7 @@ cd_Accept (evutil_socket_t listener, short event, CDServer* self)
 		SERR(self, "weird address family");
 		close(fd);
 		CD_DestroyClient(client);
+		return;
 	}
 
 	if (self->config->cache.game.clients.max > 0) {
@@ -320,17 +369,88 @@ cd_Accept (evutil_socket_t listener, short event, CDServer* self)
 		}
 	}
 
-	client->socket = fd;
+	// without SO_REUSEPORT only the first reactor listens and hands clients out round-robin
+	if (self->reactors.distribute) {
+		reactor = self->reactors.item[self->reactors.last++ % self->reactors.length];
+	}
+
+	client->socket  = fd;
+	client->reactor = reactor;
 	evutil_make_socket_nonblocking(client->socket);
 
-	client->buffers = CD_WrapBuffers(bufferevent_socket_new(self->event.base, client->socket, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE));
+	client->buffers = CD_WrapBuffers(bufferevent_socket_new(reactor->base, client->socket, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE));
+
+	#ifdef TCP_CORK
+	if (self->config->cache.connection.cork) {
+		int one = 1;
 
-	bufferevent_setcb(client->buffers->raw, (bufferevent_data_cb) cd_ReadCallback, NULL, (bufferevent_event_cb) cd_ErrorCallback, client);
+		setsockopt(client->socket, IPPROTO_TCP, TCP_CORK, &one, sizeof(one));
+	}
+	#endif
+
+	// the write callback runs whenever a write leaves the output under the low watermark
+	bufferevent_setwatermark(client->buffers->raw, EV_WRITE, CD_CLIENT_WATERMARK / 2, 0);
+	bufferevent_setcb(client->buffers->raw, (bufferevent_data_cb) cd_ReadCallback, (bufferevent_data_cb) cd_WriteCallback, (bufferevent_event_cb) cd_ErrorCallback, client);
 	bufferevent_enable(client->buffers->raw, EV_READ | EV_WRITE);
 
 	CD_ListPush(self->clients, (CDPointer) client);
 
-	CD_AddJob(self->workers, CD_CreateExternalJob(CDClientConnectJob, (CDPointer) client));
+	CD_ClientAddJob(client, CD_CreateExternalJob(CDClientConnectJob, (CDPointer) client));
+}
+
+static
+evutil_socket_t
+cd_ServerListen (CDServer* self, bool reusePort)
+{
+	evutil_socket_t fd;
+
+	if ((fd = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
+		SERR(self, "could not create socket: %s", strerror(errno));
+
+		return -1;
+	}
+
+	evutil_make_socket_nonblocking(fd);
+
+	#ifndef WIN32
+	DO {
+		int one = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	}
+	#endif
+
+	if (reusePort) {
+		#ifdef SO_REUSEPORT
+		int one = 1;
+
+		if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+			SDEBUG(self, "SO_REUSEPORT not supported: %s", strerror(errno));
+			evutil_closesocket(fd);
+
+			return -1;
+		}
+		#else
+		evutil_closesocket(fd);
+
+		return -1;
+		#endif
+	}
+
+	if ((ERROR(self) = bind(fd, (struct sockaddr*) &self->config->cache.connection.bind.ipv4, sizeof(self->config->cache.connection.bind.ipv4))) < 0) {
+		SERR(self, "cannot bind: %s", strerror(errno));
+		evutil_closesocket(fd);
+
+		return -1;
+	}
+
+	if ((ERROR(self) = listen(fd, self->config->cache.connection.backlog)) < 0) {
+		SERR(self, "listen error: %s", strerror(errno));
+		evutil_closesocket(fd);
+
+		return -1;
+	}
+
+	return fd;
 }
 
 bool
@@ -339,42 +459,48 @@ CD_RunServer (CDServer* self)
 	event_set_mem_functions(CD_malloc, CD_realloc, CD_free);
 	event_set_log_callback(cd_LogCallback);
 
-	if ((self->event.base = event_base_new()) == NULL) {
-		SERR(self, "could not create MC libevent base!");
+	self->reactors.length = self->config->cache.connection.reactors;
+	self->reactors.item   = CD_malloc(sizeof(CDReactor*) * self->reactors.length);
 
-		return false;
-	}
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		if ((self->reactors.item[i] = CD_CreateReactor(self)) == NULL) {
+			SERR(self, "could not create MC libevent base!");
 
-	event_add(evsignal_new(self->event.base, SIGINT, (event_callback_fn) cd_HandleSignal, self), NULL);
+			self->reactors.length = i;
 
-	if ((self->socket = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
-		SERR(self, "could not create socket: %s", strerror(-self->socket));
+			return false;
+		}
 
-		return false;
+		self->reactors.item[i]->id = i;
 	}
 
-	evutil_make_socket_nonblocking(self->socket);
+	self->event.base = self->reactors.item[0]->base;
 
-	#ifndef WIN32
-	DO {
-		int one = 1;
-		setsockopt(self->socket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
-	}
-	#endif
+	event_add(evsignal_new(self->event.base, SIGINT, (event_callback_fn) cd_HandleSignal, self), NULL);
 
-	if ((ERROR(self) = bind(self->socket, (struct sockaddr*) &self->config->cache.connection.bind.ipv4, sizeof(self->config->cache.connection.bind.ipv4))) < 0) {
-		SERR(self, "cannot bind: %s", strerror(ABS(ERROR(self))));
-		return false;
+	if (self->reactors.length > 1 && (self->reactors.item[0]->socket = cd_ServerListen(self, true)) >= 0) {
+		for (size_t i = 1; i < self->reactors.length; i++) {
+			if ((self->reactors.item[i]->socket = cd_ServerListen(self, true)) < 0) {
+				return false;
+			}
+		}
 	}
+	else {
+		if ((self->reactors.item[0]->socket = cd_ServerListen(self, false)) < 0) {
+			return false;
+		}
 
-	if ((ERROR(self) = listen(self->socket, self->config->cache.connection.backlog)) < 0) {
-		SERR(self, "listen error: %s", strerror(ABS(ERROR(self))));
-		return false;
+		self->reactors.distribute = self->reactors.length > 1;
 	}
 
 	SLOG(self, LOG_INFO, "server listening on port %d (%s gameplay)", self->config->cache.connection.port,
 		self->config->cache.game.protocol.standard ? "standard" : "custom");
 
+	if (self->reactors.length > 1) {
+		SLOG(self, LOG_INFO, "server running %zu reactors (%s)", self->reactors.length,
+			self->reactors.distribute ? "shared listener" : "SO_REUSEPORT");
+	}
+
 	if (self->config->cache.game.clients.max > 0) {
 		SLOG(self, LOG_INFO, "server can host max %d clients", self->config->cache.game.clients.max);
 	}
@@ -384,9 +510,17 @@ CD_RunServer (CDServer* self)
 	// Start the TimeLoop for timed events
 	pthread_create(&self->timeloop->thread, &self->timeloop->attributes, (void *(*)(void *)) CD_RunTimeLoop, self->timeloop);
 
-	self->event.listener = event_new(self->event.base, self->socket, EV_READ | EV_PERSIST, (event_callback_fn) cd_Accept, self);
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		CDReactor* reactor = self->reactors.item[i];
 
-	event_add(self->event.listener, NULL);
+		if (reactor->socket < 0) {
+			continue;
+		}
+
+		reactor->listener = event_new(reactor->base, reactor->socket, EV_READ | EV_PERSIST, (event_callback_fn) cd_Accept, reactor);
+
+		event_add(reactor->listener, NULL);
+	}
 
 	CD_LoadPlugins(self->plugins);
 	CD_LoadScriptingEngines(self->scriptingEngines);
@@ -395,13 +529,21 @@ CD_RunServer (CDServer* self)
 
 	self->running = true;
 
-	while (self->running) {
-		event_base_loop(self->event.base, 0);
+	// The first reactor runs on the main thread
+	for (size_t i = 1; i < self->reactors.length; i++) {
+		if (pthread_create(&self->reactors.item[i]->thread, NULL, (void *(*)(void *)) CD_RunReactor, self->reactors.item[i]) != 0) {
+			SERR(self, "reactor %zu startup failed!", i);
 
-		CD_ServerCleanDisconnects(self);
+			// its socket would keep getting connections, or clients handed to it, nobody would serve
+			self->reactors.item[i]->thread = 0;
+
+			CD_StopServer(self);
+
+			return false;
+		}
 	}
 
-	return true;
+	return CD_RunReactor(self->reactors.item[0]);
 }
 
 bool
@@ -425,29 +567,16 @@ CD_StopServer (CDServer* self)
 void
 CD_ServerFlush (CDServer* self, bool now)
 {
-	if (now) {
-		event_base_loopbreak(self->event.base);
-	}
-	else {
-		struct timeval interval = { 0, 0 };
-
-		event_base_loopexit(self->event.base, &interval);
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		CD_ReactorFlush(self->reactors.item[i], now);
 	}
 }
 
 void
 CD_ServerCleanDisconnects (CDServer* self)
 {
-	if (CD_ListLength(self->disconnecting) > 0) {
-		CD_LIST_FOREACH(self->disconnecting, it) {
-			CDClient* client = (CDClient*) CD_ListDelete(self->clients, CD_ListIteratorValue(it));
-
-			if (client) {
-				CD_DestroyClient(client);
-			}
-		}
-
-		CD_free(CD_ListClear(self->disconnecting));
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		CD_ReactorCleanDisconnects(self->reactors.item[i]);
 	}
 }
 
@@ -465,11 +594,7 @@ CD_ServerKick (CDServer* self, CDClient* client, CDString* reason)
 	assert(self);
 	assert(client);
 
-	pthread_rwlock_wrlock(&client->lock.status);
-
-	if (client->status == CDClientDisconnect) {
-		pthread_rwlock_unlock(&client->lock.status);
-
+	if (CD_ClientGetStatus(client) == CDClientDisconnect) {
 		return;
 	}
 
@@ -481,9 +606,5 @@ CD_ServerKick (CDServer* self, CDClient* client, CDString* reason)
 
 	CD_EventDispatch(self, "Client.kick", client, reason);
 
-	client->status = CDClientDisconnect;
-
-	CD_AddJob(client->server->workers, CD_CreateExternalJob(CDClientDisconnectJob, (CDPointer) client));
-
-	pthread_rwlock_unlock(&client->lock.status);
+	CD_ClientDisconnect(client);
 }
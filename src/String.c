@@ -112,6 +112,7 @@ cd_UpdateLength (CDString* self)
 	assert(self);
 
 	self->length = CD_UTF8_strnlen(CD_StringContent(self), self->raw->slen);
+	self->clean  = false;
 }
 
 CDString*
@@ -122,6 +123,7 @@ CD_CreateString (void)
 	self->raw      = bfromcstr("");
 	self->length   = 0;
 	self->external = false;
+	self->clean    = false;
 
 	assert(self->raw);
 
@@ -40,6 +40,8 @@ CD_CreateWorker (CDServer* server)
 	self->working = false;
 	self->stopped = true;
 	self->job     = NULL;
+	self->jobs    = CD_CreateDeque();
+	self->seed    = 0;
 
 	return self;
 }
@@ -58,143 +60,163 @@ CD_DestroyWorker (CDWorker* self)
 		CD_DestroyJob(self->job);
 	}
 
+	CD_DestroyDeque(self->jobs);
+
 	CD_free(self);
 }
 
-bool
-CD_RunWorker (CDWorker* self)
+static
+void
+cd_WorkerRunClientJob (CDWorker* self, CDJob* job)
 {
-	assert(self);
+	CDClient* client;
 
-	self->stopped = false;
+	if (job->type == CDClientProcessJob) {
+		client = ((CDClientProcessJobData*) job->data)->client;
+	}
+	else {
+		client = (CDClient*) job->data;
+	}
 
-	CD_EventDispatch(self->server, "Worker.start!", self);
+	if (!client) {
+		CD_DestroyJob(job);
+		return;
+	}
 
-	SLOG(self->server, LOG_INFO, "worker %d started", self->id);
+	if (job->type == CDClientDisconnectJob) {
+		CDReactor* reactor = client->reactor;
 
-	while (self->working) {
-		self->job = NULL;
+		// the strand guarantees every other job of the client already ran
+		CD_EventDispatch(self->server, "Client.disconnect", client, (bool) ERROR(client));
 
-		if (!CD_HasJobs(self->workers)) {
-			pthread_mutex_lock(&self->workers->lock.mutex);
+		CD_DestroyJob(job);
 
-			SDEBUG(self->server, "worker %d ready", self->id);
+		// the reactor can destroy the client as soon as it's pushed
+		CD_ListPush(reactor->disconnecting, (CDPointer) client);
 
-			pthread_cond_wait(&self->workers->lock.condition, &self->workers->lock.mutex);
+		CD_ReactorFlush(reactor, false);
 
-			pthread_mutex_unlock(&self->workers->lock.mutex);
-		}
+		return;
+	}
 
-		if (!self->working) {
-			break;
+	if (CD_ClientGetStatus(client) == CDClientDisconnect) {
+		if (job->type == CDClientProcessJob) {
+			CD_AtomicDecrement(&client->jobs);
 		}
 
-		self->job = CD_NextJob(self->workers);
+		CD_DestroyJob(job);
+		return;
+	}
 
-		if (!self->job) {
-			SDEBUG(self->server, "no jobs for %d :<", self->id);
-			continue;
-		}
+	if (job->type == CDClientConnectJob) {
+		CD_EventDispatch(self->server, "Client.connect", client);
 
-		SDEBUG(self->server, "worker %d running", self->id);
+		CD_ClientChangeStatus(client, CDClientConnect, CDClientIdle);
 
-		if (self->job->type == CDCustomJob) {
-			CDCustomJobData* data = (CDCustomJobData*) self->job->data;
+		CD_DestroyJob(job);
+	}
+	else if (job->type == CDClientProcessJob) {
+		CDClientProcessJobData* data = (CDClientProcessJobData*) job->data;
 
-			data->callback(data->data);
+		for (size_t i = 0; i < data->length; i++) {
+			// a packet of the batch may have kicked the client
+			if (CD_ClientGetStatus(client) == CDClientDisconnect) {
+				break;
+			}
 
-			CD_DestroyJob(self->job);
+			CD_EventDispatch(self->server, "Client.process", client, data->packet[i]);
+			CD_EventDispatch(self->server, "Client.processed", client, data->packet[i]);
 		}
-		else if (CD_JOB_IS_PLAYER(self->job)) {
-			CDClient* client;
 
-			if (self->job->type == CDClientProcessJob) {
-				client = ((CDClientProcessJobData*) self->job->data)->client;
-			}
-			else {
-				client = (CDClient*) self->job->data;
-			}
+		CD_DestroyJob(job);
 
-			if (!client) {
-				CD_DestroyJob(self->job);
-				continue;
-			}
+		// the reactor stopped parsing when the strand was full, resume it
+		if (CD_AtomicDecrement(&client->jobs) == CD_CLIENT_MAX_PENDING - 1 && CD_BufferLength(client->buffers->input) > 0) {
+			CD_ReadFromClient(client);
+		}
+	}
+}
 
-			pthread_rwlock_rdlock(&client->lock.status);
-			if (client->status == CDClientDisconnect) {
-				if (self->job->type != CDClientDisconnectJob) {
-					CD_DestroyJob(self->job);
-					self->job = NULL;
-					client->jobs--;
-				}
-			}
-			pthread_rwlock_unlock(&client->lock.status);
+static
+void
+cd_WorkerRunJob (CDWorker* self, CDJob* job)
+{
+	if (job->type == CDCustomJob) {
+		CDCustomJobData* data = (CDCustomJobData*) job->data;
 
-			if (!self->job) {
-				continue;
-			}
+		data->callback(data->data);
 
-			if (self->job->type == CDClientConnectJob) {
-				CD_EventDispatch(self->server, "Client.connect", client);
+		CD_DestroyJob(job);
+	}
+	else if (CD_JOB_IS_PLAYER(job)) {
+		cd_WorkerRunClientJob(self, job);
+	}
+	else {
+		CD_DestroyJob(job);
+	}
+}
 
-				pthread_rwlock_wrlock(&client->lock.status);
-				if (client->status != CDClientDisconnect) {
-					client->status = CDClientIdle;
-				}
-				pthread_rwlock_unlock(&client->lock.status);
+static
+void
+cd_WorkerRunStrand (CDWorker* self, CDStrand* strand)
+{
+	for (int i = 0; i < CD_STRAND_BUDGET; i++) {
+		bool   last = false;
+		CDJob* job  = CD_StrandNextJob(strand, &last);
 
-				CD_DestroyJob(self->job);
+		if (!job) {
+			return;
+		}
 
-				if (CD_BufferLength(client->buffers->input) > 0) {
-					CD_ReadFromClient(client);
-				}
-			}
-			else if (self->job->type == CDClientProcessJob) {
-				CD_EventDispatch(self->server, "Client.process", client,
-					((CDClientProcessJobData*) self->job->data)->packet);
+		cd_WorkerRunJob(self, job);
 
-				CD_EventDispatch(self->server, "Client.processed", client,
-					((CDClientProcessJobData*) self->job->data)->packet);
+		if (last) {
+			return;
+		}
+	}
 
-				pthread_rwlock_wrlock(&client->lock.status);
-				if (client->status != CDClientDisconnect) {
-					client->status = CDClientIdle;
-				}
+	// still scheduled, go at the back of the queue so the other strands get a turn
+	CD_DeferJob(self->workers, CD_CreateExternalJob(CDStrandJob, (CDPointer) strand));
+}
 
-				client->jobs--;
-				pthread_rwlock_unlock(&client->lock.status);
+bool
+CD_RunWorker (CDWorker* self)
+{
+	assert(self);
 
-				CD_DestroyJob(self->job);
+	self->stopped = false;
+	self->seed    = ((uint32_t) self->id * 2654435761U) | 1;
 
-				if (CD_BufferLength(client->buffers->input) > 0) {
-					CD_ReadFromClient(client);
-				}
-			}
-			else if (self->job->type == CDClientDisconnectJob) {
-				while (true) {
-					pthread_rwlock_rdlock(&client->lock.status);
+	pthread_setspecific(self->workers->current, self);
 
-					if (client->jobs < 1) {
-						pthread_rwlock_unlock(&client->lock.status);
-						break;
-					}
+	CD_EventDispatch(self->server, "Worker.start!", self);
 
-					pthread_rwlock_unlock(&client->lock.status);
+	SLOG(self->server, LOG_INFO, "worker %d started", self->id);
 
-					usleep(1000);
-				}
+	while (self->working) {
+		self->job = CD_WaitJob(self->workers, self);
 
-				CD_EventDispatch(self->server, "Client.disconnect", client, (bool) ERROR(client));
+		if (!self->job) {
+			break;
+		}
 
-				CD_ListPush(self->server->disconnecting, (CDPointer) client);
+		SDEBUG(self->server, "worker %d running", self->id);
 
-				CD_ServerFlush(client->server, false);
+		if (self->job->type == CDStrandJob) {
+			CDStrand* strand = (CDStrand*) self->job->data;
 
-				CD_DestroyJob(self->job);
-			}
+			CD_DestroyJob(self->job);
+			self->job = NULL;
+
+			cd_WorkerRunStrand(self, strand);
 		}
+		else {
+			CDJob* job = self->job;
 
-		self->job = NULL;
+			self->job = NULL;
+
+			cd_WorkerRunJob(self, job);
+		}
 	}
 
 	CD_EventDispatch(self->server, "Worker.stopped", self);
@@ -223,5 +245,14 @@ CD_StopWorker (CDWorker* self)
 		continue;
 	}
 
+	// hand the jobs left on the deque back to the others
+	DO {
+		CDJob* job;
+
+		while ((job = (CDJob*) CD_DequeTake(self->jobs))) {
+			CD_AddJob(self->workers, job);
+		}
+	}
+
 	return true;
 }
@@ -38,7 +38,16 @@ CD_CreateWorkers (CDServer* server)
 	self->length = 0;
 	self->item   = NULL;
 
-	self->jobs = CD_CreateList();
+	self->queue.head   = NULL;
+	self->queue.tail   = NULL;
+	self->queue.length = 0;
+
+	self->parking.epoch   = 0;
+	self->parking.waiting = 0;
+
+	if (pthread_key_create(&self->current, NULL) != 0) {
+		CD_abort("pthread key failed to initialize");
+	}
 
 	if (pthread_attr_init(&self->attributes) != 0) {
 		CD_abort("pthread attribute failed to initialize");
@@ -60,6 +69,14 @@ CD_CreateWorkers (CDServer* server)
 		CD_abort("pthread cond failed to initialize");
 	}
 
+	if (pthread_spin_init(&self->lock.queue, PTHREAD_PROCESS_PRIVATE) != 0) {
+		CD_abort("pthread spinlock failed to initialize");
+	}
+
+	if (pthread_rwlock_init(&self->lock.workers, NULL) != 0) {
+		CD_abort("pthread rwlock failed to initialize");
+	}
+
 	return self;
 }
 
@@ -70,10 +87,20 @@ CD_DestroyWorkers (CDWorkers* self)
 
 	CD_StopWorkers(self);
 
-	CD_DestroyList(self->jobs);
+	while (self->queue.head) {
+		CDJob* job = self->queue.head;
+
+		self->queue.head = job->next;
+
+		CD_DestroyJob(job);
+	}
+
+	pthread_key_delete(self->current);
 
 	pthread_mutex_destroy(&self->lock.mutex);
 	pthread_cond_destroy(&self->lock.condition);
+	pthread_spin_destroy(&self->lock.queue);
+	pthread_rwlock_destroy(&self->lock.workers);
 
 	CD_free(self);
 }
@@ -85,6 +112,8 @@ CD_StopWorkers (CDWorkers* self)
 		CD_StopWorker(self->item[i]);
 	}
 
+	pthread_rwlock_wrlock(&self->lock.workers);
+
 	for (size_t i = 0; i < self->length; i++) {
 		CD_DestroyWorker(self->item[i]);
 	}
@@ -93,6 +122,8 @@ CD_StopWorkers (CDWorkers* self)
 
 	self->length = 0;
 	self->item   = NULL;
+
+	pthread_rwlock_unlock(&self->lock.workers);
 }
 
 CDWorker**
@@ -135,12 +166,16 @@ CD_KillWorkers (CDWorkers* self, size_t number)
 	pthread_cond_broadcast(&self->lock.condition);
 	pthread_mutex_unlock(&self->lock.mutex);
 
+	pthread_rwlock_wrlock(&self->lock.workers);
+
 	for (size_t i = self->length - 1; (self->length - i) < self->length; i--) {
 		CD_DestroyWorker(self->item[i]);
 	}
 
 	self->length -= number;
 	self->item    = CD_realloc(self->item, self->length * sizeof(CDWorker*));
+
+	pthread_rwlock_unlock(&self->lock.workers);
 }
 
 void
@@ -167,12 +202,16 @@ CD_KillWorkersAvoid (CDWorkers* self, size_t number, CDWorker* worker)
 	pthread_cond_broadcast(&self->lock.condition);
 	pthread_mutex_unlock(&self->lock.mutex);
 
+	pthread_rwlock_wrlock(&self->lock.workers);
+
 	for (size_t i = self->length - 1; (self->length - i) < self->length; i--) {
 		CD_DestroyWorker(self->item[i]);
 	}
 
 	self->length -= number;
 	self->item    = CD_realloc(self->item, self->length * sizeof(CDWorker*));
+
+	pthread_rwlock_unlock(&self->lock.workers);
 }
 
 CDWorkers*
@@ -188,33 +227,392 @@ CD_ConcatWorkers (CDWorkers* self, CDWorker** workers, size_t length)
 CDWorkers*
 CD_AppendWorker (CDWorkers* self, CDWorker* worker)
 {
+	pthread_rwlock_wrlock(&self->lock.workers);
+
 	self->item = CD_realloc(self->item, sizeof(CDWorker*) * ++self->length);
 
 	self->item[self->length - 1] = worker;
 
+	pthread_rwlock_unlock(&self->lock.workers);
+
 	return self;
 }
 
+static
+uint32_t
+cd_WorkerRandom (CDWorker* worker)
+{
+	uint32_t x = worker->seed;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return worker->seed = x;
+}
+
+static
+CDWorker*
+cd_CurrentWorker (CDWorkers* self)
+{
+	return (CDWorker*) pthread_getspecific(self->current);
+}
+
+/**
+ * Publish new work and wake parked workers.
+ *
+ * The epoch is bumped before looking at the parked count, and a worker registers
+ * as parked before checking the epoch again, so one of the two always sees the
+ * other and a wakeup can't get lost.
+ */
+static
+void
+cd_WorkersWake (CDWorkers* self, size_t jobs)
+{
+	CD_AtomicIncrement(&self->parking.epoch);
+
+	if (CD_AtomicGet(&self->parking.waiting) > 0) {
+		pthread_mutex_lock(&self->lock.mutex);
+
+		if (jobs > 1) {
+			pthread_cond_broadcast(&self->lock.condition);
+		}
+		else {
+			pthread_cond_signal(&self->lock.condition);
+		}
+
+		pthread_mutex_unlock(&self->lock.mutex);
+	}
+}
+
+static
+CDJob*
+cd_WorkersShift (CDWorkers* self, CDWorker* worker)
+{
+	CDJob* batch[CD_WORKERS_BATCH];
+	size_t length = 0;
+	size_t wanted = 1;
+
+	if (CD_AtomicGet(&self->queue.length) == 0) {
+		return NULL;
+	}
+
+	pthread_spin_lock(&self->lock.queue);
+
+	// take a fair share of the queue so the other workers can steal the rest
+	if (worker) {
+		wanted = self->queue.length / (self->length > 0 ? self->length : 1) + 1;
+
+		if (wanted > CD_WORKERS_BATCH) {
+			wanted = CD_WORKERS_BATCH;
+		}
+	}
+
+	while (length < wanted && self->queue.head) {
+		batch[length] = self->queue.head;
+
+		self->queue.head = batch[length]->next;
+		batch[length++]->next = NULL;
+	}
+
+	if (!self->queue.head) {
+		self->queue.tail = NULL;
+	}
+
+	CD_AtomicSub(&self->queue.length, length);
+
+	pthread_spin_unlock(&self->lock.queue);
+
+	if (length == 0) {
+		return NULL;
+	}
+
+	if (length > 1) {
+		// pushed backwards so the owner takes them in order
+		for (size_t i = length - 1; i > 0; i--) {
+			CD_DequePush(worker->jobs, (CDPointer) batch[i]);
+		}
+
+		cd_WorkersWake(self, length - 1);
+	}
+
+	return batch[0];
+}
+
+static
+CDJob*
+cd_WorkersSteal (CDWorkers* self, CDWorker* worker)
+{
+	CDJob* job = NULL;
+
+	pthread_rwlock_rdlock(&self->lock.workers);
+
+	if (self->length > 1) {
+		size_t start = cd_WorkerRandom(worker) % self->length;
+
+		for (size_t i = 0; i < self->length && !job; i++) {
+			CDWorker* victim = self->item[(start + i) % self->length];
+
+			if (victim != worker) {
+				job = (CDJob*) CD_DequeSteal(victim->jobs);
+			}
+		}
+	}
+
+	pthread_rwlock_unlock(&self->lock.workers);
+
+	return job;
+}
+
+static
+void
+cd_WorkersAppend (CDWorkers* self, CDJob** jobs, size_t length)
+{
+	for (size_t i = 0; i < length; i++) {
+		jobs[i]->next = (i + 1 < length) ? jobs[i + 1] : NULL;
+	}
+
+	pthread_spin_lock(&self->lock.queue);
+
+	if (self->queue.tail) {
+		self->queue.tail->next = jobs[0];
+	}
+	else {
+		self->queue.head = jobs[0];
+	}
+
+	self->queue.tail = jobs[length - 1];
+
+	CD_AtomicAdd(&self->queue.length, length);
+
+	pthread_spin_unlock(&self->lock.queue);
+}
+
 bool
 CD_HasJobs (CDWorkers* self)
 {
-	return CD_ListLength(self->jobs) > 0;
+	bool result = CD_AtomicGet(&self->queue.length) > 0;
+
+	if (!result) {
+		pthread_rwlock_rdlock(&self->lock.workers);
+
+		for (size_t i = 0; i < self->length && !result; i++) {
+			result = CD_DequeLength(self->item[i]->jobs) > 0;
+		}
+
+		pthread_rwlock_unlock(&self->lock.workers);
+	}
+
+	return result;
 }
 
 void
 CD_AddJob (CDWorkers* self, CDJob* job)
 {
-	pthread_mutex_lock(&self->lock.mutex);
+	CD_AddJobs(self, &job, 1);
+}
 
-	CD_ListPush(self->jobs, (CDPointer) job);
+void
+CD_AddJobs (CDWorkers* self, CDJob** jobs, size_t length)
+{
+	CDWorker* worker = cd_CurrentWorker(self);
 
-	pthread_cond_signal(&self->lock.condition);
+	assert(self);
 
-	pthread_mutex_unlock(&self->lock.mutex);
+	if (length == 0) {
+		return;
+	}
+
+	if (worker) {
+		for (size_t i = length; i > 0; i--) {
+			CD_DequePush(worker->jobs, (CDPointer) jobs[i - 1]);
+		}
+	}
+	else {
+		cd_WorkersAppend(self, jobs, length);
+	}
+
+	cd_WorkersWake(self, length);
+}
+
+void
+CD_DeferJob (CDWorkers* self, CDJob* job)
+{
+	assert(self);
+	assert(job);
+
+	cd_WorkersAppend(self, &job, 1);
+	cd_WorkersWake(self, 1);
 }
 
 CDJob*
 CD_NextJob (CDWorkers* self)
 {
-	return (CDJob*) CD_ListShift(self->jobs);
+	CDWorker* worker = cd_CurrentWorker(self);
+	CDJob*    job;
+
+	if (worker && (job = (CDJob*) CD_DequeTake(worker->jobs))) {
+		return job;
+	}
+
+	if ((job = cd_WorkersShift(self, worker))) {
+		return job;
+	}
+
+	if (worker) {
+		return cd_WorkersSteal(self, worker);
+	}
+
+	return NULL;
+}
+
+CDJob*
+CD_WaitJob (CDWorkers* self, CDWorker* worker)
+{
+	assert(self);
+	assert(worker);
+
+	while (worker->working) {
+		uint32_t epoch = CD_AtomicGet(&self->parking.epoch);
+		CDJob*   job;
+
+		if ((job = CD_NextJob(self))) {
+			return job;
+		}
+
+		pthread_mutex_lock(&self->lock.mutex);
+
+		CD_AtomicIncrement(&self->parking.waiting);
+
+		while (worker->working && CD_AtomicGet(&self->parking.epoch) == epoch) {
+			pthread_cond_wait(&self->lock.condition, &self->lock.mutex);
+		}
+
+		CD_AtomicDecrement(&self->parking.waiting);
+
+		pthread_mutex_unlock(&self->lock.mutex);
+	}
+
+	return NULL;
+}
+
+CDStrand*
+CD_CreateStrand (void)
+{
+	CDStrand* self = CD_malloc(sizeof(CDStrand));
+
+	self->head      = NULL;
+	self->tail      = NULL;
+	self->scheduled = false;
+	self->closed    = false;
+
+	if (pthread_spin_init(&self->lock, PTHREAD_PROCESS_PRIVATE) != 0) {
+		CD_abort("pthread spinlock failed to initialize");
+	}
+
+	return self;
+}
+
+void
+CD_DestroyStrand (CDStrand* self)
+{
+	assert(self);
+
+	while (self->head) {
+		CDJob* job = self->head;
+
+		self->head = job->next;
+
+		CD_DestroyJob(job);
+	}
+
+	pthread_spin_destroy(&self->lock);
+
+	CD_free(self);
+}
+
+static
+bool
+cd_StrandAddJob (CDWorkers* self, CDStrand* strand, CDJob* job, bool close)
+{
+	bool schedule;
+
+	job->next = NULL;
+
+	pthread_spin_lock(&strand->lock);
+
+	if (strand->closed) {
+		pthread_spin_unlock(&strand->lock);
+
+		CD_DestroyJob(job);
+
+		return false;
+	}
+
+	if (strand->tail) {
+		strand->tail->next = job;
+	}
+	else {
+		strand->head = job;
+	}
+
+	strand->tail   = job;
+	strand->closed = close;
+
+	schedule          = !strand->scheduled;
+	strand->scheduled = true;
+
+	pthread_spin_unlock(&strand->lock);
+
+	if (schedule) {
+		CD_AddJob(self, CD_CreateExternalJob(CDStrandJob, (CDPointer) strand));
+	}
+
+	return true;
+}
+
+bool
+CD_StrandAddJob (CDWorkers* self, CDStrand* strand, CDJob* job)
+{
+	assert(self);
+	assert(strand);
+	assert(job);
+
+	return cd_StrandAddJob(self, strand, job, false);
+}
+
+bool
+CD_StrandCloseWithJob (CDWorkers* self, CDStrand* strand, CDJob* job)
+{
+	assert(self);
+	assert(strand);
+	assert(job);
+
+	return cd_StrandAddJob(self, strand, job, true);
+}
+
+CDJob*
+CD_StrandNextJob (CDStrand* self, bool* last)
+{
+	CDJob* job;
+
+	assert(self);
+
+	pthread_spin_lock(&self->lock);
+
+	if ((job = self->head)) {
+		if (!(self->head = job->next)) {
+			self->tail = NULL;
+		}
+
+		job->next = NULL;
+		*last     = self->closed && !self->head;
+	}
+	else {
+		self->scheduled = false;
+	}
+
+	pthread_spin_unlock(&self->lock);
+
+	return job;
 }
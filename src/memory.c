@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/common.h>
+
+#include <sys/mman.h>
+
+static
+void
+cd_SlabCacheDestroy (void* data)
+{
+	CDSlabCache* cache = (CDSlabCache*) data;
+	CDSlabPool*  self  = cache->pool;
+
+	// an exiting thread gives its slabs back to the pool
+	pthread_mutex_lock(&self->lock);
+
+	while (cache->head) {
+		CDSlab* slab = cache->head;
+
+		cache->head = slab->next;
+		slab->next  = self->free;
+		self->free  = slab;
+	}
+
+	if (cache->previous) {
+		cache->previous->next = cache->next;
+	}
+	else {
+		self->caches = cache->next;
+	}
+
+	if (cache->next) {
+		cache->next->previous = cache->previous;
+	}
+
+	pthread_mutex_unlock(&self->lock);
+
+	CD_free(cache);
+}
+
+static
+CDSlabCache*
+cd_SlabCacheGet (CDSlabPool* self)
+{
+	CDSlabCache* cache;
+
+	if ((cache = (CDSlabCache*) pthread_getspecific(self->cache)) == NULL) {
+		cache = CD_malloc(sizeof(CDSlabCache));
+
+		cache->pool     = self;
+		cache->head     = NULL;
+		cache->length   = 0;
+		cache->previous = NULL;
+
+		pthread_mutex_lock(&self->lock);
+
+		if ((cache->next = self->caches)) {
+			cache->next->previous = cache;
+		}
+
+		self->caches = cache;
+
+		pthread_mutex_unlock(&self->lock);
+
+		pthread_setspecific(self->cache, cache);
+	}
+
+	return cache;
+}
+
+/**
+ * Get a new block to carve slabs from, must be called with the pool lock held
+ */
+static
+void
+cd_SlabPoolGrow (CDSlabPool* self)
+{
+	size_t length = CD_SLAB_BLOCK_SIZE;
+	void*  block  = NULL;
+
+	if (self->size > length) {
+		length = self->size;
+	}
+
+#ifdef MADV_HUGEPAGE
+	if (self->huge) {
+		length = (length + CD_SLAB_BLOCK_SIZE - 1) & ~((size_t) CD_SLAB_BLOCK_SIZE - 1);
+
+		// an aligned block can be backed by huge pages, it's only a hint to the kernel
+		if (posix_memalign(&block, CD_SLAB_BLOCK_SIZE, length) == 0) {
+			madvise(block, length, MADV_HUGEPAGE);
+		}
+		else {
+			block = NULL;
+		}
+	}
+#endif
+
+	if (block == NULL) {
+		block = CD_malloc(length);
+	}
+
+	self->blocks.item = CD_realloc(self->blocks.item, sizeof(void*) * (self->blocks.length + 1));
+	self->blocks.item[self->blocks.length++] = block;
+
+	self->fresh.next = (uint8_t*) block;
+	self->fresh.end  = (uint8_t*) block + (length / self->size) * self->size;
+}
+
+CDSlabPool*
+CD_CreateSlabPool (size_t size, bool huge)
+{
+	CDSlabPool* self = CD_malloc(sizeof(CDSlabPool));
+
+	assert(size > 0);
+
+	if (pthread_mutex_init(&self->lock, NULL) != 0) {
+		CD_abort("pthread mutex failed to initialize");
+	}
+
+	if (pthread_key_create(&self->cache, cd_SlabCacheDestroy) != 0) {
+		CD_abort("pthread key failed to initialize");
+	}
+
+	// slabs start on a cache line so two of them never share one
+	self->size = (size + 63) & ~((size_t) 63);
+	self->huge = huge;
+	self->free = NULL;
+
+	self->fresh.next = NULL;
+	self->fresh.end  = NULL;
+
+	self->blocks.item   = NULL;
+	self->blocks.length = 0;
+
+	self->caches = NULL;
+
+	self->stats.live   = 0;
+	self->stats.cached = 0;
+
+	return self;
+}
+
+void
+CD_DestroySlabPool (CDSlabPool* self)
+{
+	assert(self);
+
+	// thread caches left are freed here, their destructors won't run anymore
+	pthread_key_delete(self->cache);
+
+	while (self->caches) {
+		CDSlabCache* cache = self->caches;
+
+		self->caches = cache->next;
+
+		CD_free(cache);
+	}
+
+	for (size_t i = 0; i < self->blocks.length; i++) {
+		CD_free(self->blocks.item[i]);
+	}
+
+	CD_free(self->blocks.item);
+
+	pthread_mutex_destroy(&self->lock);
+
+	CD_free(self);
+}
+
+void*
+CD_SlabAlloc (CDSlabPool* self)
+{
+	CDSlabCache* cache;
+	CDSlab*      slab;
+
+	assert(self);
+
+	cache = cd_SlabCacheGet(self);
+
+	if ((slab = cache->head)) {
+		cache->head = slab->next;
+		cache->length--;
+
+		CD_AtomicDecrement(&self->stats.cached);
+	}
+	else {
+		pthread_mutex_lock(&self->lock);
+
+		if ((slab = self->free)) {
+			self->free = slab->next;
+
+			CD_AtomicDecrement(&self->stats.cached);
+		}
+		else {
+			if (self->fresh.next == self->fresh.end) {
+				cd_SlabPoolGrow(self);
+			}
+
+			slab              = (CDSlab*) self->fresh.next;
+			self->fresh.next += self->size;
+		}
+
+		pthread_mutex_unlock(&self->lock);
+	}
+
+	CD_AtomicIncrement(&self->stats.live);
+
+	return slab;
+}
+
+void
+CD_SlabFree (CDSlabPool* self, void* pointer)
+{
+	CDSlabCache* cache;
+	CDSlab*      slab = (CDSlab*) pointer;
+
+	assert(self);
+
+	if (slab == NULL) {
+		return;
+	}
+
+	CD_AtomicDecrement(&self->stats.live);
+	CD_AtomicIncrement(&self->stats.cached);
+
+	cache = cd_SlabCacheGet(self);
+
+	if (cache->length < CD_SLAB_CACHE_LENGTH) {
+		slab->next  = cache->head;
+		cache->head = slab;
+		cache->length++;
+	}
+	else {
+		pthread_mutex_lock(&self->lock);
+
+		slab->next = self->free;
+		self->free = slab;
+
+		pthread_mutex_unlock(&self->lock);
+	}
+}
@@ -25,6 +25,173 @@
 
 #include <craftd/protocols/survival/Buffer.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Decode the sequence at the head of the input, malformed ones and the ones outside the BMP are U+FFFD */
+static inline
+size_t
+sv_UTF8NextUCS2 (const uint8_t* input, size_t size, uint16_t* ch)
+{
+	uint8_t lead = input[0];
+
+	*ch = 0xFFFD;
+
+	if (lead < 0x80) {
+		*ch = lead;
+
+		return 1;
+	}
+
+	if ((lead & 0xE0) == 0xC0 && size > 1 && (input[1] & 0xC0) == 0x80) {
+		*ch = ((lead & 0x1F) << 6) | (input[1] & 0x3F);
+
+		return 2;
+	}
+
+	if ((lead & 0xF0) == 0xE0 && size > 2 && (input[1] & 0xC0) == 0x80 && (input[2] & 0xC0) == 0x80) {
+		*ch = ((lead & 0x0F) << 12) | ((input[1] & 0x3F) << 6) | (input[2] & 0x3F);
+
+		return 3;
+	}
+
+	if ((lead & 0xF8) == 0xF0 && size > 3 && (input[1] & 0xC0) == 0x80 && (input[2] & 0xC0) == 0x80 && (input[3] & 0xC0) == 0x80) {
+		return 4;
+	}
+
+	return 1;
+}
+
+size_t
+SV_UTF8ToUCS2Length (const uint8_t* input, size_t size)
+{
+	size_t   i      = 0;
+	size_t   length = 0;
+	uint16_t ch;
+
+	while (i < size) {
+		i += (input[i] < 0x80) ? 1 : sv_UTF8NextUCS2(input + i, size - i, &ch);
+
+		length++;
+	}
+
+	return length;
+}
+
+size_t
+SV_UTF8ToUCS2 (const uint8_t* input, size_t size, uint8_t* output)
+{
+	size_t i      = 0;
+	size_t length = 0;
+
+	while (i < size) {
+		#ifdef __SSE2__
+		// widen 16 ASCII characters at a time
+		while (i + 16 <= size) {
+			__m128i data = _mm_loadu_si128((const __m128i*) (input + i));
+
+			if (_mm_movemask_epi8(data) != 0) {
+				break;
+			}
+
+			_mm_storeu_si128((__m128i*) (output + length * 2),      _mm_unpacklo_epi8(_mm_setzero_si128(), data));
+			_mm_storeu_si128((__m128i*) (output + length * 2 + 16), _mm_unpackhi_epi8(_mm_setzero_si128(), data));
+
+			i      += 16;
+			length += 16;
+		}
+
+		if (i >= size) {
+			break;
+		}
+		#endif
+
+		uint16_t ch;
+
+		i += sv_UTF8NextUCS2(input + i, size - i, &ch);
+
+		output[length * 2]     = ch >> 8;
+		output[length * 2 + 1] = ch & 0xFF;
+
+		length++;
+	}
+
+	return length;
+}
+
+size_t
+SV_UCS2ToUTF8 (const uint8_t* input, size_t length, uint8_t* output)
+{
+	size_t i    = 0;
+	size_t size = 0;
+
+	while (i < length) {
+		#ifdef __SSE2__
+		// narrow 8 ASCII characters at a time, a lane is ASCII if its high byte is 0 and low byte is below 0x80
+		while (i + 8 <= length) {
+			__m128i data  = _mm_loadu_si128((const __m128i*) (input + i * 2));
+			__m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(data, _mm_set1_epi16(0x80FF)), _mm_setzero_si128());
+
+			if (_mm_movemask_epi8(ascii) != 0xFFFF) {
+				break;
+			}
+
+			_mm_storel_epi64((__m128i*) (output + size), _mm_packus_epi16(_mm_srli_epi16(data, 8), _mm_setzero_si128()));
+
+			i    += 8;
+			size += 8;
+		}
+
+		if (i >= length) {
+			break;
+		}
+		#endif
+
+		uint16_t ch = (input[i * 2] << 8) | input[i * 2 + 1];
+
+		if (ch == 0xFFFD) {
+			output[size++] = '?';
+		}
+		else if (ch < 0x80) {
+			output[size++] = ch;
+		}
+		else if (ch < 0x800) {
+			output[size++] = (ch >> 6) | 0xC0;
+			output[size++] = (ch & 0x3F) | 0x80;
+		}
+		else if (ch < 0xFFFF) {
+			output[size++] = (ch >> 12) | 0xE0;
+			output[size++] = ((ch >> 6) & 0x3F) | 0x80;
+			output[size++] = (ch & 0x3F) | 0x80;
+		}
+
+		i++;
+	}
+
+	return size;
+}
+
+/* Max size of a run of fixed size fields read at once */
+#define SV_FORMAT_SPAN 64
+
+/* Size on the wire of a fixed size format field, 0 for the variable size ones */
+static
+size_t
+sv_FormatFieldSize (char field)
+{
+	switch (field) {
+		case 'b': case 'c': return SVByteSize;
+		case 's':           return SVShortSize;
+		case 'i':           return SVIntegerSize;
+		case 'l':           return SVLongSize;
+		case 'f':           return SVFloatSize;
+		case 'd':           return SVDoubleSize;
+		case 'B':           return SVBooleanSize;
+		default:            return 0;
+	}
+}
+
 void
 SV_BufferAddFormat (CDBuffer* self, const char* format, ...)
 {
@@ -33,23 +200,93 @@ SV_BufferAddFormat (CDBuffer* self, const char* format, ...)
 	va_start(ap, format);
 
 	while (*format != '\0') {
-		switch (*format) {
-			case 'b': SV_BufferAddByte(self,    va_arg(ap, int));  break;
-			case 'c': SV_BufferAddByte(self,    va_arg(ap, uint));  break;
-			case 's': SV_BufferAddShort(self,   va_arg(ap, int));  break;
-			case 'i': SV_BufferAddInteger(self, va_arg(ap, int));  break;
-			case 'l': SV_BufferAddLong(self,    va_arg(ap, long)); break;
-
-			case 'f': SV_BufferAddFloat(self,  va_arg(ap, double)); break;
-			case 'd': SV_BufferAddDouble(self, va_arg(ap, double)); break;
-
-			case 'B': SV_BufferAddBoolean(self, va_arg(ap, int));          break;
-			case 'S': SV_BufferAddString(self,  va_arg(ap, CDString*));    break;
-			case 'U': SV_BufferAddString16(self,  va_arg(ap, CDString*));  break;
-			case 'M': SV_BufferAddMetadata(self, va_arg(ap, SVMetadata*)); break;
+		struct evbuffer_iovec span;
+		uint8_t*              output;
+		size_t                size = 0;
+
+		for (const char* field = format; sv_FormatFieldSize(*field) > 0; field++) {
+			size += sv_FormatFieldSize(*field);
+		}
+
+		if (size == 0) {
+			switch (*format) {
+				case 'S': SV_BufferAddString(self,   va_arg(ap, CDString*));   break;
+				case 'U': SV_BufferAddString16(self, va_arg(ap, CDString*));   break;
+				case 'M': SV_BufferAddMetadata(self, va_arg(ap, SVMetadata*)); break;
+			}
+
+			format++;
+
+			continue;
+		}
+
+		// consecutive fixed size fields are encoded straight into a single span
+		if (evbuffer_reserve_space(self->raw, size, &span, 1) < 1) {
+			break;
 		}
 
-		format++;
+		output = (uint8_t*) span.iov_base;
+
+		for (; sv_FormatFieldSize(*format) > 0; format++) {
+			switch (*format) {
+				case 'b': {
+					SVByte data = va_arg(ap, int);
+
+					memcpy(output, &data, SVByteSize);
+				} break;
+
+				case 'c': {
+					SVByte data = va_arg(ap, uint);
+
+					memcpy(output, &data, SVByteSize);
+				} break;
+
+				case 's': {
+					SVShort data = htons(va_arg(ap, int));
+
+					memcpy(output, &data, SVShortSize);
+				} break;
+
+				case 'i': {
+					SVInteger data = htonl(va_arg(ap, int));
+
+					memcpy(output, &data, SVIntegerSize);
+				} break;
+
+				case 'l': {
+					SVLong data = va_arg(ap, long);
+					       data = htonll(data);
+
+					memcpy(output, &data, SVLongSize);
+				} break;
+
+				case 'f': {
+					SVFloat data = va_arg(ap, double);
+					        data = htonf(data);
+
+					memcpy(output, &data, SVFloatSize);
+				} break;
+
+				case 'd': {
+					SVDouble data = va_arg(ap, double);
+					         data = htond(data);
+
+					memcpy(output, &data, SVDoubleSize);
+				} break;
+
+				case 'B': {
+					SVBoolean data = va_arg(ap, int);
+
+					memcpy(output, &data, SVBooleanSize);
+				} break;
+			}
+
+			output += sv_FormatFieldSize(*format);
+		}
+
+		span.iov_len = size;
+
+		evbuffer_commit_space(self->raw, &span, 1);
 	}
 
 	va_end(ap);
@@ -110,95 +347,63 @@ SV_BufferAddBoolean (CDBuffer* self, SVBoolean data)
 void
 SV_BufferAddString (CDBuffer* self, CDString* data)
 {
-	CDString* sanitized = SV_StringSanitize(data);
+	// strings already known to be valid are sent as they are
+	CDString* sanitized = data->clean ? data : SV_StringSanitize(data);
 
 	SVShort size = htons(CD_StringSize(sanitized));
 
 	evbuffer_add(self->raw, &size, SVShortSize);
 	evbuffer_add(self->raw, CD_StringContent(sanitized), CD_StringSize(sanitized));
 
-	SV_DestroyString(sanitized);
+	if (sanitized != data) {
+		SV_DestroyString(sanitized);
+	}
 }
 
 void
 SV_BufferAddString16 (CDBuffer* self, CDString* data)
 {
-	CDString* sanitized = SV_StringSanitize(data);
-
-	SVShort size = htons(CD_StringLength(sanitized));
+	CDString*             sanitized = data->clean ? data : SV_StringSanitize(data);
+	size_t                size      = CD_StringSize(sanitized);
+	struct evbuffer_iovec span;
+
+	// the length and the characters are transcoded straight into the output
+	if (evbuffer_reserve_space(self->raw, SVShortSize + size * 2, &span, 1) < 1) {
+		if (sanitized != data) {
+			SV_DestroyString(sanitized);
+		}
 
-	evbuffer_add(self->raw, &size, SVShortSize);
+		return;
+	}
 
-	int16_t* ucs2 = CD_alloc(CD_StringLength(sanitized) * sizeof(int16_t));
+	uint8_t* output = (uint8_t*) span.iov_base;
+	size_t   length = SV_UTF8ToUCS2((const uint8_t*) CD_StringContent(sanitized), size, output + SVShortSize);
+	SVShort  prefix = htons(length);
 
-	for (size_t i = 0; i < CD_StringLength(sanitized); i++) {
-		CDString*   ch    = CD_CharAt(sanitized, i);
-		const char* input = CD_StringContent(ch);
-		short       uch   = 0;
+	memcpy(output, &prefix, SVShortSize);
 
-		if ((input[0] & 0x80) == 0x00) {
-			uch = input[0];
-		}
-		else if ((input[0] & 0xE0) == 0xE0) {
-			if (input[1] == 0 || input[2] == 0) {
-				uch = 0xfffd;
-			}
-			else {
-				uch = ((input[0] & 0x0F) << 12) | ((input[1] & 0x3F) << 6) | (input[2] & 0x3F);
-			}
-		}
-		else if ((input[0] & 0xC0) == 0xC0) {
-			if (input[1] == 0) {
-				uch = 0xfffd;
-			}
-			else {
-				uch = ((input[0] & 0x1F) << 6) | (input[1] & 0x3F);
-			}
-		}
-		else {
-			uch = 0xfffd;
-		}
+	span.iov_len = SVShortSize + length * 2;
 
-		CD_DestroyString(ch);
+	evbuffer_commit_space(self->raw, &span, 1);
 
-		ucs2[i] = htons(uch);
+	if (sanitized != data) {
+		SV_DestroyString(sanitized);
 	}
-
-	evbuffer_add(self->raw, ucs2, CD_StringLength(sanitized) * sizeof(int16_t));
-
-	CD_free(ucs2);
-	CD_DestroyString(sanitized);
 }
 
 void
 SV_BufferAddMetadata (CDBuffer* self, SVMetadata* data)
 {
-	// Format strings of the different metadata types
-	static char* formats[] = { "b", "s", "i", "f", "S" };
+	struct evbuffer_iovec span;
+	size_t                size = SV_MetadataSize(data);
 
-	for (size_t i = 0; i < data->length; i++) {
-		SV_BufferAddByte(self, data->item[i]->type);
-		
-		if (data->item[i]->type == SVTypeShortByteShort) {
-			SV_BufferAddFormat(self, "sbs",
-				data->item[i]->data.sbs.first,
-				data->item[i]->data.sbs.second,
-				data->item[i]->data.sbs.third
-			);
-		}
-		else if (data->item[i]->type == SVTypeIntIntInt) {
-			SV_BufferAddFormat(self, "iii",
-				data->item[i]->data.iii.first,
-				data->item[i]->data.iii.second,
-				data->item[i]->data.iii.third
-			);
-		}
-		else {
-			SV_BufferAddFormat(self, formats[data->item[i]->type], data->item[i]->data);
-		}
+	if (evbuffer_reserve_space(self->raw, size, &span, 1) < 1) {
+		return;
 	}
 
-	SV_BufferAddByte(self, 127);
+	span.iov_len = SV_MetadataToByteArray(data, (uint8_t*) span.iov_base);
+
+	evbuffer_commit_space(self->raw, &span, 1);
 }
 
 void
@@ -209,24 +414,91 @@ SV_BufferRemoveFormat (CDBuffer* self, const char* format, ...)
 	va_start(ap, format);
 
 	while (*format != '\0') {
-		CDPointer pointer = va_arg(ap, CDPointer);
+		uint8_t  span[SV_FORMAT_SPAN];
+		uint8_t* input;
+		size_t   size = 0;
+
+		for (const char* field = format; sv_FormatFieldSize(*field) > 0; field++) {
+			if (size + sv_FormatFieldSize(*field) > SV_FORMAT_SPAN) {
+				break;
+			}
+
+			size += sv_FormatFieldSize(*field);
+		}
 
-		switch (*format) {
-			case 'b': *((SVByte*) pointer)    = SV_BufferRemoveByte(self);    break;
-			case 's': *((SVShort*) pointer)   = SV_BufferRemoveShort(self);   break;
-			case 'i': *((SVInteger*) pointer) = SV_BufferRemoveInteger(self); break;
-			case 'l': *((SVLong*) pointer)    = SV_BufferRemoveLong(self);    break;
+		if (size == 0) {
+			CDPointer pointer = va_arg(ap, CDPointer);
 
-			case 'f': *((SVFloat*)  pointer) = SV_BufferRemoveFloat(self);  break;
-			case 'd': *((SVDouble*) pointer) = SV_BufferRemoveDouble(self); break;
+			switch (*format) {
+				case 'S': *((SVString*) pointer)    = SV_BufferRemoveString(self);   break;
+				case 'U': *((SVString*) pointer)    = SV_BufferRemoveString16(self); break;
+				case 'M': *((SVMetadata**) pointer) = SV_BufferRemoveMetadata(self); break;
+			}
+
+			format++;
 
-			case 'B': *((SVBoolean*) pointer)   = SV_BufferRemoveBoolean(self);  break;
-			case 'S': *((SVString*) pointer)    = SV_BufferRemoveString(self);   break;
-			case 'U': *((SVString*) pointer)    = SV_BufferRemoveString16(self); break;
-			case 'M': *((SVMetadata**) pointer) = SV_BufferRemoveMetadata(self); break;
+			continue;
 		}
 
-		format++;
+		// consecutive fixed size fields are removed with a single copy, missing data reads as 0
+		memset(span, 0, size);
+		evbuffer_remove(self->raw, span, size);
+
+		for (input = span; input < span + size; format++) {
+			CDPointer pointer = va_arg(ap, CDPointer);
+
+			switch (*format) {
+				case 'b': case 'c': {
+					memcpy((SVByte*) pointer, input, SVByteSize);
+				} break;
+
+				case 's': {
+					SVShort data;
+
+					memcpy(&data, input, SVShortSize);
+
+					*((SVShort*) pointer) = ntohs(data);
+				} break;
+
+				case 'i': {
+					SVInteger data;
+
+					memcpy(&data, input, SVIntegerSize);
+
+					*((SVInteger*) pointer) = ntohl(data);
+				} break;
+
+				case 'l': {
+					SVLong data;
+
+					memcpy(&data, input, SVLongSize);
+
+					*((SVLong*) pointer) = ntohll(data);
+				} break;
+
+				case 'f': {
+					SVFloat data;
+
+					memcpy(&data, input, SVFloatSize);
+
+					*((SVFloat*) pointer) = ntohf(data);
+				} break;
+
+				case 'd': {
+					SVDouble data;
+
+					memcpy(&data, input, SVDoubleSize);
+
+					*((SVDouble*) pointer) = ntohd(data);
+				} break;
+
+				case 'B': {
+					memcpy((SVBoolean*) pointer, input, SVBooleanSize);
+				} break;
+			}
+
+			input += sv_FormatFieldSize(*format);
+		}
 	}
 
 	va_end(ap);
@@ -318,8 +590,10 @@ SV_BufferRemoveString (CDBuffer* self)
 
 	data[length] = '\0';
 
-	result           = CD_CreateStringFromBuffer(data, length + 1);
-	result->external = false;
+	// the terminator isn't part of the string
+	result            = CD_CreateStringFromBuffer(data, length);
+	result->external  = false;
+	result->raw->mlen = length + 1;
 
 	return result;
 }
@@ -327,53 +601,38 @@ SV_BufferRemoveString (CDBuffer* self)
 SVString
 SV_BufferRemoveString16 (CDBuffer* self)
 {
-	int16_t*  data   = NULL;
+	uint8_t*  data   = NULL;
 	char*     string = NULL;
 	SVShort   length = 0;
-	SVShort   size   = 0;
+	size_t    size   = 0;
 	CDString* result;
 
 	evbuffer_remove(self->raw, &length, SVShortSize);
 
 	length = ntohs(length);
-	data   = CD_alloc(length * sizeof(int16_t));
-
-	evbuffer_remove(self->raw, data, length * sizeof(int16_t));
-
-	for (size_t i = 0; i < length; i++) {
-		uint16_t ch = ntohs(data[i]);
 
-		if (ch == 0xfffd) {
-			string = CD_realloc(string, (size += 1));
-
-			string[size - 1] = '?';
-		}
-		else if (ch < 0x80) {
-			string = CD_realloc(string, (size += 1));
+	if (length < 0) {
+		length = 0;
+	}
 
-			string[size - 1] = ch;
-		}
-		else if (ch >= 0x80  && ch < 0x800) {
-			string = CD_realloc(string, (size += 2));
+	// decodes in place when the characters are already contiguous
+	if ((data = evbuffer_pullup(self->raw, length * 2)) == NULL) {
+		length = 0;
+	}
 
-			string[size - 2] = (ch >> 6) | 0xC0;
-			string[size - 1] = (ch & 0x3F) | 0x80;
-		}
-		else if (ch >= 0x800 && ch < 0xFFFF) {
-			string = CD_realloc(string, (size += 3));
+	string = CD_malloc(length * 3 + 1);
+	size   = SV_UCS2ToUTF8(data, length, (uint8_t*) string);
 
-			string[size - 3] = (ch >> 12) | 0xE0;
-			string[size - 2] = ((ch >> 6) & 0x3F) | 0x80;
-			string[size - 1] = (ch & 0x3F) | 0x80;
-		}
-	}
+	evbuffer_drain(self->raw, length * 2);
 
 	// A lot of code relys on the base string being null terminated.
-	string = CD_realloc(string, size+1);
+	string       = CD_realloc(string, size + 1);
 	string[size] = '\0';
 
-	result           = CD_CreateStringFromBuffer(string, size);
-	result->external = false;
+	// the terminator is allocated too, and bdestroy won't free an empty buffer with mlen 0
+	result            = CD_CreateStringFromBuffer(string, size);
+	result->external  = false;
+	result->raw->mlen = size + 1;
 
 	return result;
 }
@@ -395,8 +654,9 @@ SV_BufferRemoveMetadata (CDBuffer* self)
 			break;
 		}
 
-		current       = SV_CreateData();
-		current->type = type >> 5;
+		current        = SV_CreateData();
+		current->type  = ((uint8_t) type) >> 5;
+		current->index = type & 0x1F;
 
 		if (current->type == SVTypeShortByteShort) {
 			SV_BufferRemoveFormat(self, "sbs",
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/protocols/survival/ChunkView.h>
+
+#define SV_CHUNK_VIEW_HALF (SV_CHUNK_VIEW_SIZE / 2)
+
+static const uint32_t sv_ChunkViewWindow[SV_CHUNK_VIEW_SIZE] = {
+	[0 ... SV_CHUNK_VIEW_SIZE - 1] = UINT32_MAX
+};
+
+static
+int
+sv_CompareOffset (const void* a, const void* b)
+{
+	const SVChunkPosition* first  = (const SVChunkPosition*) a;
+	const SVChunkPosition* second = (const SVChunkPosition*) b;
+
+	return (first->x * first->x + first->z * first->z) - (second->x * second->x + second->z * second->z);
+}
+
+/**
+ * Express the rows of a window relative to a center moved by (dx, dz),
+ * whatever falls out of the window is dropped.
+ */
+static
+void
+sv_ChunkViewShift (const uint32_t* from, uint32_t* to, int64_t dx, int64_t dz)
+{
+	for (int64_t i = 0; i < SV_CHUNK_VIEW_SIZE; i++) {
+		int64_t source = i + dx;
+
+		if (source < 0 || source >= SV_CHUNK_VIEW_SIZE || dz >= 32 || dz <= -32) {
+			to[i] = 0;
+		}
+		else if (dz >= 0) {
+			to[i] = from[source] >> dz;
+		}
+		else {
+			to[i] = from[source] << -dz;
+		}
+	}
+}
+
+/**
+ * Get the row and bit of a chunk in the window
+ *
+ * @return false if the chunk is out of the window
+ */
+static inline
+bool
+sv_ChunkViewLocate (SVChunkView* self, SVChunkPosition position, int* row, int* bit)
+{
+	int64_t x = (int64_t) position.x - self->center.x + SV_CHUNK_VIEW_HALF;
+	int64_t z = (int64_t) position.z - self->center.z + SV_CHUNK_VIEW_HALF;
+
+	if (x < 0 || x >= SV_CHUNK_VIEW_SIZE || z < 0 || z >= SV_CHUNK_VIEW_SIZE) {
+		return false;
+	}
+
+	*row = x;
+	*bit = z;
+
+	return true;
+}
+
+/**
+ * Walk the bits of a window calling unload on the chunks, relative to the given center
+ */
+static
+void
+sv_ChunkViewUnload (SVChunkView* self, uint32_t* rows, SVChunkPosition center, SVChunkViewCallback unload, CDPointer context)
+{
+	for (int i = 0; i < SV_CHUNK_VIEW_SIZE; i++) {
+		while (rows[i]) {
+			int bit = __builtin_ctz(rows[i]);
+
+			rows[i] &= rows[i] - 1;
+
+			SVChunkPosition position = {
+				.x = center.x + i - SV_CHUNK_VIEW_HALF,
+				.z = center.z + bit - SV_CHUNK_VIEW_HALF
+			};
+
+			if (unload) {
+				unload(self, position, context);
+			}
+		}
+	}
+}
+
+SVChunkView*
+SV_CreateChunkView (int radius, int margin, time_t grace)
+{
+	SVChunkView* self = CD_malloc(sizeof(SVChunkView));
+
+	assert(radius >= 0 && margin >= 0 && radius + margin < SV_CHUNK_VIEW_HALF);
+
+	self->center.x = 0;
+	self->center.z = 0;
+	self->radius   = radius;
+	self->margin   = margin;
+	self->grace    = grace;
+
+	memset(self->loaded, 0, sizeof(self->loaded));
+	memset(self->leaving, 0, sizeof(self->leaving));
+	memset(self->area, 0, sizeof(self->area));
+	memset(self->keep, 0, sizeof(self->keep));
+
+	self->stats.kept = 0;
+
+	for (int x = -(radius + margin); x <= radius + margin; x++) {
+		for (int z = -(radius + margin); z <= radius + margin; z++) {
+			if (x * x + z * z <= (radius + margin) * (radius + margin)) {
+				self->keep[x + SV_CHUNK_VIEW_HALF] |= UINT32_C(1) << (z + SV_CHUNK_VIEW_HALF);
+			}
+		}
+	}
+
+	self->order.item   = CD_malloc(sizeof(SVChunkPosition) * (2 * radius + 1) * (2 * radius + 1));
+	self->order.length = 0;
+
+	for (int x = -radius; x <= radius; x++) {
+		for (int z = -radius; z <= radius; z++) {
+			if (x * x + z * z <= radius * radius) {
+				self->area[x + SV_CHUNK_VIEW_HALF] |= UINT32_C(1) << (z + SV_CHUNK_VIEW_HALF);
+
+				self->order.item[self->order.length].x = x;
+				self->order.item[self->order.length].z = z;
+				self->order.length++;
+			}
+		}
+	}
+
+	qsort(self->order.item, self->order.length, sizeof(SVChunkPosition), sv_CompareOffset);
+
+	return self;
+}
+
+void
+SV_DestroyChunkView (SVChunkView* self)
+{
+	assert(self);
+
+	CD_free(self->order.item);
+	CD_free(self);
+}
+
+bool
+SV_ChunkViewHas (SVChunkView* self, SVChunkPosition position)
+{
+	int row;
+	int bit;
+
+	assert(self);
+
+	if (!sv_ChunkViewLocate(self, position, &row, &bit)) {
+		return false;
+	}
+
+	return (self->loaded[row] >> bit) & 1;
+}
+
+void
+SV_ChunkViewSet (SVChunkView* self, SVChunkPosition position, bool loaded)
+{
+	int row;
+	int bit;
+
+	assert(self);
+
+	if (!sv_ChunkViewLocate(self, position, &row, &bit)) {
+		return;
+	}
+
+	if (loaded) {
+		self->loaded[row] |= UINT32_C(1) << bit;
+	}
+	else {
+		self->loaded[row]  &= ~(UINT32_C(1) << bit);
+		self->leaving[row] &= ~(UINT32_C(1) << bit);
+	}
+}
+
+void
+SV_ChunkViewMove (SVChunkView* self, SVChunkPosition center, time_t now, SVChunkViewCallback unload, SVChunkViewCallback load, CDPointer context)
+{
+	uint32_t        window[SV_CHUNK_VIEW_SIZE];
+	uint32_t        keep[SV_CHUNK_VIEW_SIZE];
+	uint32_t        gone[SV_CHUNK_VIEW_SIZE];
+	uint32_t        kept[SV_CHUNK_VIEW_SIZE];
+	uint32_t        leaving[SV_CHUNK_VIEW_SIZE];
+	uint32_t        retained[SV_CHUNK_VIEW_SIZE];
+	uint32_t        shifted[2][SV_CHUNK_VIEW_SIZE];
+	uint32_t        missing[SV_CHUNK_VIEW_SIZE];
+	uint32_t        pending = 0;
+	SVChunkPosition previous;
+
+	assert(self);
+
+	int64_t dx = (int64_t) center.x - self->center.x;
+	int64_t dz = (int64_t) center.z - self->center.z;
+
+	// the new window and margin as seen from the old center, what's loaded out of them goes
+	sv_ChunkViewShift(sv_ChunkViewWindow, window, -dx, -dz);
+	sv_ChunkViewShift(self->keep, keep, -dx, -dz);
+
+	for (int i = 0; i < SV_CHUNK_VIEW_SIZE; i++) {
+		gone[i] = self->loaded[i] & ~window[i];
+
+		if (self->grace == 0) {
+			gone[i] |= self->loaded[i] & ~keep[i];
+		}
+
+		kept[i]     = self->loaded[i] & ~gone[i];
+		leaving[i]  = self->leaving[i] & kept[i];
+		retained[i] = kept[i] & ~self->area[i];
+	}
+
+	previous = self->center;
+
+	sv_ChunkViewShift(kept, self->loaded, dx, dz);
+	// what was already leaving keeps its time, what's back in the radius was saved a reload
+	sv_ChunkViewShift(leaving, shifted[0], dx, dz);
+	sv_ChunkViewShift(retained, shifted[1], dx, dz);
+
+	self->center = center;
+
+	for (int i = 0; i < SV_CHUNK_VIEW_SIZE; i++) {
+		uint32_t entering;
+
+		self->stats.kept += __builtin_popcount(shifted[1][i] & self->area[i]);
+
+		self->leaving[i] = self->loaded[i] & ~self->keep[i];
+		entering         = self->leaving[i] & ~shifted[0][i];
+
+		while (entering) {
+			int bit = __builtin_ctz(entering);
+
+			entering &= entering - 1;
+
+			self->since[(center.x + i - SV_CHUNK_VIEW_HALF) & (SV_CHUNK_VIEW_SIZE - 1)]
+			           [(center.z + bit - SV_CHUNK_VIEW_HALF) & (SV_CHUNK_VIEW_SIZE - 1)] = now;
+		}
+	}
+
+	sv_ChunkViewUnload(self, gone, previous, unload, context);
+
+	for (int i = 0; i < SV_CHUNK_VIEW_SIZE; i++) {
+		missing[i] = self->area[i] & ~self->loaded[i];
+		pending   |= missing[i];
+	}
+
+	if (!pending || !load) {
+		return;
+	}
+
+	for (size_t i = 0; i < self->order.length; i++) {
+		SVChunkPosition offset = self->order.item[i];
+
+		if ((missing[offset.x + SV_CHUNK_VIEW_HALF] >> (offset.z + SV_CHUNK_VIEW_HALF)) & 1) {
+			SVChunkPosition position = {
+				.x = center.x + offset.x,
+				.z = center.z + offset.z
+			};
+
+			load(self, position, context);
+		}
+	}
+}
+
+void
+SV_ChunkViewExpire (SVChunkView* self, time_t now, SVChunkViewCallback unload, CDPointer context)
+{
+	uint32_t expired[SV_CHUNK_VIEW_SIZE];
+
+	assert(self);
+
+	for (int i = 0; i < SV_CHUNK_VIEW_SIZE; i++) {
+		uint32_t row = self->leaving[i];
+
+		expired[i] = 0;
+
+		while (row) {
+			int bit = __builtin_ctz(row);
+
+			row &= row - 1;
+
+			time_t since = self->since[(self->center.x + i - SV_CHUNK_VIEW_HALF) & (SV_CHUNK_VIEW_SIZE - 1)]
+			                          [(self->center.z + bit - SV_CHUNK_VIEW_HALF) & (SV_CHUNK_VIEW_SIZE - 1)];
+
+			if (now - since >= self->grace) {
+				expired[i] |= UINT32_C(1) << bit;
+			}
+		}
+
+		self->loaded[i]  &= ~expired[i];
+		self->leaving[i] &= ~expired[i];
+	}
+
+	sv_ChunkViewUnload(self, expired, self->center, unload, context);
+}
+
+void
+SV_ChunkViewClear (SVChunkView* self, SVChunkViewCallback unload, CDPointer context)
+{
+	uint32_t loaded[SV_CHUNK_VIEW_SIZE];
+
+	assert(self);
+
+	memcpy(loaded, self->loaded, sizeof(loaded));
+	memset(self->loaded, 0, sizeof(self->loaded));
+	memset(self->leaving, 0, sizeof(self->leaving));
+
+	sv_ChunkViewUnload(self, loaded, self->center, unload, context);
+}
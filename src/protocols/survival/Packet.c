@@ -26,6 +26,7 @@
 #include <craftd/Logger.h>
 
 #include <craftd/protocols/survival/Packet.h>
+#include <craftd/protocols/survival/PacketLength.h>
 
 SVPacket*
 SV_PacketFromBuffers (CDBuffers* buffers, bool isResponse)
@@ -43,7 +44,7 @@ SV_PacketFromBuffers (CDBuffers* buffers, bool isResponse)
 	self->data  = SV_GetPacketDataFromBuffer(self, buffers->input);
 
 	if (!self->data) {
-		ERR("unparsable packet 0x%.2X", self->type);
+		ERR("unparsable packet 0x%.2X (%s)", self->type, SVPacketName[self->type] ? SVPacketName[self->type] : "unknown");
 
 		SV_DestroyPacket(self);
 
@@ -66,2172 +67,632 @@ SV_DestroyPacket (SVPacket* self)
 	CD_free(self);
 }
 
-void
-SV_DestroyPacketData (SVPacket* self)
-{
-	if (!self->data) {
-		return;
-	}
-
-	switch (self->chain) {
-		case SVRequest: {
-			switch (self->type) {
-				case SVLogin: {
-					SVPacketLogin* packet = (SVPacketLogin*) self->data;
+/* Fixed fields are moved in spans of at most this many bytes */
+#define SV_PACKET_SPAN 64
 
-					SV_DestroyString(packet->request.username);
-				} break;
+/* Most strings a single Packet can have */
+#define SV_PACKET_STRINGS 8
 
-				case SVHandshake: {
-					SVPacketHandshake* packet = (SVPacketHandshake*) self->data;
-
-					SV_DestroyString(packet->request.username);
-				} break;
-
-				case SVChat: {
-					SVPacketChat* packet = (SVPacketChat*) self->data;
+static inline
+int64_t
+sv_FieldGet (const SVPacketField* field, const uint8_t* packet)
+{
+	const uint8_t* member = packet + field->offset;
 
-					SV_DestroyString(packet->request.message);
-				} break;
+	switch (field->size) {
+		case 1: {
+			// a byte counter is unsigned
+			return (field->flags & SV_FIELD_COUNT) ? *(uint8_t*) member : *(int8_t*) member;
+		}
 
-				case SVEntityMetadata: {
-					SVPacketEntityMetadata* packet = (SVPacketEntityMetadata*) self->data;
+		case 2: return *(int16_t*) member;
+		case 4: return *(int32_t*) member;
+		case 8: return *(int64_t*) member;
 
-					SV_DestroyMetadata(packet->request.metadata);
-				} break;
+		default: return 0;
+	}
+}
 
-				case SVUpdateSign: {
-					SVPacketUpdateSign* packet = (SVPacketUpdateSign*) self->data;
+static inline
+void
+sv_FieldSet (const SVPacketField* field, uint8_t* packet, int64_t value)
+{
+	uint8_t* member = packet + field->offset;
 
-					SV_DestroyString(packet->request.first);
-					SV_DestroyString(packet->request.second);
-					SV_DestroyString(packet->request.third);
-					SV_DestroyString(packet->request.fourth);
-				} break;
+	switch (field->size) {
+		case 1: *(int8_t*)  member = value; break;
+		case 2: *(int16_t*) member = value; break;
+		case 4: *(int32_t*) member = value; break;
+		case 8: *(int64_t*) member = value; break;
+	}
+}
 
-				case SVDisconnect: {
-					SVPacketDisconnect* packet = (SVPacketDisconnect*) self->data;
+static inline
+double
+sv_FieldGetReal (const SVPacketField* field, const uint8_t* packet)
+{
+	if (field->size == sizeof(double)) {
+		return *(double*) (packet + field->offset);
+	}
 
-					SV_DestroyString(packet->request.reason);
-				}
+	return *(float*) (packet + field->offset);
+}
 
-				default: break;
-			}
-		} break;
-		
-		case SVPing: {
-			switch(self->type) {
-				case SVDisconnect: {
-						SVPacketDisconnect* packet = (SVPacketDisconnect*) self->data;
-
-						SV_DestroyString(packet->ping.description);
-				} break;
-				default: break;
-			}
-		}break;
+static inline
+void
+sv_FieldSetReal (const SVPacketField* field, uint8_t* packet, double value)
+{
+	if (field->size == sizeof(double)) {
+		*(double*) (packet + field->offset) = value;
+	}
+	else {
+		*(float*) (packet + field->offset) = value;
+	}
+}
 
-		case SVResponse: {
-			switch (self->type) {
-				case SVLogin: {
-					SVPacketLogin* packet = (SVPacketLogin*) self->data;
+static inline
+void*
+sv_FieldPointer (const SVPacketField* field, const uint8_t* packet)
+{
+	return *(void**) (packet + field->offset);
+}
 
-					SV_DestroyString(packet->response.u1);
-				} break;
+static inline
+bool
+sv_FieldSkipped (const SVPacketField* field, int64_t condition)
+{
+	return (field->flags & SV_FIELD_GUARDED) && condition <= 0;
+}
 
-				case SVHandshake: {
-					SVPacketHandshake* packet = (SVPacketHandshake*) self->data;
+static
+void
+sv_DestroyFields (const SVPacketFormat* format, uint8_t* packet)
+{
+	for (size_t i = 0; i < format->length; i++) {
+		const SVPacketField* field = &format->field[i];
 
-					SV_DestroyString(packet->response.hash);
-				} break;
+		switch (field->type) {
+			case SVFieldString:
+			case SVFieldString16: {
+				SVString string = (SVString) sv_FieldPointer(field, packet);
 
-				case SVChat: {
-					SVPacketChat* packet = (SVPacketChat*) self->data;
+				if (string) {
+					SV_DestroyString(string);
+				}
+			} break;
 
-					SV_DestroyString(packet->request.message);
-				} break;
+			case SVFieldMetadata: {
+				SVMetadata* metadata = (SVMetadata*) sv_FieldPointer(field, packet);
 
-				case SVNamedEntitySpawn: {
-					SVPacketNamedEntitySpawn* packet = (SVPacketNamedEntitySpawn*) self->data;
+				if (metadata) {
+					SV_DestroyMetadata(metadata);
+				}
+			} break;
 
-					SV_DestroyString(packet->response.name);
-				} break;
+			case SVFieldArray:
+			case SVFieldItems: {
+				CD_free(sv_FieldPointer(field, packet));
+			} break;
 
-				case SVSpawnMob: {
-					SVPacketSpawnMob* packet = (SVPacketSpawnMob*) self->data;
+			default: break;
+		}
+	}
+}
 
-					SV_DestroyMetadata(packet->response.metadata);
-				} break;
+void
+SV_DestroyPacketData (SVPacket* self)
+{
+	if (!self->data) {
+		return;
+	}
 
-				case SVPainting: {
-					SVPacketPainting* packet = (SVPacketPainting*) self->data;
+	const SVPacketFormat* format = &SVPacketFormats[self->chain][self->type];
 
-					SV_DestroyString(packet->response.title);
-				} break;
+	sv_DestroyFields(format, (uint8_t*) self->data);
+}
 
-				case SVEntityMetadata: {
-					SVPacketEntityMetadata* packet = (SVPacketEntityMetadata*) self->data;
+static
+void
+sv_FixedFromSpan (const SVPacketField* field, uint8_t* packet, const uint8_t* input)
+{
+	switch (field->type) {
+		case SVFieldByte:
+		case SVFieldBoolean: {
+			sv_FieldSet(field, packet, (field->flags & SV_FIELD_COUNT) ? *(uint8_t*) input : *(int8_t*) input);
+		} break;
 
-					SV_DestroyMetadata(packet->response.metadata);
-				} break;
+		case SVFieldSize: {
+			sv_FieldSet(field, packet, *(uint8_t*) input + 1);
+		} break;
 
-				case SVMapChunk: {
-					SVPacketMapChunk* packet = (SVPacketMapChunk*) self->data;
+		case SVFieldShort: {
+			SVShort value;
 
-					CD_free(packet->response.item);
-				} break;
+			memcpy(&value, input, SVShortSize);
+			sv_FieldSet(field, packet, (SVShort) ntohs(value));
+		} break;
 
-				case SVMultiBlockChange: {
-					SVPacketMultiBlockChange* packet = (SVPacketMultiBlockChange*) self->data;
+		case SVFieldInteger: {
+			SVInteger value;
 
-					CD_free(packet->response.coordinate);
-					CD_free(packet->response.type);
-					CD_free(packet->response.metadata);
-				} break;
+			memcpy(&value, input, SVIntegerSize);
+			sv_FieldSet(field, packet, (SVInteger) ntohl(value));
+		} break;
 
-				case SVExplosion: {
-					SVPacketExplosion* packet = (SVPacketExplosion*) self->data;
+		case SVFieldLong: {
+			SVLong value;
 
-					CD_free(packet->response.item);
-				} break;
+			memcpy(&value, input, SVLongSize);
+			sv_FieldSet(field, packet, (SVLong) ntohll(value));
+		} break;
 
-				case SVOpenWindow: {
-					SVPacketOpenWindow* packet = (SVPacketOpenWindow*) self->data;
+		case SVFieldFloat: {
+			SVFloat value;
 
-					SV_DestroyString(packet->response.title);
-				} break;
+			memcpy(&value, input, SVFloatSize);
+			sv_FieldSetReal(field, packet, ntohf(value));
+		} break;
 
-				case SVWindowItems: {
-					SVPacketWindowItems* packet = (SVPacketWindowItems*) self->data;
+		case SVFieldDouble: {
+			SVDouble value;
 
-					CD_free(packet->response.item);
-				} break;
-				
-                case SVItemData: {
-                	SVPacketItemData* packet = (SVPacketItemData*) self->data;
+			memcpy(&value, input, SVDoubleSize);
+			sv_FieldSetReal(field, packet, ntohd(value));
+		} break;
 
-                	CD_free(packet->response.text); //This value is a byte array, not a string. Blame notch and his names!
-                }
+		default: break;
+	}
+}
 
-                case SVDisconnect: {
-                    SVPacketDisconnect* packet = (SVPacketDisconnect*) self->data;
+static
+void
+sv_ItemFromBuffer (SVItemStack* item, CDBuffer* input)
+{
+	item->id = SV_BufferRemoveShort(input);
 
-					SV_DestroyString(packet->response.reason);
-				} break;
+	if (item->id == -1) {
+		item->count  = 0;
+		item->damage = 0;
 
-				default: break;
-			}
-		} break;
+		return;
 	}
+
+	item->count  = SV_BufferRemoveByte(input);
+	item->damage = SV_BufferRemoveShort(input);
 }
 
 CDPointer
 SV_GetPacketDataFromBuffer (SVPacket* self, CDBuffer* input)
 {
-    assert(self);
-    assert(input);
-    DEBUG("Recieved packet type %x",self->type);
-    
-	switch (self->chain) {
-		case SVRequest: {
-			switch (self->type) {
-				case SVKeepAlive: {
-		        	SVPacketKeepAlive* packet = (SVPacketKeepAlive*) CD_malloc(sizeof(SVPacketKeepAlive));
-
-		        	packet->keepAliveID = SV_BufferRemoveInteger(input);
-
-		        	return (CDPointer) packet;
-		        }
-	
-				case SVLogin: {
-					SVPacketLogin* packet = (SVPacketLogin*) CD_malloc(sizeof(SVPacketLogin));
-
-		            SV_BufferRemoveFormat(input, "iUlibbbb",
-						&packet->request.version,
-						&packet->request.username,
-						&packet->request.u1,
-						&packet->request.u2,
-						&packet->request.u3,
-						&packet->request.u4,
-						&packet->request.u5,
-						&packet->request.u6
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVHandshake: {
-					SVPacketHandshake* packet = (SVPacketHandshake*) CD_malloc(sizeof(SVPacketHandshake));
+	assert(self);
+	assert(input);
 
-					packet->request.username = SV_BufferRemoveString16(input);
+	DEBUG("Recieved packet type %x", self->type);
 
-					return (CDPointer) packet;
-				}
-			
-				case SVChat: {
-					SVPacketChat* packet = (SVPacketChat*) CD_malloc(sizeof(SVPacketChat));
+	const SVPacketFormat* format = &SVPacketFormats[self->chain][self->type];
 
-					packet->request.message = SV_BufferRemoveString16(input);
+	if (format->size == 0) {
+		return (CDPointer) NULL;
+	}
 
-					return (CDPointer) packet;
-				}
-			
-				case SVUseEntity: {
-					SVPacketUseEntity* packet = (SVPacketUseEntity*) CD_malloc(sizeof(SVPacketUseEntity));
+	uint8_t* packet    = CD_alloc(format->size);
+	int64_t  count     = 0;
+	int64_t  condition = 1;
 
-					SV_BufferRemoveFormat(input, "iib",
-						&packet->request.user,
-						&packet->request.target,
-						&packet->request.leftClick
-					);
+	for (size_t i = 0; i < format->length; i++) {
+		const SVPacketField* field = &format->field[i];
 
-					return (CDPointer) packet;
-				}
-			
-				case SVRespawn: {
-					SVPacketRespawn* packet = (SVPacketRespawn*) CD_malloc(sizeof(SVPacketRespawn));
-
-					SV_BufferRemoveFormat(input, "bbbsl",
-						&packet->request.world,
-						&packet->request.u1,
-						&packet->request.mode,
-						&packet->request.worldHeight,
-						&packet->request.mapSeed
-					);
-					return (CDPointer) packet;
-		        }
-	
-				case SVOnGround: {
-					SVPacketOnGround* packet = (SVPacketOnGround*) CD_malloc(sizeof(SVPacketOnGround));
+		if (sv_FieldSkipped(field, condition)) {
+			continue;
+		}
+
+		if (SV_PacketFieldSize(field) > 0) {
+			uint8_t span[SV_PACKET_SPAN];
+			size_t  size = 0;
+			size_t  end  = i;
 
-					packet->request.onGround = SV_BufferRemoveBoolean(input);
+			// consecutive fixed fields are read in a single remove, a run ends
+			// after a field the ones after it depend on
+			while (end < format->length && SV_PacketFieldSize(&format->field[end]) > 0) {
+				const SVPacketField* current = &format->field[end];
 
-					return (CDPointer) packet;
+				if (size + SV_PacketFieldSize(current) > SV_PACKET_SPAN) {
+					break;
 				}
-			
-				case SVPlayerPosition: {
-					SVPacketPlayerPosition* packet = (SVPacketPlayerPosition*) CD_malloc(sizeof(SVPacketPlayerPosition));
-
-					SV_BufferRemoveFormat(input, "ddddb",
-						&packet->request.position.x,
-						&packet->request.position.y,
-						&packet->request.stance,
-						&packet->request.position.z,
-						&packet->request.is.onGround
-					);
-
-					return (CDPointer) packet;
+
+				if (!sv_FieldSkipped(current, condition)) {
+					size += SV_PacketFieldSize(current);
 				}
-			
-				case SVPlayerLook: {
-					SVPacketPlayerLook* packet = (SVPacketPlayerLook*) CD_malloc(sizeof(SVPacketPlayerLook));
 
-					SV_BufferRemoveFormat(input, "ffb",
-						&packet->request.yaw,
-						&packet->request.pitch,
-						&packet->request.is.onGround
-					);
+				end++;
 
-					return (CDPointer) packet;
-				}
-			
-				case SVPlayerMoveLook: {
-					SVPacketPlayerMoveLook* packet = (SVPacketPlayerMoveLook*) CD_malloc(sizeof(SVPacketPlayerMoveLook));
-
-					SV_BufferRemoveFormat(input, "ddddffb",
-						&packet->request.position.x,
-						&packet->request.stance,
-						&packet->request.position.y,
-						&packet->request.position.z,
-						&packet->request.yaw,
-						&packet->request.pitch,
-						&packet->request.is.onGround
-					);
-
-					return (CDPointer) packet;
+				if (current->flags & (SV_FIELD_COUNT | SV_FIELD_CONDITION)) {
+					break;
 				}
-			
-				case SVPlayerDigging: {
-					SVPacketPlayerDigging* packet = (SVPacketPlayerDigging*) CD_malloc(sizeof(SVPacketPlayerDigging));
-
-					packet->request.status = SV_BufferRemoveByte(input);
+			}
 
-					SV_BufferRemoveFormat(input, "ibi",
-						&packet->request.position.x,
-						&packet->request.position.y,
-						&packet->request.position.z
-					);
+			if (evbuffer_remove(input->raw, span, size) != (int) size) {
+				goto error;
+			}
 
-					packet->request.face = SV_BufferRemoveByte(input);
+			for (size_t offset = 0, j = i; j < end; j++) {
+				const SVPacketField* current = &format->field[j];
 
-					return (CDPointer) packet;
+				if (sv_FieldSkipped(current, condition)) {
+					continue;
 				}
-			
-				case SVPlayerBlockPlacement: {
-					SVPacketPlayerBlockPlacement* packet = (SVPacketPlayerBlockPlacement*) CD_malloc(sizeof(SVPacketPlayerBlockPlacement));
-
-					memset(&packet->request.item, 0, sizeof(SVItemStack));
 
-					SV_BufferRemoveFormat(input, "ibibs",
-						&packet->request.position.x,
-						&packet->request.position.y,
-						&packet->request.position.z,
+				sv_FixedFromSpan(current, packet, span + offset);
 
-						&packet->request.direction,
-						&packet->request.item.id
-					);
-
-					if (packet->request.item.id != -1) {
-						SV_BufferRemoveFormat(input, "bs",
-							&packet->request.item.count,
-							&packet->request.item.damage
-						);
-					}
+				if (current->flags & SV_FIELD_COUNT) {
+					count = sv_FieldGet(current, packet);
+				}
 
-					return (CDPointer) packet;
+				if (current->flags & SV_FIELD_CONDITION) {
+					condition = sv_FieldGet(current, packet);
 				}
-			
-				case SVHoldChange: {
-					SVPacketHoldChange* packet = (SVPacketHoldChange*) CD_malloc(sizeof(SVPacketHoldChange));
 
-					packet->request.slot = SV_BufferRemoveShort(input);
+				offset += SV_PacketFieldSize(current);
+			}
 
-					return (CDPointer) packet;
-				}
-			
-				case SVAnimation: {
-					SVPacketAnimation* packet = (SVPacketAnimation*) CD_malloc(sizeof(SVPacketAnimation));
+			i = end - 1;
 
-					SV_BufferRemoveFormat(input, "ib",
-						&packet->request.entity.id,
-						&packet->request.type
-					);
+			continue;
+		}
 
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityAction: {
-					SVPacketEntityAction* packet = (SVPacketEntityAction*) CD_malloc(sizeof(SVPacketEntityAction));
-
-					SV_BufferRemoveFormat(input, "ib",
-						&packet->request.entity.id,
-						&packet->request.type
-					);
-					return (CDPointer) packet;
-				}
-			
-				case SVStanceUpdate: { //This is most likely a packet that isn't used, but it might be in the future
-					SVPacketStanceUpdate* packet = (SVPacketStanceUpdate*) CD_malloc(sizeof(SVPacketStanceUpdate));
-
-					SV_BufferRemoveFormat(input, "ffffBB",
-						&packet->request.u1,
-						&packet->request.u2,
-						&packet->request.u3,
-						&packet->request.u4,
-						&packet->request.u5,
-						&packet->request.u6
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityMetadata: {
-					SVPacketEntityMetadata* packet = (SVPacketEntityMetadata*) CD_malloc(sizeof(SVPacketEntityMetadata));
+		void** member = (void**) (packet + field->offset);
 
-					SV_BufferRemoveFormat(input, "iM",
-						&packet->request.entity.id,
-						&packet->request.metadata
-					);
+		switch (field->type) {
+			case SVFieldString: {
+				*member = SV_BufferRemoveString(input);
+			} break;
 
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityEffect: {
-					SVPacketEntityEffect* packet = (SVPacketEntityEffect*) CD_malloc(sizeof(SVPacketEntityEffect));
-
-					SV_BufferRemoveFormat(input, "ibbs",
-						&packet->request.entity.id,
-						&packet->request.effect,
-						&packet->request.amplifier,
-						&packet->request.duration
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVRemoveEntityEffect: {
-					SVPacketRemoveEntityEffect* packet = (SVPacketRemoveEntityEffect*) CD_malloc(sizeof(SVPacketRemoveEntityEffect));
+			case SVFieldString16: {
+				*member = SV_BufferRemoveString16(input);
+			} break;
+
+			case SVFieldMetadata: {
+				*member = SV_BufferRemoveMetadata(input);
+			} break;
 
-					SV_BufferRemoveFormat(input, "ib",
-						&packet->request.entity.id,
-						&packet->request.effect
-					);
+			case SVFieldItem: {
+				sv_ItemFromBuffer((SVItemStack*) (packet + field->offset), input);
+			} break;
 
-					return (CDPointer) packet;
+			case SVFieldArray: {
+				if (count < 0) {
+					goto error;
 				}
-			
-				case SVCloseWindow: {
-					SVPacketCloseWindow* packet = (SVPacketCloseWindow*) CD_malloc(sizeof(SVPacketCloseWindow));
 
-					packet->request.id = SV_BufferRemoveByte(input);
+				*member = (void*) CD_BufferRemove(input, count * field->size);
+			} break;
 
-					return (CDPointer) packet;
+			case SVFieldItems: {
+				if (count < 0) {
+					goto error;
 				}
-			
-				case SVWindowClick: {
-					SVPacketWindowClick* packet = (SVPacketWindowClick*) CD_malloc(sizeof(SVPacketWindowClick));
-
-					memset(&packet->request.item, 0, sizeof(SVItemStack));
-
-					SV_BufferRemoveFormat(input, "bsBsBs",
-						&packet->request.id,
-						&packet->request.slot,
-						&packet->request.rightClick,
-						&packet->request.action,
-						&packet->request.shiftPressed,
-						&packet->request.item.id
-					);
-
-					if (packet->request.item.id != -1) {
-						SV_BufferRemoveFormat(input, "bs",
-							&packet->request.item.count,
-							&packet->request.item.damage
-						);
-					}
-
-					return (CDPointer) packet;
-				}
-			
-				case SVTransaction: {
-					SVPacketTransaction* packet = (SVPacketTransaction*) CD_malloc(sizeof(SVPacketTransaction));
 
-					SV_BufferRemoveFormat(input, "bsB",
-						&packet->request.id,
-						&packet->request.action,
-						&packet->request.accepted
-					);
+				SVItemStack* items = CD_alloc(count * sizeof(SVItemStack));
 
-					return (CDPointer) packet;
-				}
-			
-				case SVCreativeInventoryAction: {
-					SVPacketCreativeInventoryAction* packet = (SVPacketCreativeInventoryAction*) CD_malloc(sizeof(SVPacketCreativeInventoryAction));
-
-					SV_BufferRemoveFormat(input, "ssss",
-						&packet->request.slot,
-						&packet->request.itemId,
-						&packet->request.quantity,
-						&packet->request.damage
-					);
-
-					return (CDPointer) packet;
+				*member = items;
+
+				for (int64_t j = 0; j < count; j++) {
+					sv_ItemFromBuffer(&items[j], input);
 				}
+			} break;
 
-				case SVUpdateSign: {
-					SVPacketUpdateSign* packet = (SVPacketUpdateSign*) CD_malloc(sizeof(SVPacketUpdateSign));
+			default: break;
+		}
+	}
 
-					SV_BufferRemoveFormat(input, "isiUUUU",
-						&packet->request.position.x,
-						&packet->request.position.y,
-						&packet->request.position.z,
+	return (CDPointer) packet;
 
-						&packet->request.first,
-						&packet->request.second,
-						&packet->request.third,
-						&packet->request.fourth
-					);
+	error: {
+		sv_DestroyFields(format, packet);
+		CD_free(packet);
 
-					return (CDPointer) packet;
-				}
+		return (CDPointer) NULL;
+	}
+}
 
-				case SVIncrementStatistic: {
-					SVPacketIncrementStatistic* packet = (SVPacketIncrementStatistic*) CD_malloc(sizeof(SVPacketIncrementStatistic));
+static
+void
+sv_FixedToSpan (const SVPacketField* field, const uint8_t* packet, uint8_t* output)
+{
+	switch (field->type) {
+		case SVFieldByte:
+		case SVFieldBoolean: {
+			*output = sv_FieldGet(field, packet);
+		} break;
 
-					SV_BufferRemoveFormat(input, "ib",
-						&packet->request.id,
-						&packet->request.amount
-					);
+		case SVFieldSize: {
+			*output = sv_FieldGet(field, packet) - 1;
+		} break;
 
-					return (CDPointer) packet;
-				}
-			
-				case SVListPing: {
-					return (CDPointer) CD_malloc(sizeof(SVPacketListPing));
-				}
-			
-				case SVDisconnect: {
-					SVPacketDisconnect* packet = (SVPacketDisconnect*) CD_malloc(sizeof(SVPacketDisconnect));
+		case SVFieldShort: {
+			SVShort value = htons(sv_FieldGet(field, packet));
 
-					packet->request.reason = SV_BufferRemoveString16(input);
+			memcpy(output, &value, SVShortSize);
+		} break;
 
-					return (CDPointer) packet;
-				}
+		case SVFieldInteger: {
+			SVInteger value = htonl(sv_FieldGet(field, packet));
 
-				default: {
-					return (CDPointer) NULL;
-				}
-			}
+			memcpy(output, &value, SVIntegerSize);
 		} break;
-		
-		case SVPing: {
-			switch(self->type) {
-				case SVDisconnect: {
-					SVPacketDisconnect* packet = (SVPacketDisconnect*) CD_malloc(sizeof(SVPacketDisconnect));
 
-					packet->request.reason = SV_BufferRemoveString16(input);
+		case SVFieldLong: {
+			SVLong value = htonll(sv_FieldGet(field, packet));
 
-					return (CDPointer) packet;
-				}
+			memcpy(output, &value, SVLongSize);
+		} break;
 
-				default: {
-					return (CDPointer) NULL;
-				}
-			}
+		case SVFieldFloat: {
+			SVFloat value = htonf(sv_FieldGetReal(field, packet));
+
+			memcpy(output, &value, SVFloatSize);
 		} break;
-		
-		case SVResponse: {
-			switch (self->type) {
-				case SVKeepAlive: {
-		        	SVPacketKeepAlive* packet = (SVPacketKeepAlive*) CD_malloc(sizeof(SVPacketKeepAlive));
 
-		        	packet->keepAliveID = SV_BufferRemoveInteger(input);
+		case SVFieldDouble: {
+			SVDouble value = htond(sv_FieldGetReal(field, packet));
 
-		        	return (CDPointer) packet;
-		        }
-	
-				case SVLogin: {
-					SVPacketLogin* packet = (SVPacketLogin*) CD_malloc(sizeof(SVPacketLogin));
-
-		            SV_BufferRemoveFormat(input, "iUlibbbb",
-						&packet->response.id,
-						&packet->response.u1,
-						&packet->response.mapSeed,
-						&packet->response.serverMode,
-						&packet->response.dimension,
-						&packet->response.u2,
-						&packet->response.worldHeight,
-						&packet->response.maxPlayers
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVHandshake: {
-					SVPacketHandshake* packet = (SVPacketHandshake*) CD_malloc(sizeof(SVPacketHandshake));
+			memcpy(output, &value, SVDoubleSize);
+		} break;
 
-					packet->response.hash = SV_BufferRemoveString16(input);
+		default: break;
+	}
+}
 
-					return (CDPointer) packet;
-				}
-			
-				case SVChat: {
-					SVPacketChat* packet = (SVPacketChat*) CD_malloc(sizeof(SVPacketChat));
+static inline
+size_t
+sv_ItemSize (const SVItemStack* item)
+{
+	return (item->id == -1) ? SVShortSize : SVShortSize + SVByteSize + SVShortSize;
+}
 
-					packet->response.message = SV_BufferRemoveString16(input);
+static inline
+uint8_t*
+sv_ItemToSpan (const SVItemStack* item, uint8_t* output)
+{
+	SVShort value = htons(item->id);
 
-					return (CDPointer) packet;
-				}
-			
-				case SVTimeUpdate: {
-					SVPacketTimeUpdate* packet = (SVPacketTimeUpdate*) CD_malloc(sizeof(SVPacketTimeUpdate));
+	memcpy(output, &value, SVShortSize);
+	output += SVShortSize;
 
-					packet->response.time = SV_BufferRemoveLong(input);
+	if (item->id == -1) {
+		return output;
+	}
 
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityEquipment: {
-					SVPacketEntityEquipment* packet = (SVPacketEntityEquipment*) CD_malloc(sizeof(SVPacketEntityEquipment));
-
-					SV_BufferRemoveFormat(input, "isss",
-						&packet->response.entity,
-						&packet->response.slot,
-						&packet->response.item,
-						&packet->response.damage
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVSpawnPosition: {
-					SVPacketSpawnPosition* packet = (SVPacketSpawnPosition*) CD_malloc(sizeof(SVPacketSpawnPosition));
-
-					SVInteger y;
-					SV_BufferRemoveFormat(input, "iii",
-						&packet->response.position.x,
-						&y,
-						&packet->response.position.z
-					);
-					packet->response.position.y = y;
-
-					return (CDPointer) packet;
-				}
-			
-				case SVUpdateHealth: {
-					SVPacketUpdateHealth* packet = (SVPacketUpdateHealth*) CD_malloc(sizeof(SVPacketUpdateHealth));
+	*output++ = item->count;
 
-					SV_BufferRemoveFormat(input, "ssf",
-						&packet->response.health,
-						&packet->response.food,
-						&packet->response.foodSaturation
-					);
+	value = htons(item->damage);
 
-					return (CDPointer) packet;
-				}
-			
-				case SVRespawn: {
-					SVPacketRespawn* packet = (SVPacketRespawn*) CD_malloc(sizeof(SVPacketRespawn));
-
-					SV_BufferRemoveFormat(input, "bbbsl",
-						&packet->response.world,
-						&packet->response.u1,
-						&packet->response.mode,
-						&packet->response.worldHeight,
-						&packet->response.mapSeed
-					);
-					return (CDPointer) packet;
-		        }
-	
-				case SVPlayerMoveLook: {
-					SVPacketPlayerMoveLook* packet = (SVPacketPlayerMoveLook*) CD_malloc(sizeof(SVPacketPlayerMoveLook));
-
-					SV_BufferRemoveFormat(input, "ddddffb",
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.stance,
-						&packet->response.position.z,
-						&packet->response.yaw,
-						&packet->response.pitch,
-						&packet->response.is.onGround
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVUseBed: {
-					SVPacketUseBed* packet = (SVPacketUseBed*) CD_malloc(sizeof(SVPacketUseBed));
-
-					SV_BufferRemoveFormat(input, "ibibi",
-						&packet->response.entity.id,
-						&packet->response.inBed,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVAnimation: {
-					SVPacketAnimation* packet = (SVPacketAnimation*) CD_malloc(sizeof(SVPacketAnimation));
+	memcpy(output, &value, SVShortSize);
+	output += SVShortSize;
 
-					SV_BufferRemoveFormat(input, "ib",
-						&packet->response.entity.id,
-						&packet->response.type
-					);
+	return output;
+}
 
-					return (CDPointer) packet;
-				}
-			
-				case SVNamedEntitySpawn: {
-					SVPacketNamedEntitySpawn* packet = (SVPacketNamedEntitySpawn*) CD_malloc(sizeof(SVPacketNamedEntitySpawn));
-
-					SV_BufferRemoveFormat(input, "iUiiibbs",
-						&packet->response.entity.id,
-						&packet->response.name,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
-						&packet->response.rotation,
-						&packet->response.pitch,
-						&packet->response.itemId
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVPickupSpawn: {
-					SVPacketPickupSpawn* packet = (SVPacketPickupSpawn*) CD_malloc(sizeof(SVPacketPickupSpawn));
-
-					SV_BufferRemoveFormat(input, "isbsiiibbb",
-						&packet->response.entity.id,
-						&packet->response.item.id,
-						&packet->response.item.count,
-						&packet->response.item.damage,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
-						&packet->response.rotation,
-						&packet->response.pitch,
-						&packet->response.roll
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVCollectItem: {
-					SVPacketCollectItem* packet = (SVPacketCollectItem*) CD_malloc(sizeof(SVPacketCollectItem));
+CDBuffer*
+SV_PacketToBuffer (SVPacket* self)
+{
+	assert(self);
 
-					SV_BufferRemoveFormat(input, "ii",
-						&packet->response.collected,
-						&packet->response.collector
-					);
+	const SVPacketFormat* format = &SVPacketFormats[self->chain][self->type];
 
-					return (CDPointer) packet;
-				}
-			
-				case SVSpawnObject: {
-					SVPacketSpawnObject* packet = (SVPacketSpawnObject*) CD_malloc(sizeof(SVPacketSpawnObject));
-
-					SV_BufferRemoveFormat(input, "ibiiii",
-						&packet->response.entity.id,
-						&packet->response.type,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
-						&packet->response.flag
-					);
-					
-					if (packet->response.flag > 0) {
-						SV_BufferRemoveFormat(input, "sss",
-							&packet->response.u1,
-							&packet->response.u2,
-							&packet->response.u3
-						);
-					}
-
-					return (CDPointer) packet;
-				}
-			
-				case SVSpawnMob: {
-					SVPacketSpawnMob* packet = (SVPacketSpawnMob*) CD_malloc(sizeof(SVPacketSpawnMob));
-
-					SV_BufferRemoveFormat(input, "ibiiibbM",
-						&packet->response.id,
-						&packet->response.type,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
-						&packet->response.yaw,
-						&packet->response.pitch,
-						&packet->response.metadata
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVPainting: {
-					SVPacketPainting* packet = (SVPacketPainting*) CD_malloc(sizeof(SVPacketPainting));
-				
-					SVInteger y;
-					SV_BufferRemoveFormat(input, "iUiiii",
-						&packet->response.entity.id,
-						&packet->response.title,
-						&packet->response.position.x,
-						&y,
-						&packet->response.position.z,
-						&packet->response.direction
-					);
-					packet->response.position.y = y;
-				
-					return (CDPointer) packet;
-				}
-			
-				case SVExperienceOrb: {
-					SVPacketExperienceOrb* packet = (SVPacketExperienceOrb*) CD_malloc(sizeof(SVPacketExperienceOrb));
-
-					SVInteger y;
-					SV_BufferRemoveFormat(input, "iiiis",
-						&packet->response.entity.id,
-						&packet->response.position.x,
-						&y,
-						&packet->response.position.z,
-						&packet->response.count
-					);
-					packet->response.position.y = y;
-
-					return (CDPointer) packet;
-				}
-			
-				case SVStanceUpdate: { //This is most likely a packet that isn't used, but it might be in the future
-					SVPacketStanceUpdate* packet = (SVPacketStanceUpdate*) CD_malloc(sizeof(SVPacketStanceUpdate));
-
-					SV_BufferRemoveFormat(input, "ffffBB",
-						&packet->response.u1,
-						&packet->response.u2,
-						&packet->response.u3,
-						&packet->response.u4,
-						&packet->response.u5,
-						&packet->response.u6
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityVelocity: {
-					SVPacketEntityVelocity* packet = (SVPacketEntityVelocity*) CD_malloc(sizeof(SVPacketEntityVelocity));
-
-					SV_BufferRemoveFormat(input, "isss",
-						&packet->response.entity.id,
-						&packet->response.velocity.x,
-						&packet->response.velocity.y,
-						&packet->response.velocity.z
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityDestroy: {
-					SVPacketEntityDestroy* packet = (SVPacketEntityDestroy*) CD_malloc(sizeof(SVPacketEntityDestroy));
+	if (format->size == 0) {
+		return NULL;
+	}
 
-					packet->response.entity.id = SV_BufferRemoveInteger(input);
+	const uint8_t* packet    = (const uint8_t*) self->data;
+	SVString       strings[SV_PACKET_STRINGS];
+	bool           owned[SV_PACKET_STRINGS];
+	size_t         length    = 0;
+	size_t         size      = SVByteSize;
+	int64_t        count     = 0;
+	int64_t        condition = 1;
 
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityCreate: {
-					SVPacketEntityCreate* packet = (SVPacketEntityCreate*) CD_malloc(sizeof(SVPacketEntityCreate));
-				
-					packet->response.entity.id = SV_BufferRemoveInteger(input);
-				
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityRelativeMove: {
-					SVPacketEntityRelativeMove* packet = (SVPacketEntityRelativeMove*) CD_malloc(sizeof(SVPacketEntityRelativeMove));
-
-					SV_BufferRemoveFormat(input, "ibbb",
-						&packet->response.entity.id,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityLook: {
-					SVPacketEntityLook* packet = (SVPacketEntityLook*) CD_malloc(sizeof(SVPacketEntityLook));
+	// the exact size is known before writing, so the whole Packet goes in one span
+	for (size_t i = 0; i < format->length; i++) {
+		const SVPacketField* field = &format->field[i];
 
-					SV_BufferRemoveFormat(input, "ibb",
-						&packet->response.entity.id,
-						&packet->response.yaw,
-						&packet->response.pitch
-					);
+		if (sv_FieldSkipped(field, condition)) {
+			continue;
+		}
 
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityLookMove: {
-					SVPacketEntityLookMove* packet = (SVPacketEntityLookMove*) CD_malloc(sizeof(SVPacketEntityLookMove));
-
-					SV_BufferRemoveFormat(input, "ibbbbb",
-						&packet->response.entity.id,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
-						&packet->response.yaw,
-						&packet->response.pitch
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityTeleport: {
-					SVPacketEntityTeleport* packet = (SVPacketEntityTeleport*) CD_malloc(sizeof(SVPacketEntityTeleport));
-
-					SV_BufferRemoveFormat(input, "iiiibb",
-						&packet->response.entity.id,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
-						&packet->response.rotation,
-						&packet->response.pitch
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityStatus: {
-					SVPacketEntityStatus* packet = (SVPacketEntityStatus*) CD_malloc(sizeof(SVPacketEntityStatus));
+		if (field->flags & SV_FIELD_COUNT) {
+			count = sv_FieldGet(field, packet);
+		}
 
-					SV_BufferRemoveFormat(input, "ib",
-						&packet->response.entity.id,
-						&packet->response.status
-					);
+		if (field->flags & SV_FIELD_CONDITION) {
+			condition = sv_FieldGet(field, packet);
+		}
 
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityAttach: {
-					SVPacketEntityAttach* packet = (SVPacketEntityAttach*) CD_malloc(sizeof(SVPacketEntityAttach));
+		switch (field->type) {
+			case SVFieldString:
+			case SVFieldString16: {
+				SVString string = (SVString) sv_FieldPointer(field, packet);
 
-					SV_BufferRemoveFormat(input, "ii",
-						&packet->response.entity.id,
-						&packet->response.vehicle.id
-					);
+				assert(length < SV_PACKET_STRINGS);
 
-					return (CDPointer) packet;
-				}
-			
-				case SVEntityMetadata: {
-					SVPacketEntityMetadata* packet = (SVPacketEntityMetadata*) CD_malloc(sizeof(SVPacketEntityMetadata));
+				// strings already known to be valid are sent as they are
+				owned[length]   = string && !string->clean;
+				strings[length] = owned[length] ? SV_StringSanitize(string) : string;
+				string          = strings[length++];
 
-					SV_BufferRemoveFormat(input, "iM",
-						&packet->response.entity.id,
-						&packet->response.metadata
-					);
+				size += SVShortSize;
 
-					return (CDPointer) packet;
+				if (string && field->type == SVFieldString) {
+					size += CD_StringSize(string);
 				}
-			
-				case SVEntityEffect: {
-					SVPacketEntityEffect* packet = (SVPacketEntityEffect*) CD_malloc(sizeof(SVPacketEntityEffect));
-
-					SV_BufferRemoveFormat(input, "ibbs",
-						&packet->response.entity.id,
-						&packet->response.effect,
-						&packet->response.amplifier,
-						&packet->response.duration
-					);
-
-					return (CDPointer) packet;
+				else if (string) {
+					size += SV_UTF8ToUCS2Length((const uint8_t*) CD_StringContent(string), CD_StringSize(string)) * 2;
 				}
-			
-				case SVRemoveEntityEffect: {
-					SVPacketRemoveEntityEffect* packet = (SVPacketRemoveEntityEffect*) CD_malloc(sizeof(SVPacketRemoveEntityEffect));
-
-					SV_BufferRemoveFormat(input, "ib",
-						&packet->response.entity.id,
-						&packet->response.effect
-					);
+			} break;
 
-					return (CDPointer) packet;
-				}
-			
-				case SVExperience: {
-					SVPacketExperience* packet = (SVPacketExperience*) CD_malloc(sizeof(SVPacketExperience));
+			case SVFieldMetadata: {
+				size += SV_MetadataSize((SVMetadata*) sv_FieldPointer(field, packet));
+			} break;
 
-					SV_BufferRemoveFormat(input, "bbs",
-						&packet->response.currentExperience,
-						&packet->response.level,
-						&packet->response.totalExperience
-					);
+			case SVFieldItem: {
+				size += sv_ItemSize((const SVItemStack*) (packet + field->offset));
+			} break;
 
-					return (CDPointer) packet;
-				}
-			
-				case SVPreChunk: {
-					SVPacketPreChunk* packet = (SVPacketPreChunk*) CD_malloc(sizeof(SVPacketPreChunk));
+			case SVFieldArray: {
+				size += count * field->size;
+			} break;
 
-					SV_BufferRemoveFormat(input, "iib",
-						&packet->response.position.x,
-						&packet->response.position.z,
-						&packet->response.mode
-					);
+			case SVFieldItems: {
+				const SVItemStack* items = (const SVItemStack*) sv_FieldPointer(field, packet);
 
-					return (CDPointer) packet;
+				for (int64_t j = 0; j < count; j++) {
+					size += sv_ItemSize(&items[j]);
 				}
+			} break;
 
-				case SVMapChunk: {
-					SVPacketMapChunk* packet = (SVPacketMapChunk*) CD_malloc(sizeof(SVPacketMapChunk));
-
-					SVShort y;
-					SV_BufferRemoveFormat(input, "isibbbi",
-						&packet->response.position.x,
-						&y,
-						&packet->response.position.z,
-						&packet->response.size.x,
-						&packet->response.size.y,
-						&packet->response.size.z,
-						&packet->response.length
-					);
-					packet->response.size.x++;
-					packet->response.size.y++;
-					packet->response.size.z++;
-					packet->response.position.y = y;
-
-					packet->response.item = (SVByte*)CD_BufferRemove(input, packet->response.length * SVByteSize);
-
-					return (CDPointer) packet;
-				}
+			default: {
+				size += SV_PacketFieldSize(field);
+			}
+		}
+	}
 
-				case SVMultiBlockChange: {
-					SVPacketMultiBlockChange* packet = (SVPacketMultiBlockChange*) CD_malloc(sizeof(SVPacketMultiBlockChange));
+	CDBuffer*             data = CD_CreateBuffer();
+	struct evbuffer_iovec span;
 
-					SV_BufferRemoveFormat(input, "iis",
-						&packet->response.position.x,
-						&packet->response.position.z,
-						&packet->response.length
-					);
+	if (evbuffer_reserve_space(data->raw, size, &span, 1) < 1) {
+		CD_DestroyBuffer(data);
 
-					packet->response.coordinate = (SVShort*)CD_BufferRemove(input, packet->response.length * SVShortSize);
-					packet->response.type = (SVByte*)CD_BufferRemove(input, packet->response.length * SVByteSize);
-					packet->response.metadata = (SVByte*)CD_BufferRemove(input, packet->response.length * SVByteSize);
+		data = NULL;
+		goto done;
+	}
 
-					return (CDPointer) packet;
-				}
+	uint8_t* output = (uint8_t*) span.iov_base;
+	size_t   next   = 0;
 
-				case SVBlockChange: {
-					SVPacketBlockChange* packet = (SVPacketBlockChange*) CD_malloc(sizeof(SVPacketBlockChange));
+	*output++ = self->type;
 
-					SV_BufferRemoveFormat(input, "ibibb",
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
-						&packet->response.type,
-						&packet->response.metadata
-					);
+	count     = 0;
+	condition = 1;
 
-					return (CDPointer) packet;
-				}
-			
-				case SVPlayNoteBlock: {
-					SVPacketPlayNoteBlock* packet = (SVPacketPlayNoteBlock*) CD_malloc(sizeof(SVPacketPlayNoteBlock));
-				
-					SVShort y;
-					SV_BufferRemoveFormat(input, "isibb",
-						&packet->response.position.x,
-						&y,
-						&packet->response.position.z,
-						&packet->response.data1,
-						&packet->response.data2
-					);
-					packet->response.position.y = y;
-
-					return (CDPointer) packet;
-				}
-			
-				case SVExplosion: {
-					SVPacketExplosion* packet = (SVPacketExplosion*) CD_malloc(sizeof(SVPacketExplosion));
+	for (size_t i = 0; i < format->length; i++) {
+		const SVPacketField* field = &format->field[i];
 
-					SV_BufferRemoveFormat(input, "dddfi",
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
-						&packet->response.radius,
-						&packet->response.length
-					);
+		if (sv_FieldSkipped(field, condition)) {
+			continue;
+		}
 
-					packet->response.item = (SVRelativePosition*)CD_BufferRemove(input, packet->response.length * sizeof(SVRelativePosition));
+		if (field->flags & SV_FIELD_COUNT) {
+			count = sv_FieldGet(field, packet);
+		}
 
-					return (CDPointer) packet;
-				}
-			
-				case SVSoundEffect: {
-					SVPacketSoundEffect* packet = (SVPacketSoundEffect*) CD_malloc(sizeof(SVPacketSoundEffect));
-
-					SV_BufferRemoveFormat(input, "iibii",
-						&packet->response.effect,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
-						&packet->response.data
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVState: {
-					SVPacketState* packet = (SVPacketState*) CD_malloc(sizeof(SVPacketState));
+		if (field->flags & SV_FIELD_CONDITION) {
+			condition = sv_FieldGet(field, packet);
+		}
 
-					SV_BufferRemoveFormat(input, "bb",
-						&packet->response.reason,
-						&packet->response.gameMode
-					);
+		switch (field->type) {
+			case SVFieldString:
+			case SVFieldString16: {
+				SVString string = strings[next++];
+				uint8_t* prefix = output;
+				SVShort  value  = 0;
 
-					return (CDPointer) packet;
-				}
-			
-				case SVThunderbolt: {
-					SVPacketThunderbolt* packet = (SVPacketThunderbolt*) CD_malloc(sizeof(SVPacketThunderbolt));
-
-					SV_BufferRemoveFormat(input, "iBiii",
-						&packet->response.entity,
-						&packet->response.u1,
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVOpenWindow: {
-					SVPacketOpenWindow* packet = (SVPacketOpenWindow*) CD_malloc(sizeof(SVPacketOpenWindow));
-
-					SV_BufferRemoveFormat(input, "bbUb",
-						&packet->response.id,
-						&packet->response.type,
-						&packet->response.title,
-						&packet->response.slots
-					);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVCloseWindow: {
-					SVPacketCloseWindow* packet = (SVPacketCloseWindow*) CD_malloc(sizeof(SVPacketCloseWindow));
+				output += SVShortSize;
 
-					packet->response.id = SV_BufferRemoveByte(input);
+				if (string && field->type == SVFieldString) {
+					value = CD_StringSize(string);
 
-					return (CDPointer) packet;
+					memcpy(output, CD_StringContent(string), value);
+					output += value;
 				}
-			
-				case SVSetSlot: {
-					SVPacketSetSlot* packet = (SVPacketSetSlot*) CD_malloc(sizeof(SVPacketSetSlot));
-
-					SV_BufferRemoveFormat(input, "bss",
-						&packet->response.windowId,
-						&packet->response.item.slot,
-						&packet->response.item.id
-					);
-					if (packet->response.item.id != -1) {
-						packet->response.item.count = SV_BufferRemoveByte(input);
-						packet->response.item.damage = SV_BufferRemoveShort(input);
-					}
-
-					return (CDPointer) packet;
+				else if (string) {
+					value = SV_UTF8ToUCS2((const uint8_t*) CD_StringContent(string), CD_StringSize(string), output);
+
+					output += value * 2;
 				}
 
-				case SVWindowItems: {
-					SVPacketWindowItems* packet = (SVPacketWindowItems*) CD_malloc(sizeof(SVPacketWindowItems));
+				value = htons(value);
 
-					SV_BufferRemoveFormat(input, "bs",
-						&packet->response.id,
-						&packet->response.length
-					);
+				memcpy(prefix, &value, SVShortSize);
+			} break;
 
-					packet->response.item = (SVItemStack*) CD_malloc(sizeof(SVItemStack) * packet->response.length);
+			case SVFieldMetadata: {
+				output += SV_MetadataToByteArray((SVMetadata*) sv_FieldPointer(field, packet), output);
+			} break;
 
-					int i;
-					for (i=0; i<packet->response.length; i++) {
-						SVShort itemId = SV_BufferRemoveShort(input);
-						if (itemId == -1) continue;
-						packet->response.item[i].id = itemId;
-						packet->response.item[i].count = SV_BufferRemoveByte(input);
-						packet->response.item[i].damage = SV_BufferRemoveShort(input);
-					}
+			case SVFieldItem: {
+				output = sv_ItemToSpan((const SVItemStack*) (packet + field->offset), output);
+			} break;
 
-					return (CDPointer) packet;
+			case SVFieldArray: {
+				if (count > 0) {
+					memcpy(output, sv_FieldPointer(field, packet), count * field->size);
+					output += count * field->size;
 				}
-			
-				case SVUpdateProgressBar: {
-					SVPacketUpdateProgressBar* packet = (SVPacketUpdateProgressBar*) CD_malloc(sizeof(SVPacketUpdateProgressBar));
-				
-					SV_BufferRemoveFormat(input, "bss",
-						&packet->response.id,
-						&packet->response.bar,
-						&packet->response.value
-					);
-				}
-			
-				case SVTransaction: {
-					SVPacketTransaction* packet = (SVPacketTransaction*) CD_malloc(sizeof(SVPacketTransaction));
+			} break;
 
-					SV_BufferRemoveFormat(input, "bsB",
-						&packet->response.id,
-						&packet->response.action,
-						&packet->response.accepted
-					);
+			case SVFieldItems: {
+				const SVItemStack* items = (const SVItemStack*) sv_FieldPointer(field, packet);
 
-					return (CDPointer) packet;
-				}
-			
-				case SVCreativeInventoryAction: {
-					SVPacketCreativeInventoryAction* packet = (SVPacketCreativeInventoryAction*) CD_malloc(sizeof(SVPacketCreativeInventoryAction));
-
-					SV_BufferRemoveFormat(input, "ssss",
-						&packet->response.slot,
-						&packet->response.itemId,
-						&packet->response.quantity,
-						&packet->response.damage
-					);
-
-					return (CDPointer) packet;
+				for (int64_t j = 0; j < count; j++) {
+					output = sv_ItemToSpan(&items[j], output);
 				}
+			} break;
 
-				case SVUpdateSign: {
-					SVPacketUpdateSign* packet = (SVPacketUpdateSign*) CD_malloc(sizeof(SVPacketUpdateSign));
+			default: {
+				sv_FixedToSpan(field, packet, output);
 
-					SV_BufferRemoveFormat(input, "isiUUUU",
-						&packet->response.position.x,
-						&packet->response.position.y,
-						&packet->response.position.z,
+				output += SV_PacketFieldSize(field);
+			}
+		}
+	}
 
-						&packet->response.first,
-						&packet->response.second,
-						&packet->response.third,
-						&packet->response.fourth
-					);
+	assert((size_t) (output - (uint8_t*) span.iov_base) == size);
 
-					return (CDPointer) packet;
-				}
-			
-				case SVItemData: {
-					SVPacketItemData* packet = (SVPacketItemData*) CD_malloc(sizeof(SVPacketItemData));
-
-					SV_BufferRemoveFormat(input, "ssb",
-						&packet->response.itemType,
-						&packet->response.itemId,
-						&packet->response.textLength
-					);
-				
-					packet->response.text = (SVByte*)CD_BufferRemove(input, (uint8_t)packet->response.textLength * SVByteSize);
-
-					return (CDPointer) packet;
-				}
-			
-				case SVPlayerListItem: {
-					SVPacketPlayerListItem* packet = (SVPacketPlayerListItem*) CD_malloc(sizeof(SVPacketPlayerListItem));
+	span.iov_len = size;
 
-					SV_BufferRemoveFormat(input, "UBs",
-						&packet->response.playerName,
-						&packet->response.online,
-						&packet->response.ping
-					);
+	evbuffer_commit_space(data->raw, &span, 1);
 
-					return (CDPointer) packet;
-				}
-			
-				case SVDisconnect: {
-					SVPacketDisconnect* packet = (SVPacketDisconnect*) CD_malloc(sizeof(SVPacketDisconnect));
+	done: {
+		for (size_t i = 0; i < length; i++) {
+			if (owned[i]) {
+				SV_DestroyString(strings[i]);
+			}
+		}
 
-					packet->response.reason = SV_BufferRemoveString16(input);
+		return data;
+	}
+}
 
-					return (CDPointer) packet;
-				}
+void
+SV_PacketBatchAdd (CDPacketBatch* batch, SVPacket* self)
+{
+	assert(batch);
+	assert(self);
 
-				default: {
-					return (CDPointer) NULL;
-				}
-			}
-		} break;
+	CDBuffer* data = SV_PacketToBuffer(self);
+
+	if (!data) {
+		return;
 	}
-	
-	return (CDPointer) NULL;
-}
 
-CDBuffer*
-SV_PacketToBuffer (SVPacket* self)
-	{
-	CDBuffer* data = CD_CreateBuffer();
+	CD_PacketBatchAdd(batch, data);
+	CD_DestroyBuffer(data);
+}
 
+CDSharedBuffer*
+SV_PacketToSharedBuffer (SVPacket* self)
+{
 	assert(self);
 
-	SV_BufferAddByte(data, self->type);
-
-	switch (self->chain) {
-		case SVRequest: {
-			switch (self->type) {
-				case SVKeepAlive: {
-					SVPacketKeepAlive* packet = (SVPacketKeepAlive*) self->data;
-
-					SV_BufferAddInteger(data, packet->keepAliveID);
-				} break;
-
-				case SVLogin: {
-					SVPacketLogin* packet = (SVPacketLogin*) self->data;
-
-				    SV_BufferAddFormat(data, "iUlibbbb",
-						packet->request.version,
-						packet->request.username,
-						packet->request.u1,
-						packet->request.u2,
-						packet->request.u3,
-						packet->request.u4,
-						packet->request.u5,
-						packet->request.u6
-					);
-				} break;
-
-				case SVHandshake: {
-					SVPacketHandshake* packet = (SVPacketHandshake*) self->data;
-
-					SV_BufferAddString16(data, packet->request.username);
-				} break;
-
-				case SVChat: {
-					SVPacketChat* packet = (SVPacketChat*) self->data;
-
-					SV_BufferAddString16(data, packet->request.message);
-				} break;
-
-				case SVUseEntity: {
-					SVPacketUseEntity* packet = (SVPacketUseEntity*) self->data;
-
-					SV_BufferAddFormat(data, "iib",
-						packet->request.user,
-						packet->request.target,
-						packet->request.leftClick
-					);
-				} break;
-
-				case SVRespawn: {
-					SVPacketRespawn* packet = (SVPacketRespawn*) self->data;
-
-					SV_BufferAddFormat(data, "bbbsl",
-						packet->request.world,
-						packet->request.u1,
-						packet->request.mode,
-						packet->request.worldHeight,
-						packet->request.mapSeed
-					);
-				} break;
-
-				case SVOnGround: {
-					SVPacketOnGround* packet = (SVPacketOnGround*) self->data;
-
-					SV_BufferAddBoolean(data, packet->request.onGround);
-				} break;
-
-				case SVPlayerPosition: {
-					SVPacketPlayerPosition* packet = (SVPacketPlayerPosition*) self->data;
-
-					SV_BufferAddFormat(data, "ddddb",
-						packet->request.position.x,
-						packet->request.position.y,
-						packet->request.stance,
-						packet->request.position.z,
-						packet->request.is.onGround
-					);
-				} break;
-
-				case SVPlayerLook: {
-					SVPacketPlayerLook* packet = (SVPacketPlayerLook*) self->data;
-
-					SV_BufferAddFormat(data, "ffb",
-						packet->request.yaw,
-						packet->request.pitch,
-						packet->request.is.onGround
-					);
-				} break;
-
-				case SVPlayerMoveLook: {
-					SVPacketPlayerMoveLook* packet = (SVPacketPlayerMoveLook*) self->data;
-
-					SV_BufferAddFormat(data, "ddddffb",
-						packet->request.position.x,
-						packet->request.stance,
-						packet->request.position.y,
-						packet->request.position.z,
-						packet->request.yaw,
-						packet->request.pitch,
-						packet->request.is.onGround
-					);
-				} break;
-
-				case SVPlayerDigging: {
-					SVPacketPlayerDigging* packet = (SVPacketPlayerDigging*) self->data;
-
-					SV_BufferAddByte(data, packet->request.status);
-
-					SV_BufferAddFormat(data, "ibi",
-						packet->request.position.x,
-						packet->request.position.y,
-						packet->request.position.z
-					);
-
-					SV_BufferAddByte(data, packet->request.face);
-				} break;
-
-				case SVPlayerBlockPlacement: {
-					SVPacketPlayerBlockPlacement* packet = (SVPacketPlayerBlockPlacement*) self->data;
-
-					SV_BufferAddFormat(data, "ibibs",
-						packet->request.position.x,
-						packet->request.position.y,
-						packet->request.position.z,
-
-						packet->request.direction,
-						packet->request.item.id
-					);
-
-					if (packet->request.item.id != -1) {
-						SV_BufferAddFormat(data, "bs",
-							packet->request.item.count,
-							packet->request.item.damage
-						);
-					}
-				} break;
-
-				case SVHoldChange: {
-					SVPacketHoldChange* packet = (SVPacketHoldChange*) self->data;
-
-					SV_BufferAddShort(data, packet->request.slot);
-				} break;
-
-				case SVAnimation: {
-					SVPacketAnimation* packet = (SVPacketAnimation*) self->data;
-
-					SV_BufferAddFormat(data, "ib",
-						packet->request.entity.id,
-						packet->request.type
-					);
-				} break;
-
-				case SVEntityAction: {
-					SVPacketEntityAction* packet = (SVPacketEntityAction*) self->data;
-
-					SV_BufferAddFormat(data, "ib",
-						packet->request.entity.id,
-						packet->request.type
-					);
-				} break;
-
-				case SVStanceUpdate: { //This is most likely a packet that isn't used, but it might be in the future
-					SVPacketStanceUpdate* packet = (SVPacketStanceUpdate*) self->data;
-
-					SV_BufferAddFormat(data, "ffffBB",
-						packet->request.u1,
-						packet->request.u2,
-						packet->request.u3,
-						packet->request.u4,
-						packet->request.u5,
-						packet->request.u6
-					);
-				} break;
-
-				case SVEntityMetadata: {
-					SVPacketEntityMetadata* packet = (SVPacketEntityMetadata*) self->data;
-
-					SV_BufferAddFormat(data, "iM",
-						packet->request.entity.id,
-						packet->request.metadata
-					);
-				} break;
-
-				case SVEntityEffect: {
-					SVPacketEntityEffect* packet = (SVPacketEntityEffect*) self->data;
-
-					SV_BufferAddFormat(data, "ibbs",
-						packet->request.entity.id,
-						packet->request.effect,
-						packet->request.amplifier,
-						packet->request.duration
-					);
-				} break;
-
-				case SVRemoveEntityEffect: {
-					SVPacketRemoveEntityEffect* packet = (SVPacketRemoveEntityEffect*) self->data;
-
-					SV_BufferAddFormat(data, "ib",
-						packet->request.entity.id,
-						packet->request.effect
-					);
-				} break;
-
-				case SVCloseWindow: {
-					SVPacketCloseWindow* packet = (SVPacketCloseWindow*) self->data;
-
-					SV_BufferAddByte(data, packet->request.id);
-				} break;
-
-				case SVWindowClick: {
-					SVPacketWindowClick* packet = (SVPacketWindowClick*) self->data;
-
-					SV_BufferAddFormat(data, "bsBsBs",
-						packet->request.id,
-						packet->request.slot,
-						packet->request.rightClick,
-						packet->request.action,
-						packet->request.shiftPressed,
-						packet->request.item.id
-					);
-
-					if (packet->request.item.id != -1) {
-						SV_BufferAddFormat(data, "bs",
-							packet->request.item.count,
-							packet->request.item.damage
-						);
-					}
-				} break;
-
-				case SVTransaction: {
-					SVPacketTransaction* packet = (SVPacketTransaction*) self->data;
-
-					SV_BufferAddFormat(data, "bsB",
-						packet->request.id,
-						packet->request.action,
-						packet->request.accepted
-					);
-				} break;
-
-				case SVCreativeInventoryAction: {
-					SVPacketCreativeInventoryAction* packet = (SVPacketCreativeInventoryAction*) self->data;
-
-					SV_BufferAddFormat(data, "ssss",
-						packet->request.slot,
-						packet->request.itemId,
-						packet->request.quantity,
-						packet->request.damage
-					);
-				} break;
-
-				case SVUpdateSign: {
-					SVPacketUpdateSign* packet = (SVPacketUpdateSign*) self->data;
-
-					SV_BufferAddFormat(data, "isiUUUU",
-						packet->request.position.x,
-						packet->request.position.y,
-						packet->request.position.z,
-
-						packet->request.first,
-						packet->request.second,
-						packet->request.third,
-						packet->request.fourth
-					);
-				} break;
-
-				case SVListPing: {
-					
-				} break;
-
-				case SVDisconnect: {
-					SVPacketDisconnect* packet = (SVPacketDisconnect*) self->data;
-
-					SV_BufferAddString16(data, packet->request.reason);
-				} break;
-				
-				default: {
-					return NULL;
-				};
-			}
-		} break;
-		
-		case SVPing: {
-			switch(self->type) {
-				case SVDisconnect:
-				{
-					SVPacketDisconnect* packet = (SVPacketDisconnect*) self->data;
-
-					SV_BufferAddString16(data, packet->ping.description);
-				} break;
-				
-				default: {
-					return NULL;
-				};
-			}
-		} break;
-
-		case SVResponse: {
-			switch (self->type) {
-				case SVKeepAlive: {
-					SVPacketKeepAlive* packet = (SVPacketKeepAlive*) self->data;
-
-					SV_BufferAddInteger(data, packet->keepAliveID);
-				} break;
-
-				case SVLogin: {
-					SVPacketLogin* packet = (SVPacketLogin*) self->data;
-
-					SV_BufferAddFormat(data, "iUlibbbb",
-						packet->response.id,
-						packet->response.u1,
-						packet->response.mapSeed,
-						packet->response.serverMode,
-						packet->response.dimension,
-						packet->response.u2,
-						packet->response.worldHeight,
-						packet->response.maxPlayers
-					);
-				} break;
-
-				case SVHandshake: {
-					SVPacketHandshake* packet = (SVPacketHandshake*) self->data;
-
-					SV_BufferAddString16(data, packet->response.hash);
-				} break;
-
-				case SVChat: {
-					SVPacketChat* packet = (SVPacketChat*) self->data;
-
-					SV_BufferAddString16(data, packet->response.message);
-				} break;
-
-				case SVTimeUpdate: {
-					SVPacketTimeUpdate* packet = (SVPacketTimeUpdate*) self->data;
-
-					SV_BufferAddLong(data, packet->response.time);
-				} break;
-
-				case SVEntityEquipment: {
-					SVPacketEntityEquipment* packet = (SVPacketEntityEquipment*) self->data;
-
-					SV_BufferAddFormat(data, "isss",
-						packet->response.entity.id,
-						packet->response.slot,
-						packet->response.item,
-						packet->response.damage
-					);
-				} break;
-
-				case SVSpawnPosition: {
-					SVPacketSpawnPosition* packet = (SVPacketSpawnPosition*) self->data;
-
-					SV_BufferAddFormat(data, "iii",
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z
-					);
-				} break;
-
-				case SVUpdateHealth: {
-					SVPacketUpdateHealth* packet = (SVPacketUpdateHealth*) self->data;
-
-					SV_BufferAddFormat(data, "ssf",
-						packet->response.health,
-						packet->response.food,
-						packet->response.foodSaturation
-					);
-				} break;
-				
-				case SVRespawn: {
-					SVPacketRespawn* packet = (SVPacketRespawn*) self->data;
-					
-					SV_BufferAddFormat(data, "bbbsl",
-						packet->response.world,
-						packet->response.u1,
-						packet->response.mode,
-						packet->response.worldHeight,
-						packet->response.mapSeed
-					);
-				} break;
-
-				case SVPlayerMoveLook: {
-					SVPacketPlayerMoveLook* packet = (SVPacketPlayerMoveLook*) self->data;
-
-					SV_BufferAddFormat(data, "ddddffB",
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.stance,
-						packet->response.position.z,
-						packet->response.yaw,
-						packet->response.pitch,
-						packet->response.is.onGround
-					);
-				} break;
-
-				case SVUseBed: {
-					SVPacketUseBed* packet = (SVPacketUseBed*) self->data;
-
-					SV_BufferAddFormat(data, "ibibi",
-						packet->response.entity.id,
-						packet->response.inBed,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z
-					);
-				} break;
-
-				case SVAnimation: {
-					SVPacketAnimation* packet = (SVPacketAnimation*) self->data;
-
-					SV_BufferAddFormat(data, "ib",
-						packet->response.entity.id,
-						packet->response.type
-					);
-				} break;
-
-				case SVNamedEntitySpawn: {
-					SVPacketNamedEntitySpawn* packet = (SVPacketNamedEntitySpawn*) self->data;
-
-					SV_BufferAddFormat(data, "iUiiibbs",
-						packet->response.entity.id,
-						packet->response.name,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-						packet->response.rotation,
-						packet->response.pitch,
-						packet->response.itemId
-					);
-				} break;
-
-				case SVPickupSpawn: {
-					SVPacketPickupSpawn* packet = (SVPacketPickupSpawn*) self->data;
-
-					SV_BufferAddFormat(data, "isbsiiibbb",
-						packet->response.entity.id,
-						packet->response.item.id,
-						packet->response.item.count,
-						packet->response.item.damage,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-						packet->response.rotation,
-						packet->response.pitch,
-						packet->response.roll
-					);
-				} break;
-
-				case SVCollectItem: {
-					SVPacketCollectItem* packet = (SVPacketCollectItem*) self->data;
-
-					SV_BufferAddFormat(data, "ii",
-						packet->response.collected,
-						packet->response.collector
-					);
-				} break;
-
-				case SVSpawnObject: {
-					SVPacketSpawnObject* packet = (SVPacketSpawnObject*) self->data;
-
-					SV_BufferAddFormat(data, "ibiiii",
-						packet->response.entity.id,
-						packet->response.type,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-						packet->response.flag
-					);
-					if(packet->response.flag > 0) { //These fields are sent under this condition
-						SV_BufferAddShort(data, packet->response.u1);
-						SV_BufferAddShort(data, packet->response.u2);
-						SV_BufferAddShort(data, packet->response.u3);
-					}
-				} break;
-
-				case SVSpawnMob: {
-					SVPacketSpawnMob* packet = (SVPacketSpawnMob*) self->data;
-
-					SV_BufferAddFormat(data, "ibiiibbM",
-						packet->response.id,
-						packet->response.type,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-						packet->response.yaw,
-						packet->response.pitch,
-						packet->response.metadata
-					);
-				} break;
-
-				case SVPainting: {
-					SVPacketPainting* packet = (SVPacketPainting*) self->data;
-
-					SV_BufferAddFormat(data, "iUiiii",
-						packet->response.entity.id,
-						packet->response.title,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-						packet->response.direction
-					);
-				} break;
-
-				case SVExperienceOrb: {
-					SVPacketExperienceOrb* packet = (SVPacketExperienceOrb*) self->data;
-
-					SV_BufferAddFormat(data, "iiiis",
-						packet->response.entity.id,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-						packet->response.count
-					);
-				} break;
-
-				case SVStanceUpdate: {
-					SVPacketStanceUpdate* packet = (SVPacketStanceUpdate*) self->data;
-
-					SV_BufferAddFormat(data, "ffffBB",
-						packet->response.u1,
-						packet->response.u2,
-						packet->response.u3,
-						packet->response.u4,
-						packet->response.u5,
-						packet->response.u6
-					);
-				} break;
-
-				case SVEntityVelocity: {
-					SVPacketEntityVelocity* packet = (SVPacketEntityVelocity*) self->data;
-
-					SV_BufferAddFormat(data, "isss",
-						packet->response.entity.id,
-						packet->response.velocity.x,
-						packet->response.velocity.y,
-						packet->response.velocity.z
-					);
-				} break;
-
-				case SVEntityDestroy: {
-					SVPacketEntityDestroy* packet = (SVPacketEntityDestroy*) self->data;
-
-					SV_BufferAddInteger(data, packet->response.entity.id);
-				} break;
-
-				case SVEntityCreate: {
-					SVPacketEntityCreate* packet = (SVPacketEntityCreate*) self->data;
-
-					SV_BufferAddInteger(data, packet->response.entity.id);
-				} break;
-
-				case SVEntityRelativeMove: {
-					SVPacketEntityRelativeMove* packet = (SVPacketEntityRelativeMove*) self->data;
-
-					SV_BufferAddFormat(data, "ibbb",
-						packet->response.entity.id,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z
-					);
-				} break;
-
-				case SVEntityLook: {
-					SVPacketEntityLook* packet = (SVPacketEntityLook*) self->data;
-
-					SV_BufferAddFormat(data, "ibb",
-						packet->response.entity.id,
-						packet->response.yaw,
-						packet->response.pitch
-					);
-				} break;
-
-				case SVEntityLookMove: {
-					SVPacketEntityLookMove* packet = (SVPacketEntityLookMove*) self->data;
-
-					SV_BufferAddFormat(data, "ibbbbb",
-						packet->response.entity.id,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-						packet->response.yaw,
-						packet->response.pitch
-					);
-				} break;
-
-				case SVEntityTeleport: {
-					SVPacketEntityTeleport* packet = (SVPacketEntityTeleport*) self->data;
-
-					SV_BufferAddFormat(data, "iiiibb",
-						packet->response.entity.id,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-						packet->response.rotation,
-						packet->response.pitch
-					);
-				} break;
-
-				case SVEntityStatus: {
-					SVPacketEntityStatus* packet = (SVPacketEntityStatus*) self->data;
-
-					SV_BufferAddFormat(data, "ib",
-						packet->response.entity.id,
-						packet->response.status
-					);
-				} break;
-
-				case SVEntityAttach: {
-					SVPacketEntityAttach* packet = (SVPacketEntityAttach*) self->data;
-
-					SV_BufferAddFormat(data, "ii",
-						packet->response.entity.id,
-						packet->response.vehicle.id
-					);
-				} break;
-
-				case SVEntityMetadata: {
-					SVPacketEntityMetadata* packet = (SVPacketEntityMetadata*) self->data;
-
-					SV_BufferAddFormat(data, "iM",
-						packet->response.entity.id,
-						packet->response.metadata
-					);
-				} break;
-
-				case SVEntityEffect: {
-					SVPacketEntityEffect* packet = (SVPacketEntityEffect*) self->data;
-
-					SV_BufferAddFormat(data, "ibbs",
-						packet->response.entity.id,
-						packet->response.effect,
-						packet->response.amplifier,
-						packet->response.duration
-					);
-				} break;
-
-				case SVRemoveEntityEffect: {
-					SVPacketRemoveEntityEffect* packet = (SVPacketRemoveEntityEffect*) self->data;
-
-					SV_BufferAddFormat(data, "ib",
-						packet->response.entity.id,
-						packet->response.effect
-					);
-				} break;
-
-				case SVExperience: {
-					SVPacketExperience* packet = (SVPacketExperience*) self->data;
-
-					SV_BufferAddFormat(data, "bbs",
-						packet->response.currentExperience,
-						packet->response.level,
-						packet->response.totalExperience
-					);
-				} break;
-
-				case SVPreChunk: {
-					SVPacketPreChunk* packet = (SVPacketPreChunk*) self->data;
-
-					SV_BufferAddFormat(data, "iiB",
-						packet->response.position.x,
-						packet->response.position.z,
-						packet->response.mode
-					);
-				} break;
-
-				case SVMapChunk: {
-					SVPacketMapChunk* packet = (SVPacketMapChunk*) self->data;
-
-					SV_BufferAddFormat(data, "isibbb",
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-
-						packet->response.size.x - 1,
-						packet->response.size.y - 1,
-						packet->response.size.z - 1
-					);
-
-					SV_BufferAddInteger(data, packet->response.length);
-
-					CD_BufferAdd(data, (CDPointer) packet->response.item, packet->response.length * SVByteSize);
-				} break;
-
-				case SVMultiBlockChange: {
-					SVPacketMultiBlockChange* packet = (SVPacketMultiBlockChange*) self->data;
-
-					SV_BufferAddFormat(data, "ii",
-						packet->response.position.x,
-						packet->response.position.z
-					);
-
-					SV_BufferAddShort(data, packet->response.length);
-
-					CD_BufferAdd(data, (CDPointer) packet->response.coordinate, packet->response.length * SVShortSize);
-					CD_BufferAdd(data, (CDPointer) packet->response.type,       packet->response.length * SVByteSize);
-					CD_BufferAdd(data, (CDPointer) packet->response.metadata,   packet->response.length * SVByteSize);
-				} break;
-
-				case SVBlockChange: {
-					SVPacketBlockChange* packet = (SVPacketBlockChange*) self->data;
-
-					SV_BufferAddFormat(data, "ibibb",
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-
-						packet->response.type,
-						packet->response.metadata
-					);
-				} break;
-
-				case SVPlayNoteBlock: { //TODO: Rename to SVBlockAction
-					SVPacketPlayNoteBlock* packet = (SVPacketPlayNoteBlock*) self->data;
-
-					SV_BufferAddFormat(data, "isibb",
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-
-						packet->response.data1,
-						packet->response.data2
-					);
-				} break;
-
-				case SVExplosion: {
-					SVPacketExplosion* packet = (SVPacketExplosion*) self->data;
-
-					SV_BufferAddFormat(data, "dddf",
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-
-						packet->response.radius
-					);
-
-					SV_BufferAddInteger(data, packet->response.length);
-
-					CD_BufferAdd(data, (CDPointer) packet->response.item, packet->response.length * 3 * SVByteSize);
-				} break;
-
-				case SVSoundEffect: {
-					SVPacketSoundEffect* packet = (SVPacketSoundEffect*) self->data;
-
-					SV_BufferAddFormat(data, "iibii",
-						packet->response.effect,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-						packet->response.data
-					);
-				} break;
-
-				case SVState: {
-					SVPacketState* packet = (SVPacketState*) self->data;
-
-					SV_BufferAddFormat(data, "bb",
-						packet->response.reason,
-						packet->response.gameMode
-					);
-				} break;
-
-				case SVThunderbolt: {
-					SVPacketThunderbolt* packet = (SVPacketThunderbolt*) self->data;
-
-					SV_BufferAddFormat(data, "iBiii",
-						packet->response.entity.id,
-						packet->response.u1,
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z
-					);
-				}
+	CDBuffer* data = SV_PacketToBuffer(self);
 
-				case SVOpenWindow: {
-					SVPacketOpenWindow* packet = (SVPacketOpenWindow*) self->data;
-
-					SV_BufferAddFormat(data, "bbSb",
-						packet->response.id,
-						packet->response.type,
-						packet->response.title,
-						packet->response.slots
-					);
-				} break;
-
-				case SVCloseWindow: {
-					SVPacketCloseWindow* packet = (SVPacketCloseWindow*) self->data;
-
-					SV_BufferAddByte(data, packet->response.id);
-				} break;
-
-				case SVSetSlot: {
-					SVPacketSetSlot* packet = (SVPacketSetSlot*) self->data;
-
-					SV_BufferAddFormat(data, "bss",
-						packet->response.windowId,
-						packet->response.item.slot,
-						packet->response.item.id
-					);
-
-					if (packet->response.item.id != -1) {
-						SV_BufferAddFormat(data, "bs",
-							packet->response.item.count,
-							packet->response.item.damage
-						);
-					}
-				} break;
-
-				case SVWindowItems: {
-					SVPacketWindowItems* packet = (SVPacketWindowItems*) self->data;
-
-					SV_BufferAddByte(data, packet->response.id);
-					SV_BufferAddShort(data, packet->response.length);
-
-					for (size_t i = 0; i < packet->response.length; i++) {
-						if (packet->response.item[i].id == -1) {
-							SV_BufferAddShort(data, -1);
-						}
-						else {
-							SV_BufferAddFormat(data, "sbs",
-								packet->response.item[i].id,
-								packet->response.item[i].count,
-								packet->response.item[i].damage
-							);
-						}
-					}
-				} break;
-
-				case SVUpdateProgressBar: {
-					SVPacketUpdateProgressBar* packet = (SVPacketUpdateProgressBar*) self->data;
-
-					SV_BufferAddFormat(data, "bss",
-						packet->response.id,
-						packet->response.bar,
-						packet->response.value
-					);
-				} break;
-
-				case SVTransaction: {
-					SVPacketTransaction* packet = (SVPacketTransaction*) self->data;
-
-					SV_BufferAddFormat(data, "bsB",
-						packet->response.id,
-						packet->response.action,
-						packet->response.accepted
-					);
-				} break;
-
-				case SVCreativeInventoryAction: {
-					SVPacketCreativeInventoryAction* packet = (SVPacketCreativeInventoryAction*) self->data;
-
-					SV_BufferAddFormat(data, "ssss",
-						packet->response.slot,
-						packet->response.itemId,
-						packet->response.quantity,
-						packet->response.damage
-					);
-				} break;
-
-				case SVUpdateSign: {
-					SVPacketUpdateSign* packet = (SVPacketUpdateSign*) self->data;
-
-					SV_BufferAddFormat(data, "isiUUUU",
-						packet->response.position.x,
-						packet->response.position.y,
-						packet->response.position.z,
-
-						packet->response.first,
-						packet->response.second,
-						packet->response.third,
-						packet->response.fourth
-					);
-				} break;
-
-				case SVItemData: {
-					SVPacketItemData* packet = (SVPacketItemData*) self->data;
-					
-					SV_BufferAddFormat(data, "isiUUUU",
-						packet->response.itemType,
-						packet->response.itemId,
-						packet->response.textLength
-					);
-					
-					CD_BufferAdd(data, (CDPointer) packet->response.text, packet->response.textLength * SVByteSize);
-				} break;
-				
-				case SVIncrementStatistic: {
-					SVPacketIncrementStatistic* packet = (SVPacketIncrementStatistic*) self->data;
-
-					SV_BufferAddFormat(data, "ib",
-						packet->response.id,
-						packet->response.amount
-					);
-				} break;
-
-				case SVPlayerListItem: {
-					SVPacketPlayerListItem* packet = (SVPacketPlayerListItem*) self->data;
-
-					SV_BufferAddFormat(data, "Ubs",
-						packet->response.playerName,
-						packet->response.online,
-						packet->response.ping
-					);
-				} break;
-
-				case SVDisconnect: {
-					SVPacketDisconnect* packet = (SVPacketDisconnect*) self->data;
-
-					SV_BufferAddString16(data, packet->response.reason);
-				} break;
-
-				default: {
-					return NULL;
-				};
-			}
-		} break;
+	if (!data) {
+		return NULL;
 	}
 
-	return data;
+	CDSharedBuffer* result = CD_CreateSharedBuffer(data);
+
+	CD_DestroyBuffer(data);
+
+	return result;
 }
@@ -26,271 +26,309 @@
 #include <craftd/protocols/survival/PacketLength.h>
 #include <craftd/protocols/survival/Packet.h>
 
-#define CHECK (length < (SVPacketLength[type] + variable))
+/* Max number of chunks a single field can span, fields are at most 8 bytes */
+#define SV_PEEK_VECTORS 8
 
+#define PEEK(at, into)                                           \
+	if (!sv_PacketPeek(input, (at), &(into), sizeof(into))) {   \
+		parser->needed = (at) + sizeof(into);                    \
+		goto again;                                              \
+	}
+
+static
 bool
-SV_PacketParsable (CDBuffers* buffers)
+sv_PacketPeek (struct evbuffer* input, size_t offset, void* data, size_t size)
 {
-	size_t       length   = evbuffer_get_length(buffers->input->raw);
-	SVPacketType type     = 0;
-	size_t       variable = 0;
-	size_t       offset   = SVByteSize;
-				 errno    = 0;
-
-	if (length < 1) {
-		goto error;
+	struct evbuffer_ptr   position;
+	struct evbuffer_iovec vector[SV_PEEK_VECTORS];
+	int                   vectors;
+	char*                 output = (char*) data;
+
+	if (evbuffer_get_length(input) < offset + size) {
+		return false;
+	}
+
+	if (evbuffer_ptr_set(input, &position, offset, EVBUFFER_PTR_SET) < 0) {
+		return false;
 	}
 
-	evbuffer_copyout(buffers->input->raw, &type, 1);
+	vectors = evbuffer_peek(input, size, &position, vector, SV_PEEK_VECTORS);
+
+	for (int i = 0; i < vectors && i < SV_PEEK_VECTORS && size > 0; i++) {
+		size_t chunk = (vector[i].iov_len < size) ? vector[i].iov_len : size;
 
-	if (length < SVPacketLength[type]) {
-		goto error;
+		memcpy(output, vector[i].iov_base, chunk);
+
+		output += chunk;
+		size   -= chunk;
 	}
 
-	unsigned char* data = evbuffer_pullup(buffers->input->raw, -1);
+	return size == 0;
+}
 
-	switch (type) {
-		case SVLogin: {
-			variable += ntohs(*((SVShort*) (data + (offset + SVIntegerSize)))) * 2;
+static
+void
+sv_ResetPacketParser (SVPacketParser* self)
+{
+	self->started  = false;
+	self->complete = false;
+	self->present  = true;
+	self->type     = 0;
+	self->needed   = SVByteSize;
+	self->offset   = SVByteSize;
+	self->field    = 0;
+	self->count    = 0;
+	self->index    = 0;
+}
 
-			goto check;
-		}
+static
+SVPacketParser*
+sv_GetPacketParser (CDBuffers* buffers)
+{
+	if (!buffers->parser) {
+		SVPacketParser* parser = CD_malloc(sizeof(SVPacketParser));
 
-		case SVHandshake: {
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
+		sv_ResetPacketParser(parser);
 
-			goto check;
-		}
+		buffers->parser = (CDPointer) parser;
+	}
 
-		case SVChat: {
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
+	return (SVPacketParser*) buffers->parser;
+}
+
+static
+size_t
+sv_MetadataSize (SVByte metatype)
+{
+	switch (((uint8_t) metatype) >> 5) {
+		case SVTypeByte:           return SVByteSize;
+		case SVTypeShort:          return SVShortSize;
+		case SVTypeInteger:        return SVIntegerSize;
+		case SVTypeFloat:          return SVFloatSize;
+		case SVTypeString:         return SVShortSize;
+		case SVTypeShortByteShort: return SVShortSize + SVByteSize + SVShortSize;
+		case SVTypeIntIntInt:      return SVIntegerSize * 3;
+		default:                   return 0;
+	}
+}
 
-			goto check;
+static
+const SVPacketFormat*
+sv_ScanFormat (uint8_t type)
+{
+	// a Packet in more than one chain has the same layout on the wire in all of them
+	for (int chain = SVRequest; chain <= SVPing; chain++) {
+		if (SVPacketFormats[chain][type].size > 0) {
+			return &SVPacketFormats[chain][type];
 		}
+	}
 
-		case SVPlayerBlockPlacement: {
-			offset += SVIntegerSize + SVByteSize + SVIntegerSize + SVByteSize;
+	return NULL;
+}
 
-			if ((SVShort)ntohs(*((SVShort*) (data + offset))) != -1) {
-				variable += 3;
-			}
+bool
+SV_PacketParsable (CDBuffers* buffers)
+{
+	SVPacketParser*       parser = sv_GetPacketParser(buffers);
+	struct evbuffer*      input  = buffers->input->raw;
+	size_t                length = evbuffer_get_length(input);
+	const SVPacketFormat* format;
+	                      errno  = 0;
+
+	// nothing new since the last time it ran out of data
+	if (length < parser->needed) {
+		goto again;
+	}
 
-			goto check;
-		}
-		
-		case SVNamedEntitySpawn: {
-			offset += SVIntegerSize;
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
-			
-			goto check;
+	if (!parser->started) {
+		uint8_t type;
+
+		PEEK(0, type);
+
+		sv_ResetPacketParser(parser);
+
+		parser->started = true;
+		parser->type    = type;
+		parser->needed  = SVPacketLength[type];
+
+		if (length < parser->needed) {
+			goto again;
 		}
-		
-		case SVSpawnObject: {
-			offset += SVIntegerSize + SVByteSize + SVIntegerSize * 3;
-			if ((SVInteger)ntohl(*((SVInteger*) (data + offset))) > 0) {
-				variable += SVShortSize * 3;
-			}
-			
-			goto check;
+	}
+
+	if (parser->complete) {
+		goto done;
+	}
+
+	if (!(format = sv_ScanFormat(parser->type))) {
+		goto done;
+	}
+
+	// resumes from the first field that wasn't complete
+	for (; parser->field < format->length; parser->field++) {
+		const SVPacketField* field = &format->field[parser->field];
+
+		if ((field->flags & SV_FIELD_GUARDED) && !parser->present) {
+			continue;
 		}
-		
-		case SVSpawnMob: {
-			offset += SVIntegerSize + SVByteSize + SVIntegerSize * 3 + SVByteSize + SVByteSize;
-			
-			while (!(CHECK)) {
-				uint8_t metatype = *((uint8_t*) (data + offset + variable) );
-				if (metatype == 127) {
-					goto done;
+
+		switch (field->type) {
+			case SVFieldString:
+			case SVFieldString16: {
+				SVShort size;
+
+				PEEK(parser->offset, size);
+
+				if ((SVShort) ntohs(size) < 0) {
+					errno = EILSEQ;
+					goto error;
 				}
-				switch (metatype >> 5) {
-					case SVTypeByte:           variable += SVByteSize;                                break;
-					case SVTypeShort:          variable += SVShortSize;                               break;
-					case SVTypeInteger:        variable += SVIntegerSize;                             break;
-					case SVTypeFloat:          variable += SVFloatSize;                               break;
-					case SVTypeString: {
-						variable += SVShortSize;
-						if (CHECK) {
-							goto error;
-						}
-						variable += *((SVShort*) (data + offset + (variable - SVShortSize) + SVByteSize)); 
-					} break;
-					case SVTypeShortByteShort: variable += SVByteSize + SVShortSize + SVByteSize;     break;
-					case SVTypeIntIntInt:      variable += SVIntegerSize * 3;     break;
-					default: {
+
+				parser->offset += SVShortSize + (SVShort) ntohs(size) * ((field->type == SVFieldString16) ? 2 : 1);
+			} break;
+
+			case SVFieldMetadata: {
+				// resumes from the first entry that wasn't complete
+				while (true) {
+					SVByte metatype;
+					size_t size;
+
+					PEEK(parser->offset, metatype);
+
+					if ((uint8_t) metatype == 127) {
+						parser->offset += SVByteSize;
+						break;
+					}
+
+					if ((size = sv_MetadataSize(metatype)) == 0) {
 						errno = EILSEQ;
 						goto error;
 					}
-				}
-				variable += SVByteSize;
-			}
-			
-			goto error;
-		}
 
-		case SVEntityMetadata: {
-			offset += SVIntegerSize;
+					if (((uint8_t) metatype) >> 5 == SVTypeString) {
+						SVShort string;
 
-			while (!(CHECK)) {
-				uint8_t metatype = *((uint8_t*) (data + offset + variable) );
-				if (metatype == 127) {
-					goto done;
-				}
-				switch (metatype >> 5) {
-					case SVTypeByte:           variable += SVByteSize;                                break;
-					case SVTypeShort:          variable += SVShortSize;                               break;
-					case SVTypeInteger:        variable += SVIntegerSize;                             break;
-					case SVTypeFloat:          variable += SVFloatSize;                               break;
-					case SVTypeString: {
-						variable += SVShortSize;
-						if (CHECK) {
+						PEEK(parser->offset + SVByteSize, string);
+
+						if ((SVShort) ntohs(string) < 0) {
+							errno = EILSEQ;
 							goto error;
 						}
-						variable += *((SVShort*) (data + offset + (variable - SVShortSize) + SVByteSize)); 
-					} break;
-					case SVTypeShortByteShort: variable += SVByteSize + SVShortSize + SVByteSize;     break;
-					case SVTypeIntIntInt:      variable += SVIntegerSize * 3;     break;
-					default: {
-						errno = EILSEQ;
-						goto error;
+
+						size += (SVShort) ntohs(string);
 					}
+
+					parser->offset += SVByteSize + size;
 				}
-				variable += SVByteSize;
-			}
-			
-			goto error;
-		}
-		
-		case SVMapChunk: {
-			offset += SVIntegerSize + SVShortSize + SVIntegerSize + SVByteSize * 3;
-			variable += ntohl(*((SVInteger*) (data + offset)));
-				
-			goto check;
-		}
-		
-		case SVMultiBlockChange: {
-			offset += SVIntegerSize + SVIntegerSize;
-			variable += ntohs(*((SVShort*) (data + offset))) * (SVShortSize + SVByteSize + SVShortSize);
-			
-			goto check;
-		}
-		
-		case SVExplosion: {
-			offset += SVDoubleSize * 3 + SVFloatSize;
-			variable += ntohl(*((SVInteger*) (data + offset))) * (SVByteSize * 3);
-			
-			goto check;
-		}
-		
-		case SVOpenWindow: {
-			offset += SVByteSize + SVByteSize;
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
-			
-			goto check;
-		}
+			} break;
 
-		case SVWindowClick: {
-			offset += SVByteSize + SVShortSize + SVByteSize + SVShortSize + SVBooleanSize;
+			case SVFieldItem: {
+				SVShort item;
 
-			if ((SVShort)ntohs(*((SVShort*) (data + offset))) != -1) {
-				variable += 3;
-			}
+				PEEK(parser->offset, item);
 
-			goto check;
-		}
-		
-		case SVSetSlot: {
-			offset += SVByteSize + SVShortSize;
-			if ((SVShort)ntohs(*((SVShort*) (data + offset))) != -1) {
-				variable += SVByteSize + SVShortSize;
-			}
-			
-			goto check;
-		}
-		
-		case SVWindowItems: {
-			offset += SVByteSize;
-			SVShort count = ntohs(*((SVShort*) (data + offset)));
-			offset += SVShortSize;
-			int i;
-			for (i=0; i<count; i++) {
-				variable += SVShortSize;
-				if (CHECK) {
-					goto error;
+				parser->offset += SVShortSize;
+
+				if ((SVShort) ntohs(item) != -1) {
+					parser->offset += SVByteSize + SVShortSize;
 				}
-				if ((SVShort)ntohs(*((SVShort*) (data + offset + (variable - SVShortSize)))) != -1) {
-					variable += SVByteSize + SVShortSize;
+			} break;
+
+			case SVFieldArray: {
+				parser->offset += parser->count * field->size;
+			} break;
+
+			case SVFieldItems: {
+				// resumes from the first item that wasn't complete
+				while (parser->index < parser->count) {
+					SVShort item;
+
+					PEEK(parser->offset, item);
+
+					parser->offset += SVShortSize;
+
+					if ((SVShort) ntohs(item) != -1) {
+						parser->offset += SVByteSize + SVShortSize;
+					}
+
+					parser->index++;
 				}
-			}
-			
-			goto check;
-		}
+			} break;
 
-		case SVUpdateSign: {
-			offset += SVIntegerSize + SVShortSize + SVIntegerSize;
+			default: {
+				if (field->flags & (SV_FIELD_COUNT | SV_FIELD_CONDITION)) {
+					int32_t value = 0;
 
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
+					switch (SV_PacketFieldSize(field)) {
+						case 1: {
+							uint8_t data;
 
-			if (CHECK) {
-				goto error;
-			}
+							PEEK(parser->offset, data);
 
-			variable += ntohs(*((SVShort*) (data + (offset += SVShortSize) + variable))) * 2;
+							// a byte counter is unsigned
+							value = (field->flags & SV_FIELD_COUNT) ? data : (int8_t) data;
+						} break;
 
-			if (CHECK) {
-				goto error;
-			}
+						case 2: {
+							SVShort data;
 
-			variable += ntohs(*((SVShort*) (data + (offset += SVShortSize) + variable))) * 2;
+							PEEK(parser->offset, data);
 
-			if (CHECK) {
-				goto error;
-			}
+							value = (SVShort) ntohs(data);
+						} break;
 
-			variable += ntohs(*((SVShort*) (data + (offset += SVShortSize) + variable))) * 2;
+						case 4: {
+							SVInteger data;
 
-			goto check;
-		}
-		
-		case SVItemData: {
-			offset += SVShortSize + SVShortSize;
-			variable += *(uint8_t*)(data + offset);
-			
-			goto check;
-		}
-		
-		case SVPlayerListItem: {
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
-			
-			goto check;
-		}
+							PEEK(parser->offset, data);
 
-		case SVDisconnect: {
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
+							value = (SVInteger) ntohl(data);
+						} break;
+					}
 
-			goto check;
-		}
+					if (field->flags & SV_FIELD_CONDITION) {
+						parser->present = value > 0;
+					}
 
-		default: {
-			goto done;
+					if (field->flags & SV_FIELD_COUNT) {
+						if (value < 0) {
+							errno = EILSEQ;
+							goto error;
+						}
+
+						parser->count = value;
+						parser->index = 0;
+					}
+				}
+
+				parser->offset += SV_PacketFieldSize(field);
+			}
 		}
 	}
 
-	check: {
-		if (CHECK) {
-			goto error;
-		}
+	parser->complete = true;
+	parser->needed   = parser->offset;
+
+	if (length < parser->needed) {
+		goto again;
 	}
 
 	done: {
+		sv_ResetPacketParser(parser);
+
 		return true;
 	}
 
-	error: {
-		if (errno != EILSEQ) {
-			errno = EAGAIN;
+	again: {
+		errno = EAGAIN;
 
-			CD_BufferReadIn(buffers, SVPacketLength[type] + variable, CDNull);
-		}
+		CD_BufferReadIn(buffers, parser->needed, CDNull);
+
+		return false;
+	}
+
+	error: {
+		sv_ResetPacketParser(parser);
 
 		return false;
 	}
@@ -0,0 +1,703 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+
+#include <craftd/protocols/survival/Packet.h>
+
+/* A field stored in the given member of the Packet struct */
+#define SV_FIELD(packet, member, type) \
+	{ SVField##type, 0, sizeof(((packet*) 0)->member), offsetof(packet, member) }
+
+#define SV_FIELD_FLAGS(packet, member, type, flags) \
+	{ SVField##type, (flags), sizeof(((packet*) 0)->member), offsetof(packet, member) }
+
+/* An array stored in the memory the member points to */
+#define SV_ARRAY(packet, member, type, element) \
+	{ SVField##type, 0, sizeof(element), offsetof(packet, member) }
+
+#define SV_FORMAT(packet, fields) \
+	{ fields, sizeof(fields) / sizeof(SVPacketField), sizeof(packet) }
+
+#define SV_PACKET_LENGTH(type, id, length, description) \
+	[id] = length,
+
+#define SV_PACKET_NAME(type, id, length, description) \
+	[id] = description,
+
+const size_t SVPacketLength[256] = {
+	SV_PACKET_SCHEMA(SV_PACKET_LENGTH)
+};
+
+const char* SVPacketName[256] = {
+	SV_PACKET_SCHEMA(SV_PACKET_NAME)
+};
+
+static const SVPacketField sv_KeepAlive[] = {
+	SV_FIELD(SVPacketKeepAlive, keepAliveID, Integer)
+};
+
+static const SVPacketField sv_LoginRequest[] = {
+	SV_FIELD(SVPacketLogin, request.version,  Integer),
+	SV_FIELD(SVPacketLogin, request.username, String16),
+	SV_FIELD(SVPacketLogin, request.u1,       Long),
+	SV_FIELD(SVPacketLogin, request.u2,       Integer),
+	SV_FIELD(SVPacketLogin, request.u3,       Byte),
+	SV_FIELD(SVPacketLogin, request.u4,       Byte),
+	SV_FIELD(SVPacketLogin, request.u5,       Byte),
+	SV_FIELD(SVPacketLogin, request.u6,       Byte)
+};
+
+static const SVPacketField sv_LoginResponse[] = {
+	SV_FIELD(SVPacketLogin, response.id,          Integer),
+	SV_FIELD(SVPacketLogin, response.u1,          String16),
+	SV_FIELD(SVPacketLogin, response.mapSeed,     Long),
+	SV_FIELD(SVPacketLogin, response.serverMode,  Integer),
+	SV_FIELD(SVPacketLogin, response.dimension,   Byte),
+	SV_FIELD(SVPacketLogin, response.u2,          Byte),
+	SV_FIELD(SVPacketLogin, response.worldHeight, Byte),
+	SV_FIELD(SVPacketLogin, response.maxPlayers,  Byte)
+};
+
+static const SVPacketField sv_HandshakeRequest[] = {
+	SV_FIELD(SVPacketHandshake, request.username, String16)
+};
+
+static const SVPacketField sv_HandshakeResponse[] = {
+	SV_FIELD(SVPacketHandshake, response.hash, String16)
+};
+
+static const SVPacketField sv_ChatRequest[] = {
+	SV_FIELD(SVPacketChat, request.message, String16)
+};
+
+static const SVPacketField sv_ChatResponse[] = {
+	SV_FIELD(SVPacketChat, response.message, String16)
+};
+
+static const SVPacketField sv_TimeUpdateResponse[] = {
+	SV_FIELD(SVPacketTimeUpdate, response.time, Long)
+};
+
+static const SVPacketField sv_EntityEquipmentResponse[] = {
+	SV_FIELD(SVPacketEntityEquipment, response.entity.id, Integer),
+	SV_FIELD(SVPacketEntityEquipment, response.slot,      Short),
+	SV_FIELD(SVPacketEntityEquipment, response.item,      Short),
+	SV_FIELD(SVPacketEntityEquipment, response.damage,    Short)
+};
+
+static const SVPacketField sv_SpawnPositionResponse[] = {
+	SV_FIELD(SVPacketSpawnPosition, response.position.x, Integer),
+	SV_FIELD(SVPacketSpawnPosition, response.position.y, Integer),
+	SV_FIELD(SVPacketSpawnPosition, response.position.z, Integer)
+};
+
+static const SVPacketField sv_UseEntityRequest[] = {
+	SV_FIELD(SVPacketUseEntity, request.user,      Integer),
+	SV_FIELD(SVPacketUseEntity, request.target,    Integer),
+	SV_FIELD(SVPacketUseEntity, request.leftClick, Boolean)
+};
+
+static const SVPacketField sv_UpdateHealthResponse[] = {
+	SV_FIELD(SVPacketUpdateHealth, response.health,         Short),
+	SV_FIELD(SVPacketUpdateHealth, response.food,           Short),
+	SV_FIELD(SVPacketUpdateHealth, response.foodSaturation, Float)
+};
+
+static const SVPacketField sv_RespawnRequest[] = {
+	SV_FIELD(SVPacketRespawn, request.world,       Byte),
+	SV_FIELD(SVPacketRespawn, request.u1,          Byte),
+	SV_FIELD(SVPacketRespawn, request.mode,        Byte),
+	SV_FIELD(SVPacketRespawn, request.worldHeight, Short),
+	SV_FIELD(SVPacketRespawn, request.mapSeed,     Long)
+};
+
+static const SVPacketField sv_RespawnResponse[] = {
+	SV_FIELD(SVPacketRespawn, response.world,       Byte),
+	SV_FIELD(SVPacketRespawn, response.u1,          Byte),
+	SV_FIELD(SVPacketRespawn, response.mode,        Byte),
+	SV_FIELD(SVPacketRespawn, response.worldHeight, Short),
+	SV_FIELD(SVPacketRespawn, response.mapSeed,     Long)
+};
+
+static const SVPacketField sv_OnGroundRequest[] = {
+	SV_FIELD(SVPacketOnGround, request.onGround, Boolean)
+};
+
+static const SVPacketField sv_PlayerPositionRequest[] = {
+	SV_FIELD(SVPacketPlayerPosition, request.position.x,  Double),
+	SV_FIELD(SVPacketPlayerPosition, request.position.y,  Double),
+	SV_FIELD(SVPacketPlayerPosition, request.stance,      Double),
+	SV_FIELD(SVPacketPlayerPosition, request.position.z,  Double),
+	SV_FIELD(SVPacketPlayerPosition, request.is.onGround, Boolean)
+};
+
+static const SVPacketField sv_PlayerLookRequest[] = {
+	SV_FIELD(SVPacketPlayerLook, request.yaw,         Float),
+	SV_FIELD(SVPacketPlayerLook, request.pitch,       Float),
+	SV_FIELD(SVPacketPlayerLook, request.is.onGround, Boolean)
+};
+
+/* the client sends the stance before y, the server after it */
+static const SVPacketField sv_PlayerMoveLookRequest[] = {
+	SV_FIELD(SVPacketPlayerMoveLook, request.position.x,  Double),
+	SV_FIELD(SVPacketPlayerMoveLook, request.stance,      Double),
+	SV_FIELD(SVPacketPlayerMoveLook, request.position.y,  Double),
+	SV_FIELD(SVPacketPlayerMoveLook, request.position.z,  Double),
+	SV_FIELD(SVPacketPlayerMoveLook, request.yaw,         Float),
+	SV_FIELD(SVPacketPlayerMoveLook, request.pitch,       Float),
+	SV_FIELD(SVPacketPlayerMoveLook, request.is.onGround, Boolean)
+};
+
+static const SVPacketField sv_PlayerMoveLookResponse[] = {
+	SV_FIELD(SVPacketPlayerMoveLook, response.position.x,  Double),
+	SV_FIELD(SVPacketPlayerMoveLook, response.position.y,  Double),
+	SV_FIELD(SVPacketPlayerMoveLook, response.stance,      Double),
+	SV_FIELD(SVPacketPlayerMoveLook, response.position.z,  Double),
+	SV_FIELD(SVPacketPlayerMoveLook, response.yaw,         Float),
+	SV_FIELD(SVPacketPlayerMoveLook, response.pitch,       Float),
+	SV_FIELD(SVPacketPlayerMoveLook, response.is.onGround, Boolean)
+};
+
+static const SVPacketField sv_PlayerDiggingRequest[] = {
+	SV_FIELD(SVPacketPlayerDigging, request.status,     Byte),
+	SV_FIELD(SVPacketPlayerDigging, request.position.x, Integer),
+	SV_FIELD(SVPacketPlayerDigging, request.position.y, Byte),
+	SV_FIELD(SVPacketPlayerDigging, request.position.z, Integer),
+	SV_FIELD(SVPacketPlayerDigging, request.face,       Byte)
+};
+
+static const SVPacketField sv_PlayerBlockPlacementRequest[] = {
+	SV_FIELD(SVPacketPlayerBlockPlacement, request.position.x, Integer),
+	SV_FIELD(SVPacketPlayerBlockPlacement, request.position.y, Byte),
+	SV_FIELD(SVPacketPlayerBlockPlacement, request.position.z, Integer),
+	SV_FIELD(SVPacketPlayerBlockPlacement, request.direction,  Byte),
+	SV_FIELD(SVPacketPlayerBlockPlacement, request.item,       Item)
+};
+
+static const SVPacketField sv_HoldChangeRequest[] = {
+	SV_FIELD(SVPacketHoldChange, request.slot, Short)
+};
+
+static const SVPacketField sv_UseBedResponse[] = {
+	SV_FIELD(SVPacketUseBed, response.entity.id,  Integer),
+	SV_FIELD(SVPacketUseBed, response.inBed,      Byte),
+	SV_FIELD(SVPacketUseBed, response.position.x, Integer),
+	SV_FIELD(SVPacketUseBed, response.position.y, Byte),
+	SV_FIELD(SVPacketUseBed, response.position.z, Integer)
+};
+
+static const SVPacketField sv_AnimationRequest[] = {
+	SV_FIELD(SVPacketAnimation, request.entity.id, Integer),
+	SV_FIELD(SVPacketAnimation, request.type,      Byte)
+};
+
+static const SVPacketField sv_AnimationResponse[] = {
+	SV_FIELD(SVPacketAnimation, response.entity.id, Integer),
+	SV_FIELD(SVPacketAnimation, response.type,      Byte)
+};
+
+static const SVPacketField sv_EntityActionRequest[] = {
+	SV_FIELD(SVPacketEntityAction, request.entity.id, Integer),
+	SV_FIELD(SVPacketEntityAction, request.type,      Byte)
+};
+
+static const SVPacketField sv_NamedEntitySpawnResponse[] = {
+	SV_FIELD(SVPacketNamedEntitySpawn, response.entity.id,  Integer),
+	SV_FIELD(SVPacketNamedEntitySpawn, response.name,       String16),
+	SV_FIELD(SVPacketNamedEntitySpawn, response.position.x, Integer),
+	SV_FIELD(SVPacketNamedEntitySpawn, response.position.y, Integer),
+	SV_FIELD(SVPacketNamedEntitySpawn, response.position.z, Integer),
+	SV_FIELD(SVPacketNamedEntitySpawn, response.rotation,   Byte),
+	SV_FIELD(SVPacketNamedEntitySpawn, response.pitch,      Byte),
+	SV_FIELD(SVPacketNamedEntitySpawn, response.itemId,     Short)
+};
+
+static const SVPacketField sv_PickupSpawnResponse[] = {
+	SV_FIELD(SVPacketPickupSpawn, response.entity.id,   Integer),
+	SV_FIELD(SVPacketPickupSpawn, response.item.id,     Short),
+	SV_FIELD(SVPacketPickupSpawn, response.item.count,  Byte),
+	SV_FIELD(SVPacketPickupSpawn, response.item.damage, Short),
+	SV_FIELD(SVPacketPickupSpawn, response.position.x,  Integer),
+	SV_FIELD(SVPacketPickupSpawn, response.position.y,  Integer),
+	SV_FIELD(SVPacketPickupSpawn, response.position.z,  Integer),
+	SV_FIELD(SVPacketPickupSpawn, response.rotation,    Byte),
+	SV_FIELD(SVPacketPickupSpawn, response.pitch,       Byte),
+	SV_FIELD(SVPacketPickupSpawn, response.roll,        Byte)
+};
+
+static const SVPacketField sv_CollectItemResponse[] = {
+	SV_FIELD(SVPacketCollectItem, response.collected, Integer),
+	SV_FIELD(SVPacketCollectItem, response.collector, Integer)
+};
+
+static const SVPacketField sv_SpawnObjectResponse[] = {
+	SV_FIELD(SVPacketSpawnObject, response.entity.id,  Integer),
+	SV_FIELD(SVPacketSpawnObject, response.type,       Byte),
+	SV_FIELD(SVPacketSpawnObject, response.position.x, Integer),
+	SV_FIELD(SVPacketSpawnObject, response.position.y, Integer),
+	SV_FIELD(SVPacketSpawnObject, response.position.z, Integer),
+
+	SV_FIELD_FLAGS(SVPacketSpawnObject, response.flag, Integer, SV_FIELD_CONDITION),
+	SV_FIELD_FLAGS(SVPacketSpawnObject, response.u1,   Short,   SV_FIELD_GUARDED),
+	SV_FIELD_FLAGS(SVPacketSpawnObject, response.u2,   Short,   SV_FIELD_GUARDED),
+	SV_FIELD_FLAGS(SVPacketSpawnObject, response.u3,   Short,   SV_FIELD_GUARDED)
+};
+
+static const SVPacketField sv_SpawnMobResponse[] = {
+	SV_FIELD(SVPacketSpawnMob, response.id,         Integer),
+	SV_FIELD(SVPacketSpawnMob, response.type,       Byte),
+	SV_FIELD(SVPacketSpawnMob, response.position.x, Integer),
+	SV_FIELD(SVPacketSpawnMob, response.position.y, Integer),
+	SV_FIELD(SVPacketSpawnMob, response.position.z, Integer),
+	SV_FIELD(SVPacketSpawnMob, response.yaw,        Byte),
+	SV_FIELD(SVPacketSpawnMob, response.pitch,      Byte),
+	SV_FIELD(SVPacketSpawnMob, response.metadata,   Metadata)
+};
+
+static const SVPacketField sv_PaintingResponse[] = {
+	SV_FIELD(SVPacketPainting, response.entity.id,  Integer),
+	SV_FIELD(SVPacketPainting, response.title,      String16),
+	SV_FIELD(SVPacketPainting, response.position.x, Integer),
+	SV_FIELD(SVPacketPainting, response.position.y, Integer),
+	SV_FIELD(SVPacketPainting, response.position.z, Integer),
+	SV_FIELD(SVPacketPainting, response.direction,  Integer)
+};
+
+static const SVPacketField sv_ExperienceOrbResponse[] = {
+	SV_FIELD(SVPacketExperienceOrb, response.entity.id,  Integer),
+	SV_FIELD(SVPacketExperienceOrb, response.position.x, Integer),
+	SV_FIELD(SVPacketExperienceOrb, response.position.y, Integer),
+	SV_FIELD(SVPacketExperienceOrb, response.position.z, Integer),
+	SV_FIELD(SVPacketExperienceOrb, response.count,      Short)
+};
+
+static const SVPacketField sv_StanceUpdateRequest[] = {
+	SV_FIELD(SVPacketStanceUpdate, request.u1, Float),
+	SV_FIELD(SVPacketStanceUpdate, request.u2, Float),
+	SV_FIELD(SVPacketStanceUpdate, request.u3, Float),
+	SV_FIELD(SVPacketStanceUpdate, request.u4, Float),
+	SV_FIELD(SVPacketStanceUpdate, request.u5, Boolean),
+	SV_FIELD(SVPacketStanceUpdate, request.u6, Boolean)
+};
+
+static const SVPacketField sv_StanceUpdateResponse[] = {
+	SV_FIELD(SVPacketStanceUpdate, response.u1, Float),
+	SV_FIELD(SVPacketStanceUpdate, response.u2, Float),
+	SV_FIELD(SVPacketStanceUpdate, response.u3, Float),
+	SV_FIELD(SVPacketStanceUpdate, response.u4, Float),
+	SV_FIELD(SVPacketStanceUpdate, response.u5, Boolean),
+	SV_FIELD(SVPacketStanceUpdate, response.u6, Boolean)
+};
+
+static const SVPacketField sv_EntityVelocityResponse[] = {
+	SV_FIELD(SVPacketEntityVelocity, response.entity.id,  Integer),
+	SV_FIELD(SVPacketEntityVelocity, response.velocity.x, Short),
+	SV_FIELD(SVPacketEntityVelocity, response.velocity.y, Short),
+	SV_FIELD(SVPacketEntityVelocity, response.velocity.z, Short)
+};
+
+static const SVPacketField sv_EntityDestroyResponse[] = {
+	SV_FIELD(SVPacketEntityDestroy, response.entity.id, Integer)
+};
+
+static const SVPacketField sv_EntityCreateResponse[] = {
+	SV_FIELD(SVPacketEntityCreate, response.entity.id, Integer)
+};
+
+static const SVPacketField sv_EntityRelativeMoveResponse[] = {
+	SV_FIELD(SVPacketEntityRelativeMove, response.entity.id,  Integer),
+	SV_FIELD(SVPacketEntityRelativeMove, response.position.x, Byte),
+	SV_FIELD(SVPacketEntityRelativeMove, response.position.y, Byte),
+	SV_FIELD(SVPacketEntityRelativeMove, response.position.z, Byte)
+};
+
+static const SVPacketField sv_EntityLookResponse[] = {
+	SV_FIELD(SVPacketEntityLook, response.entity.id, Integer),
+	SV_FIELD(SVPacketEntityLook, response.yaw,       Byte),
+	SV_FIELD(SVPacketEntityLook, response.pitch,     Byte)
+};
+
+static const SVPacketField sv_EntityLookMoveResponse[] = {
+	SV_FIELD(SVPacketEntityLookMove, response.entity.id,  Integer),
+	SV_FIELD(SVPacketEntityLookMove, response.position.x, Byte),
+	SV_FIELD(SVPacketEntityLookMove, response.position.y, Byte),
+	SV_FIELD(SVPacketEntityLookMove, response.position.z, Byte),
+	SV_FIELD(SVPacketEntityLookMove, response.yaw,        Byte),
+	SV_FIELD(SVPacketEntityLookMove, response.pitch,      Byte)
+};
+
+static const SVPacketField sv_EntityTeleportResponse[] = {
+	SV_FIELD(SVPacketEntityTeleport, response.entity.id,  Integer),
+	SV_FIELD(SVPacketEntityTeleport, response.position.x, Integer),
+	SV_FIELD(SVPacketEntityTeleport, response.position.y, Integer),
+	SV_FIELD(SVPacketEntityTeleport, response.position.z, Integer),
+	SV_FIELD(SVPacketEntityTeleport, response.rotation,   Byte),
+	SV_FIELD(SVPacketEntityTeleport, response.pitch,      Byte)
+};
+
+static const SVPacketField sv_EntityStatusResponse[] = {
+	SV_FIELD(SVPacketEntityStatus, response.entity.id, Integer),
+	SV_FIELD(SVPacketEntityStatus, response.status,    Byte)
+};
+
+static const SVPacketField sv_EntityAttachResponse[] = {
+	SV_FIELD(SVPacketEntityAttach, response.entity.id,  Integer),
+	SV_FIELD(SVPacketEntityAttach, response.vehicle.id, Integer)
+};
+
+static const SVPacketField sv_EntityMetadataRequest[] = {
+	SV_FIELD(SVPacketEntityMetadata, request.entity.id, Integer),
+	SV_FIELD(SVPacketEntityMetadata, request.metadata,  Metadata)
+};
+
+static const SVPacketField sv_EntityMetadataResponse[] = {
+	SV_FIELD(SVPacketEntityMetadata, response.entity.id, Integer),
+	SV_FIELD(SVPacketEntityMetadata, response.metadata,  Metadata)
+};
+
+static const SVPacketField sv_EntityEffectRequest[] = {
+	SV_FIELD(SVPacketEntityEffect, request.entity.id, Integer),
+	SV_FIELD(SVPacketEntityEffect, request.effect,    Byte),
+	SV_FIELD(SVPacketEntityEffect, request.amplifier, Byte),
+	SV_FIELD(SVPacketEntityEffect, request.duration,  Short)
+};
+
+static const SVPacketField sv_EntityEffectResponse[] = {
+	SV_FIELD(SVPacketEntityEffect, response.entity.id, Integer),
+	SV_FIELD(SVPacketEntityEffect, response.effect,    Byte),
+	SV_FIELD(SVPacketEntityEffect, response.amplifier, Byte),
+	SV_FIELD(SVPacketEntityEffect, response.duration,  Short)
+};
+
+static const SVPacketField sv_RemoveEntityEffectRequest[] = {
+	SV_FIELD(SVPacketRemoveEntityEffect, request.entity.id, Integer),
+	SV_FIELD(SVPacketRemoveEntityEffect, request.effect,    Byte)
+};
+
+static const SVPacketField sv_RemoveEntityEffectResponse[] = {
+	SV_FIELD(SVPacketRemoveEntityEffect, response.entity.id, Integer),
+	SV_FIELD(SVPacketRemoveEntityEffect, response.effect,    Byte)
+};
+
+static const SVPacketField sv_ExperienceResponse[] = {
+	SV_FIELD(SVPacketExperience, response.currentExperience, Byte),
+	SV_FIELD(SVPacketExperience, response.level,             Byte),
+	SV_FIELD(SVPacketExperience, response.totalExperience,   Short)
+};
+
+static const SVPacketField sv_PreChunkResponse[] = {
+	SV_FIELD(SVPacketPreChunk, response.position.x, Integer),
+	SV_FIELD(SVPacketPreChunk, response.position.z, Integer),
+	SV_FIELD(SVPacketPreChunk, response.mode,       Boolean)
+};
+
+static const SVPacketField sv_MapChunkResponse[] = {
+	SV_FIELD(SVPacketMapChunk, response.position.x, Integer),
+	SV_FIELD(SVPacketMapChunk, response.position.y, Short),
+	SV_FIELD(SVPacketMapChunk, response.position.z, Integer),
+	SV_FIELD(SVPacketMapChunk, response.size.x,     Size),
+	SV_FIELD(SVPacketMapChunk, response.size.y,     Size),
+	SV_FIELD(SVPacketMapChunk, response.size.z,     Size),
+
+	SV_FIELD_FLAGS(SVPacketMapChunk, response.length, Integer, SV_FIELD_COUNT),
+	SV_ARRAY(SVPacketMapChunk, response.item, Array, SVByte)
+};
+
+static const SVPacketField sv_MultiBlockChangeResponse[] = {
+	SV_FIELD(SVPacketMultiBlockChange, response.position.x, Integer),
+	SV_FIELD(SVPacketMultiBlockChange, response.position.z, Integer),
+
+	SV_FIELD_FLAGS(SVPacketMultiBlockChange, response.length, Short, SV_FIELD_COUNT),
+	SV_ARRAY(SVPacketMultiBlockChange, response.coordinate, Array, SVShort),
+	SV_ARRAY(SVPacketMultiBlockChange, response.type,       Array, SVByte),
+	SV_ARRAY(SVPacketMultiBlockChange, response.metadata,   Array, SVByte)
+};
+
+static const SVPacketField sv_BlockChangeResponse[] = {
+	SV_FIELD(SVPacketBlockChange, response.position.x, Integer),
+	SV_FIELD(SVPacketBlockChange, response.position.y, Byte),
+	SV_FIELD(SVPacketBlockChange, response.position.z, Integer),
+	SV_FIELD(SVPacketBlockChange, response.type,       Byte),
+	SV_FIELD(SVPacketBlockChange, response.metadata,   Byte)
+};
+
+static const SVPacketField sv_PlayNoteBlockResponse[] = {
+	SV_FIELD(SVPacketPlayNoteBlock, response.position.x, Integer),
+	SV_FIELD(SVPacketPlayNoteBlock, response.position.y, Short),
+	SV_FIELD(SVPacketPlayNoteBlock, response.position.z, Integer),
+	SV_FIELD(SVPacketPlayNoteBlock, response.data1,      Byte),
+	SV_FIELD(SVPacketPlayNoteBlock, response.data2,      Byte)
+};
+
+static const SVPacketField sv_ExplosionResponse[] = {
+	SV_FIELD(SVPacketExplosion, response.position.x, Double),
+	SV_FIELD(SVPacketExplosion, response.position.y, Double),
+	SV_FIELD(SVPacketExplosion, response.position.z, Double),
+	SV_FIELD(SVPacketExplosion, response.radius,     Float),
+
+	SV_FIELD_FLAGS(SVPacketExplosion, response.length, Integer, SV_FIELD_COUNT),
+	SV_ARRAY(SVPacketExplosion, response.item, Array, SVRelativePosition)
+};
+
+static const SVPacketField sv_SoundEffectResponse[] = {
+	SV_FIELD(SVPacketSoundEffect, response.effect,     Integer),
+	SV_FIELD(SVPacketSoundEffect, response.position.x, Integer),
+	SV_FIELD(SVPacketSoundEffect, response.position.y, Byte),
+	SV_FIELD(SVPacketSoundEffect, response.position.z, Integer),
+	SV_FIELD(SVPacketSoundEffect, response.data,       Integer)
+};
+
+static const SVPacketField sv_StateResponse[] = {
+	SV_FIELD(SVPacketState, response.reason,   Byte),
+	SV_FIELD(SVPacketState, response.gameMode, Byte)
+};
+
+static const SVPacketField sv_ThunderboltResponse[] = {
+	SV_FIELD(SVPacketThunderbolt, response.entity.id,  Integer),
+	SV_FIELD(SVPacketThunderbolt, response.u1,         Boolean),
+	SV_FIELD(SVPacketThunderbolt, response.position.x, Integer),
+	SV_FIELD(SVPacketThunderbolt, response.position.y, Integer),
+	SV_FIELD(SVPacketThunderbolt, response.position.z, Integer)
+};
+
+/* the title is the only string of the protocol that's still UTF-8 */
+static const SVPacketField sv_OpenWindowResponse[] = {
+	SV_FIELD(SVPacketOpenWindow, response.id,    Byte),
+	SV_FIELD(SVPacketOpenWindow, response.type,  Byte),
+	SV_FIELD(SVPacketOpenWindow, response.title, String),
+	SV_FIELD(SVPacketOpenWindow, response.slots, Byte)
+};
+
+static const SVPacketField sv_CloseWindowRequest[] = {
+	SV_FIELD(SVPacketCloseWindow, request.id, Byte)
+};
+
+static const SVPacketField sv_CloseWindowResponse[] = {
+	SV_FIELD(SVPacketCloseWindow, response.id, Byte)
+};
+
+static const SVPacketField sv_WindowClickRequest[] = {
+	SV_FIELD(SVPacketWindowClick, request.id,           Byte),
+	SV_FIELD(SVPacketWindowClick, request.slot,         Short),
+	SV_FIELD(SVPacketWindowClick, request.rightClick,   Boolean),
+	SV_FIELD(SVPacketWindowClick, request.action,       Short),
+	SV_FIELD(SVPacketWindowClick, request.shiftPressed, Boolean),
+	SV_FIELD(SVPacketWindowClick, request.item,         Item)
+};
+
+static const SVPacketField sv_SetSlotResponse[] = {
+	SV_FIELD(SVPacketSetSlot, response.windowId,  Byte),
+	SV_FIELD(SVPacketSetSlot, response.item.slot, Short),
+	SV_FIELD(SVPacketSetSlot, response.item,      Item)
+};
+
+static const SVPacketField sv_WindowItemsResponse[] = {
+	SV_FIELD(SVPacketWindowItems, response.id, Byte),
+
+	SV_FIELD_FLAGS(SVPacketWindowItems, response.length, Short, SV_FIELD_COUNT),
+	SV_ARRAY(SVPacketWindowItems, response.item, Items, SVItemStack)
+};
+
+static const SVPacketField sv_UpdateProgressBarResponse[] = {
+	SV_FIELD(SVPacketUpdateProgressBar, response.id,    Byte),
+	SV_FIELD(SVPacketUpdateProgressBar, response.bar,   Short),
+	SV_FIELD(SVPacketUpdateProgressBar, response.value, Short)
+};
+
+static const SVPacketField sv_TransactionRequest[] = {
+	SV_FIELD(SVPacketTransaction, request.id,       Byte),
+	SV_FIELD(SVPacketTransaction, request.action,   Short),
+	SV_FIELD(SVPacketTransaction, request.accepted, Boolean)
+};
+
+static const SVPacketField sv_TransactionResponse[] = {
+	SV_FIELD(SVPacketTransaction, response.id,       Byte),
+	SV_FIELD(SVPacketTransaction, response.action,   Short),
+	SV_FIELD(SVPacketTransaction, response.accepted, Boolean)
+};
+
+static const SVPacketField sv_CreativeInventoryActionRequest[] = {
+	SV_FIELD(SVPacketCreativeInventoryAction, request.slot,     Short),
+	SV_FIELD(SVPacketCreativeInventoryAction, request.itemId,   Short),
+	SV_FIELD(SVPacketCreativeInventoryAction, request.quantity, Short),
+	SV_FIELD(SVPacketCreativeInventoryAction, request.damage,   Short)
+};
+
+static const SVPacketField sv_CreativeInventoryActionResponse[] = {
+	SV_FIELD(SVPacketCreativeInventoryAction, response.slot,     Short),
+	SV_FIELD(SVPacketCreativeInventoryAction, response.itemId,   Short),
+	SV_FIELD(SVPacketCreativeInventoryAction, response.quantity, Short),
+	SV_FIELD(SVPacketCreativeInventoryAction, response.damage,   Short)
+};
+
+static const SVPacketField sv_UpdateSignRequest[] = {
+	SV_FIELD(SVPacketUpdateSign, request.position.x, Integer),
+	SV_FIELD(SVPacketUpdateSign, request.position.y, Short),
+	SV_FIELD(SVPacketUpdateSign, request.position.z, Integer),
+	SV_FIELD(SVPacketUpdateSign, request.first,      String16),
+	SV_FIELD(SVPacketUpdateSign, request.second,     String16),
+	SV_FIELD(SVPacketUpdateSign, request.third,      String16),
+	SV_FIELD(SVPacketUpdateSign, request.fourth,     String16)
+};
+
+static const SVPacketField sv_UpdateSignResponse[] = {
+	SV_FIELD(SVPacketUpdateSign, response.position.x, Integer),
+	SV_FIELD(SVPacketUpdateSign, response.position.y, Short),
+	SV_FIELD(SVPacketUpdateSign, response.position.z, Integer),
+	SV_FIELD(SVPacketUpdateSign, response.first,      String16),
+	SV_FIELD(SVPacketUpdateSign, response.second,     String16),
+	SV_FIELD(SVPacketUpdateSign, response.third,      String16),
+	SV_FIELD(SVPacketUpdateSign, response.fourth,     String16)
+};
+
+static const SVPacketField sv_ItemDataResponse[] = {
+	SV_FIELD(SVPacketItemData, response.itemType, Short),
+	SV_FIELD(SVPacketItemData, response.itemId,   Short),
+
+	SV_FIELD_FLAGS(SVPacketItemData, response.textLength, Byte, SV_FIELD_COUNT),
+	SV_ARRAY(SVPacketItemData, response.text, Array, SVByte)
+};
+
+static const SVPacketField sv_IncrementStatisticRequest[] = {
+	SV_FIELD(SVPacketIncrementStatistic, request.id,     Integer),
+	SV_FIELD(SVPacketIncrementStatistic, request.amount, Byte)
+};
+
+static const SVPacketField sv_IncrementStatisticResponse[] = {
+	SV_FIELD(SVPacketIncrementStatistic, response.id,     Integer),
+	SV_FIELD(SVPacketIncrementStatistic, response.amount, Byte)
+};
+
+static const SVPacketField sv_PlayerListItemResponse[] = {
+	SV_FIELD(SVPacketPlayerListItem, response.playerName, String16),
+	SV_FIELD(SVPacketPlayerListItem, response.online,     Boolean),
+	SV_FIELD(SVPacketPlayerListItem, response.ping,       Short)
+};
+
+static const SVPacketField sv_DisconnectRequest[] = {
+	SV_FIELD(SVPacketDisconnect, request.reason, String16)
+};
+
+static const SVPacketField sv_DisconnectResponse[] = {
+	SV_FIELD(SVPacketDisconnect, response.reason, String16)
+};
+
+static const SVPacketField sv_DisconnectPing[] = {
+	SV_FIELD(SVPacketDisconnect, ping.description, String16)
+};
+
+const SVPacketFormat SVPacketFormats[3][256] = {
+	[SVRequest] = {
+		[SVKeepAlive]               = SV_FORMAT(SVPacketKeepAlive,               sv_KeepAlive),
+		[SVLogin]                   = SV_FORMAT(SVPacketLogin,                   sv_LoginRequest),
+		[SVHandshake]               = SV_FORMAT(SVPacketHandshake,               sv_HandshakeRequest),
+		[SVChat]                    = SV_FORMAT(SVPacketChat,                    sv_ChatRequest),
+		[SVUseEntity]               = SV_FORMAT(SVPacketUseEntity,               sv_UseEntityRequest),
+		[SVRespawn]                 = SV_FORMAT(SVPacketRespawn,                 sv_RespawnRequest),
+		[SVOnGround]                = SV_FORMAT(SVPacketOnGround,                sv_OnGroundRequest),
+		[SVPlayerPosition]          = SV_FORMAT(SVPacketPlayerPosition,          sv_PlayerPositionRequest),
+		[SVPlayerLook]              = SV_FORMAT(SVPacketPlayerLook,              sv_PlayerLookRequest),
+		[SVPlayerMoveLook]          = SV_FORMAT(SVPacketPlayerMoveLook,          sv_PlayerMoveLookRequest),
+		[SVPlayerDigging]           = SV_FORMAT(SVPacketPlayerDigging,           sv_PlayerDiggingRequest),
+		[SVPlayerBlockPlacement]    = SV_FORMAT(SVPacketPlayerBlockPlacement,    sv_PlayerBlockPlacementRequest),
+		[SVHoldChange]              = SV_FORMAT(SVPacketHoldChange,              sv_HoldChangeRequest),
+		[SVAnimation]               = SV_FORMAT(SVPacketAnimation,               sv_AnimationRequest),
+		[SVEntityAction]            = SV_FORMAT(SVPacketEntityAction,            sv_EntityActionRequest),
+		[SVStanceUpdate]            = SV_FORMAT(SVPacketStanceUpdate,            sv_StanceUpdateRequest),
+		[SVEntityMetadata]          = SV_FORMAT(SVPacketEntityMetadata,          sv_EntityMetadataRequest),
+		[SVEntityEffect]            = SV_FORMAT(SVPacketEntityEffect,            sv_EntityEffectRequest),
+		[SVRemoveEntityEffect]      = SV_FORMAT(SVPacketRemoveEntityEffect,      sv_RemoveEntityEffectRequest),
+		[SVCloseWindow]             = SV_FORMAT(SVPacketCloseWindow,             sv_CloseWindowRequest),
+		[SVWindowClick]             = SV_FORMAT(SVPacketWindowClick,             sv_WindowClickRequest),
+		[SVTransaction]             = SV_FORMAT(SVPacketTransaction,             sv_TransactionRequest),
+		[SVCreativeInventoryAction] = SV_FORMAT(SVPacketCreativeInventoryAction, sv_CreativeInventoryActionRequest),
+		[SVUpdateSign]              = SV_FORMAT(SVPacketUpdateSign,              sv_UpdateSignRequest),
+		[SVIncrementStatistic]      = SV_FORMAT(SVPacketIncrementStatistic,      sv_IncrementStatisticRequest),
+		[SVListPing]                = { NULL, 0, sizeof(SVPacketListPing) },
+		[SVDisconnect]              = SV_FORMAT(SVPacketDisconnect,              sv_DisconnectRequest)
+	},
+
+	[SVResponse] = {
+		[SVKeepAlive]               = SV_FORMAT(SVPacketKeepAlive,               sv_KeepAlive),
+		[SVLogin]                   = SV_FORMAT(SVPacketLogin,                   sv_LoginResponse),
+		[SVHandshake]               = SV_FORMAT(SVPacketHandshake,               sv_HandshakeResponse),
+		[SVChat]                    = SV_FORMAT(SVPacketChat,                    sv_ChatResponse),
+		[SVTimeUpdate]              = SV_FORMAT(SVPacketTimeUpdate,              sv_TimeUpdateResponse),
+		[SVEntityEquipment]         = SV_FORMAT(SVPacketEntityEquipment,         sv_EntityEquipmentResponse),
+		[SVSpawnPosition]           = SV_FORMAT(SVPacketSpawnPosition,           sv_SpawnPositionResponse),
+		[SVUpdateHealth]            = SV_FORMAT(SVPacketUpdateHealth,            sv_UpdateHealthResponse),
+		[SVRespawn]                 = SV_FORMAT(SVPacketRespawn,                 sv_RespawnResponse),
+		[SVPlayerMoveLook]          = SV_FORMAT(SVPacketPlayerMoveLook,          sv_PlayerMoveLookResponse),
+		[SVUseBed]                  = SV_FORMAT(SVPacketUseBed,                  sv_UseBedResponse),
+		[SVAnimation]               = SV_FORMAT(SVPacketAnimation,               sv_AnimationResponse),
+		[SVNamedEntitySpawn]        = SV_FORMAT(SVPacketNamedEntitySpawn,        sv_NamedEntitySpawnResponse),
+		[SVPickupSpawn]             = SV_FORMAT(SVPacketPickupSpawn,             sv_PickupSpawnResponse),
+		[SVCollectItem]             = SV_FORMAT(SVPacketCollectItem,             sv_CollectItemResponse),
+		[SVSpawnObject]             = SV_FORMAT(SVPacketSpawnObject,             sv_SpawnObjectResponse),
+		[SVSpawnMob]                = SV_FORMAT(SVPacketSpawnMob,                sv_SpawnMobResponse),
+		[SVPainting]                = SV_FORMAT(SVPacketPainting,                sv_PaintingResponse),
+		[SVExperienceOrb]           = SV_FORMAT(SVPacketExperienceOrb,           sv_ExperienceOrbResponse),
+		[SVStanceUpdate]            = SV_FORMAT(SVPacketStanceUpdate,            sv_StanceUpdateResponse),
+		[SVEntityVelocity]          = SV_FORMAT(SVPacketEntityVelocity,          sv_EntityVelocityResponse),
+		[SVEntityDestroy]           = SV_FORMAT(SVPacketEntityDestroy,           sv_EntityDestroyResponse),
+		[SVEntityCreate]            = SV_FORMAT(SVPacketEntityCreate,            sv_EntityCreateResponse),
+		[SVEntityRelativeMove]      = SV_FORMAT(SVPacketEntityRelativeMove,      sv_EntityRelativeMoveResponse),
+		[SVEntityLook]              = SV_FORMAT(SVPacketEntityLook,              sv_EntityLookResponse),
+		[SVEntityLookMove]          = SV_FORMAT(SVPacketEntityLookMove,          sv_EntityLookMoveResponse),
+		[SVEntityTeleport]          = SV_FORMAT(SVPacketEntityTeleport,          sv_EntityTeleportResponse),
+		[SVEntityStatus]            = SV_FORMAT(SVPacketEntityStatus,            sv_EntityStatusResponse),
+		[SVEntityAttach]            = SV_FORMAT(SVPacketEntityAttach,            sv_EntityAttachResponse),
+		[SVEntityMetadata]          = SV_FORMAT(SVPacketEntityMetadata,          sv_EntityMetadataResponse),
+		[SVEntityEffect]            = SV_FORMAT(SVPacketEntityEffect,            sv_EntityEffectResponse),
+		[SVRemoveEntityEffect]      = SV_FORMAT(SVPacketRemoveEntityEffect,      sv_RemoveEntityEffectResponse),
+		[SVExperience]              = SV_FORMAT(SVPacketExperience,              sv_ExperienceResponse),
+		[SVPreChunk]                = SV_FORMAT(SVPacketPreChunk,                sv_PreChunkResponse),
+		[SVMapChunk]                = SV_FORMAT(SVPacketMapChunk,                sv_MapChunkResponse),
+		[SVMultiBlockChange]        = SV_FORMAT(SVPacketMultiBlockChange,        sv_MultiBlockChangeResponse),
+		[SVBlockChange]             = SV_FORMAT(SVPacketBlockChange,             sv_BlockChangeResponse),
+		[SVPlayNoteBlock]           = SV_FORMAT(SVPacketPlayNoteBlock,           sv_PlayNoteBlockResponse),
+		[SVExplosion]               = SV_FORMAT(SVPacketExplosion,               sv_ExplosionResponse),
+		[SVSoundEffect]             = SV_FORMAT(SVPacketSoundEffect,             sv_SoundEffectResponse),
+		[SVState]                   = SV_FORMAT(SVPacketState,                   sv_StateResponse),
+		[SVThunderbolt]             = SV_FORMAT(SVPacketThunderbolt,             sv_ThunderboltResponse),
+		[SVOpenWindow]              = SV_FORMAT(SVPacketOpenWindow,              sv_OpenWindowResponse),
+		[SVCloseWindow]             = SV_FORMAT(SVPacketCloseWindow,             sv_CloseWindowResponse),
+		[SVSetSlot]                 = SV_FORMAT(SVPacketSetSlot,                 sv_SetSlotResponse),
+		[SVWindowItems]             = SV_FORMAT(SVPacketWindowItems,             sv_WindowItemsResponse),
+		[SVUpdateProgressBar]       = SV_FORMAT(SVPacketUpdateProgressBar,       sv_UpdateProgressBarResponse),
+		[SVTransaction]             = SV_FORMAT(SVPacketTransaction,             sv_TransactionResponse),
+		[SVCreativeInventoryAction] = SV_FORMAT(SVPacketCreativeInventoryAction, sv_CreativeInventoryActionResponse),
+		[SVUpdateSign]              = SV_FORMAT(SVPacketUpdateSign,              sv_UpdateSignResponse),
+		[SVItemData]                = SV_FORMAT(SVPacketItemData,                sv_ItemDataResponse),
+		[SVIncrementStatistic]      = SV_FORMAT(SVPacketIncrementStatistic,      sv_IncrementStatisticResponse),
+		[SVPlayerListItem]          = SV_FORMAT(SVPacketPlayerListItem,          sv_PlayerListItemResponse),
+		[SVDisconnect]              = SV_FORMAT(SVPacketDisconnect,              sv_DisconnectResponse)
+	},
+
+	[SVPing] = {
+		[SVDisconnect]              = SV_FORMAT(SVPacketDisconnect,              sv_DisconnectPing)
+	}
+};
@@ -131,3 +131,33 @@ SV_PlayerSendPacketAndCleanData (SVPlayer* self, SVPacket* packet)
 	CD_DestroyBuffer(data);
 	SV_DestroyPacketData(packet);
 }
+
+void
+SV_PlayersSendPacket (CDMap* players, SVPacket* packet, SVPlayer* except)
+{
+	assert(packet);
+
+	if (!players || CD_MapLength(players) == 0) {
+		return;
+	}
+
+	CDSharedBuffer* data = SV_PacketToSharedBuffer(packet);
+
+	if (!data) {
+		return;
+	}
+
+	CD_MAP_FOREACH(players, it) {
+		SVPlayer* player = (SVPlayer*) CD_MapIteratorValue(it);
+
+		if (player == except || !player->client) {
+			continue;
+		}
+
+		if (CD_ClientGetStatus(player->client) != CDClientDisconnect) {
+			CD_ClientSendSharedBuffer(player->client, data);
+		}
+	}
+
+	CD_DestroySharedBuffer(data);
+}
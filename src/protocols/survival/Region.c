@@ -58,15 +58,7 @@ SV_RelativeMove (SVPrecisePosition* a, SVPrecisePosition* b)
 void
 SV_RegionBroadcastPacket (SVPlayer* player, SVPacket* packet)
 {
-	CDList* seenPlayers = (CDList*) CD_DynamicGet(player, "Player.seenPlayers");
-
-	CD_LIST_FOREACH(seenPlayers, it) {
-		if (player == (SVPlayer*) CD_ListIteratorValue(it)) {
-			continue;
-		}
-
-		SV_PlayerSendPacket((SVPlayer*) CD_ListIteratorValue(it), packet);
-	}
+	SV_PlayersSendPacket((CDMap*) CD_DynamicGet(player, "Player.visible"), packet, player);
 }
 
 
@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/protocols/survival/Section.h>
+
+/* Blocks are at most an 8 bit type and 4 bits of metadata, so no palette holds more values */
+#define SV_PALETTE_VALUES 4096
+
+static inline
+size_t
+sv_SectionIndex (SVBlockPosition position)
+{
+	return ((position.x & 15) << 8) | ((position.z & 15) << 4) | (position.y & 15);
+}
+
+static inline
+size_t
+sv_PaletteCapacity (uint8_t bits)
+{
+	return CD_Min(1 << bits, SV_PALETTE_VALUES);
+}
+
+// the widths divide 64, so an index never straddles two words
+static inline
+uint16_t
+sv_PaletteGetIndex (SVPalette* self, size_t index)
+{
+	size_t bit = index * self->bits;
+
+	return (self->data[bit >> 6] >> (bit & 63)) & ((1 << self->bits) - 1);
+}
+
+static inline
+void
+sv_PaletteSetIndex (SVPalette* self, size_t index, uint16_t entry)
+{
+	size_t   bit  = index * self->bits;
+	uint64_t mask = (((uint64_t) 1 << self->bits) - 1) << (bit & 63);
+
+	self->data[bit >> 6] = (self->data[bit >> 6] & ~mask) | ((uint64_t) entry << (bit & 63));
+}
+
+static inline
+uint16_t
+sv_PaletteGet (SVPalette* self, size_t index)
+{
+	if (self->bits == 0) {
+		return self->value;
+	}
+
+	return self->item[sv_PaletteGetIndex(self, index)];
+}
+
+/**
+ * Repack the indices with more bits, indices of a uniform section are all 0
+ */
+static
+void
+sv_PaletteResize (SVPalette* self, uint8_t bits)
+{
+	uint64_t* data = CD_alloc(SV_SECTION_BLOCKS * bits / 8);
+	uint64_t* old  = self->data;
+	uint8_t   from = self->bits;
+
+	self->data = data;
+	self->bits = bits;
+
+	if (from > 0) {
+		SVPalette previous = { .bits = from, .data = old };
+
+		for (size_t i = 0; i < SV_SECTION_BLOCKS; i++) {
+			sv_PaletteSetIndex(self, i, sv_PaletteGetIndex(&previous, i));
+		}
+
+		CD_free(old);
+	}
+
+	self->item = CD_realloc(self->item, sv_PaletteCapacity(bits) * sizeof(uint16_t));
+}
+
+/**
+ * Set the value of a block, a uniform section gets a palette on the first
+ * different value and the indices get wider when the palette is full
+ */
+static
+bool
+sv_PaletteSet (SVPalette* self, size_t index, uint16_t value)
+{
+	size_t entry;
+
+	if (sv_PaletteGet(self, index) == value) {
+		return false;
+	}
+
+	if (self->bits == 0) {
+		self->item    = CD_malloc(sizeof(uint16_t));
+		self->item[0] = self->value;
+		self->length  = 1;
+
+		sv_PaletteResize(self, 1);
+	}
+
+	for (entry = 0; entry < self->length; entry++) {
+		if (self->item[entry] == value) {
+			break;
+		}
+	}
+
+	if (entry == self->length) {
+		if (self->length == sv_PaletteCapacity(self->bits)) {
+			sv_PaletteResize(self, self->bits * 2);
+		}
+
+		self->item[self->length++] = value;
+	}
+
+	sv_PaletteSetIndex(self, index, entry);
+
+	return true;
+}
+
+/**
+ * Build the smallest palette for the values of a section
+ */
+static
+void
+sv_PaletteFill (SVPalette* self, uint16_t* values)
+{
+	uint16_t lookup[SV_PALETTE_VALUES];
+	uint16_t item[SV_PALETTE_VALUES];
+	uint16_t length  = 0;
+	uint16_t highest = values[0];
+	bool     uniform = true;
+
+	self->length = 0;
+	self->item   = NULL;
+	self->data   = NULL;
+
+	for (size_t i = 1; i < SV_SECTION_BLOCKS; i++) {
+		uniform &= values[i] == values[0];
+
+		if (values[i] > highest) {
+			highest = values[i];
+		}
+	}
+
+	if (uniform) {
+		self->bits  = 0;
+		self->value = values[0];
+
+		return;
+	}
+
+	// only clear the part of the lookup the values use, light never goes past 15
+	memset(lookup, 0, (highest + 1) * sizeof(uint16_t));
+
+	for (size_t i = 0; i < SV_SECTION_BLOCKS; i++) {
+		if (lookup[values[i]] == 0) {
+			item[length]      = values[i];
+			lookup[values[i]] = ++length;
+		}
+	}
+
+	self->bits = 1;
+
+	while ((1 << self->bits) < length) {
+		self->bits *= 2;
+	}
+
+	self->length = length;
+	self->item   = CD_malloc(sv_PaletteCapacity(self->bits) * sizeof(uint16_t));
+	self->data   = CD_alloc(SV_SECTION_BLOCKS * self->bits / 8);
+
+	memcpy(self->item, item, length * sizeof(uint16_t));
+
+	// build whole words, setting the indices one by one would load and store the same word each time
+	for (size_t word = 0, i = 0; word < SV_SECTION_BLOCKS * self->bits / 64; word++) {
+		uint64_t packed = 0;
+
+		for (size_t shift = 0; shift < 64; shift += self->bits, i++) {
+			packed |= (uint64_t) (lookup[values[i]] - 1) << shift;
+		}
+
+		self->data[word] = packed;
+	}
+}
+
+/**
+ * Write the values of a section in chunk order, the low 4 bits go in the
+ * nibble array and the rest in the byte array if there's one
+ */
+static
+void
+sv_PaletteExpand (SVPalette* self, int section, uint8_t* bytes, uint8_t* nibbles)
+{
+	for (size_t column = 0; column < SV_SECTION_SIZE * SV_SECTION_SIZE; column++) {
+		size_t base = section * SV_SECTION_SIZE + 128 * column;
+
+		if (self->bits == 0) {
+			if (bytes) {
+				memset(bytes + base, self->value >> 4, SV_SECTION_SIZE);
+			}
+
+			memset(nibbles + base / 2, (self->value & 0x0F) * 0x11, SV_SECTION_SIZE / 2);
+
+			continue;
+		}
+
+		for (size_t y = 0; y < SV_SECTION_SIZE; y += 2) {
+			uint16_t low  = sv_PaletteGet(self, (column << 4) | y);
+			uint16_t high = sv_PaletteGet(self, (column << 4) | (y + 1));
+
+			if (bytes) {
+				bytes[base + y]     = low >> 4;
+				bytes[base + y + 1] = high >> 4;
+			}
+
+			nibbles[(base + y) / 2] = (low & 0x0F) | ((high & 0x0F) << 4);
+		}
+	}
+}
+
+static
+void
+sv_PaletteDestroy (SVPalette* self)
+{
+	if (self->item) {
+		CD_free(self->item);
+	}
+
+	if (self->data) {
+		CD_free(self->data);
+	}
+}
+
+static
+size_t
+sv_PaletteSize (SVPalette* self)
+{
+	if (self->bits == 0) {
+		return 0;
+	}
+
+	return sv_PaletteCapacity(self->bits) * sizeof(uint16_t) + SV_SECTION_BLOCKS * self->bits / 8;
+}
+
+SVPackedChunk*
+SV_CreatePackedChunk (SVChunk* chunk)
+{
+	SVPackedChunk* self = CD_malloc(sizeof(SVPackedChunk));
+	uint16_t       blocks[SV_SECTION_BLOCKS];
+	uint16_t       blockLight[SV_SECTION_BLOCKS];
+	uint16_t       skyLight[SV_SECTION_BLOCKS];
+
+	assert(chunk);
+
+	self->position = chunk->position;
+
+	memcpy(self->heightMap, chunk->heightMap, sizeof(self->heightMap));
+
+	for (int s = 0; s < SV_CHUNK_SECTIONS; s++) {
+		// the chunk arrays are columns of 128 blocks, sections take 16 of each column
+		for (size_t column = 0; column < SV_SECTION_SIZE * SV_SECTION_SIZE; column++) {
+			for (size_t y = 0; y < SV_SECTION_SIZE; y++) {
+				size_t  index  = s * SV_SECTION_SIZE + y + 128 * column;
+				size_t  i      = (column << 4) | y;
+				uint8_t shift  = (index & 1) ? 4 : 0;
+
+				blocks[i]     = (chunk->blocks[index] << 4) | ((chunk->data[index >> 1] >> shift) & 0x0F);
+				blockLight[i] = (chunk->blockLight[index >> 1] >> shift) & 0x0F;
+				skyLight[i]   = (chunk->skyLight[index >> 1] >> shift) & 0x0F;
+			}
+		}
+
+		sv_PaletteFill(&self->sections[s].blocks,     blocks);
+		sv_PaletteFill(&self->sections[s].blockLight, blockLight);
+		sv_PaletteFill(&self->sections[s].skyLight,   skyLight);
+	}
+
+	return self;
+}
+
+void
+SV_DestroyPackedChunk (SVPackedChunk* self)
+{
+	assert(self);
+
+	for (int s = 0; s < SV_CHUNK_SECTIONS; s++) {
+		sv_PaletteDestroy(&self->sections[s].blocks);
+		sv_PaletteDestroy(&self->sections[s].blockLight);
+		sv_PaletteDestroy(&self->sections[s].skyLight);
+	}
+
+	CD_free(self);
+}
+
+void
+SV_PackedChunkReplace (SVPackedChunk* self, SVPackedChunk* other)
+{
+	assert(self);
+	assert(other);
+
+	for (int s = 0; s < SV_CHUNK_SECTIONS; s++) {
+		sv_PaletteDestroy(&self->sections[s].blocks);
+		sv_PaletteDestroy(&self->sections[s].blockLight);
+		sv_PaletteDestroy(&self->sections[s].skyLight);
+	}
+
+	// the palettes change hands, only the shell of the other one is left to free
+	*self = *other;
+
+	CD_free(other);
+}
+
+void
+SV_PackedChunkExpand (SVPackedChunk* self, SVChunk* result)
+{
+	assert(self);
+	assert(result);
+
+	result->position = self->position;
+
+	memcpy(result->heightMap, self->heightMap, sizeof(result->heightMap));
+
+	for (int s = 0; s < SV_CHUNK_SECTIONS; s++) {
+		sv_PaletteExpand(&self->sections[s].blocks,     s, result->blocks, result->data);
+		sv_PaletteExpand(&self->sections[s].blockLight, s, NULL,           result->blockLight);
+		sv_PaletteExpand(&self->sections[s].skyLight,   s, NULL,           result->skyLight);
+	}
+}
+
+void
+SV_PackedChunkGetBlock (SVPackedChunk* self, SVBlockPosition position, uint8_t* type, uint8_t* metadata)
+{
+	uint16_t value;
+
+	assert(self);
+	assert(position.y >= 0);
+
+	value = sv_PaletteGet(&self->sections[position.y / SV_SECTION_SIZE].blocks, sv_SectionIndex(position));
+
+	*type     = value >> 4;
+	*metadata = value & 0x0F;
+}
+
+bool
+SV_PackedChunkSetBlock (SVPackedChunk* self, SVBlockPosition position, uint8_t type, uint8_t metadata)
+{
+	assert(self);
+	assert(position.y >= 0);
+
+	return sv_PaletteSet(&self->sections[position.y / SV_SECTION_SIZE].blocks, sv_SectionIndex(position),
+		(type << 4) | (metadata & 0x0F));
+}
+
+size_t
+SV_PackedChunkSize (SVPackedChunk* self)
+{
+	size_t result = sizeof(SVPackedChunk);
+
+	assert(self);
+
+	for (int s = 0; s < SV_CHUNK_SECTIONS; s++) {
+		result += sv_PaletteSize(&self->sections[s].blocks);
+		result += sv_PaletteSize(&self->sections[s].blockLight);
+		result += sv_PaletteSize(&self->sections[s].skyLight);
+	}
+
+	return result;
+}
@@ -23,7 +23,78 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <zlib.h>
+
 #include <craftd/protocols/survival/World.h>
+#include <craftd/protocols/survival/Region.h>
+
+static inline
+CDMapId
+sv_ChunkId (int x, int z)
+{
+	return SV_ChunkPositionToId((SVChunkPosition) { .x = x, .z = z });
+}
+
+/**
+ * Put an entity in the cell of the chunk it's in, the grid has to be write locked
+ */
+static
+void
+sv_WorldCellAdd (SVWorld* self, SVEntity* entity)
+{
+	SVChunkPosition position = SV_PrecisePositionToChunkPosition(entity->position);
+	CDMapId         id       = sv_ChunkId(position.x, position.z);
+	SVWorldCell*    cell     = (SVWorldCell*) CD_MapGet(self->grid.cells, id);
+
+	if (!cell) {
+		cell           = CD_malloc(sizeof(SVWorldCell));
+		cell->position = position;
+		cell->item     = NULL;
+		cell->length   = 0;
+		cell->size     = 0;
+
+		CD_MapPut(self->grid.cells, id, (CDPointer) cell);
+	}
+
+	if (cell->length == cell->size) {
+		cell->size = cell->size ? cell->size * 2 : 4;
+		cell->item = CD_realloc(cell->item, sizeof(SVEntity*) * cell->size);
+	}
+
+	cell->item[cell->length++] = entity;
+}
+
+/**
+ * Take an entity out of the cell of the chunk it's in, empty cells are freed.
+ * The grid has to be write locked.
+ */
+static
+void
+sv_WorldCellRemove (SVWorld* self, SVEntity* entity)
+{
+	SVChunkPosition position = SV_PrecisePositionToChunkPosition(entity->position);
+	CDMapId         id       = sv_ChunkId(position.x, position.z);
+	SVWorldCell*    cell     = (SVWorldCell*) CD_MapGet(self->grid.cells, id);
+
+	if (!cell) {
+		return;
+	}
+
+	for (size_t i = 0; i < cell->length; i++) {
+		if (cell->item[i] == entity) {
+			cell->item[i] = cell->item[--cell->length];
+
+			break;
+		}
+	}
+
+	if (cell->length == 0) {
+		CD_MapDelete(self->grid.cells, id);
+
+		CD_free(cell->item);
+		CD_free(cell);
+	}
+}
 
 SVWorld*
 SV_CreateWorld (CDServer* server, const char* name)
@@ -36,15 +107,88 @@ SV_CreateWorld (CDServer* server, const char* name)
 		CD_abort("pthread spinlock failed to initialize");
 	}
 
+	if (pthread_mutex_init(&self->chunks.lock, NULL) != 0) {
+		CD_abort("pthread mutex failed to initialize");
+	}
+
+	if (pthread_cond_init(&self->chunks.loaded, NULL) != 0) {
+		CD_abort("pthread cond failed to initialize");
+	}
+
+	if (pthread_rwlock_init(&self->grid.lock, NULL) != 0) {
+		CD_abort("pthread rwlock failed to initialize");
+	}
+
 	self->server = server;
 
+	self->config.cache.chunks.memory      = 256;
+	self->config.cache.chunks.compression = Z_DEFAULT_COMPRESSION;
+	self->config.cache.chunks.hugepages   = false;
+
+	self->config.cache.tracking.near.distance   = 24;
+	self->config.cache.tracking.near.period     = 1;
+	self->config.cache.tracking.middle.distance = 64;
+	self->config.cache.tracking.middle.period   = 4;
+	self->config.cache.tracking.far.period      = 20;
+
 	C_FOREACH(world, C_PATH(server->config, "server.game.protocol.worlds")) {
 		 if (CD_CStringIsEqual(name, C_STRING(C_GET(world, "name")))) {
 			config_export(world, &self->config.data);
+
+			C_IN(chunks, world, "chunks") {
+				C_SAVE(C_GET(chunks, "memory"),      C_INT, self->config.cache.chunks.memory);
+				C_SAVE(C_GET(chunks, "compression"), C_INT, self->config.cache.chunks.compression);
+				C_SAVE(C_GET(chunks, "hugepages"),   C_BOOL, self->config.cache.chunks.hugepages);
+			}
+
+			C_IN(tracking, world, "tracking") {
+				C_IN(near, tracking, "near") {
+					C_SAVE(C_GET(near, "distance"), C_INT, self->config.cache.tracking.near.distance);
+					C_SAVE(C_GET(near, "period"),   C_INT, self->config.cache.tracking.near.period);
+				}
+
+				C_IN(middle, tracking, "middle") {
+					C_SAVE(C_GET(middle, "distance"), C_INT, self->config.cache.tracking.middle.distance);
+					C_SAVE(C_GET(middle, "period"),   C_INT, self->config.cache.tracking.middle.period);
+				}
+
+				C_IN(far, tracking, "far") {
+					C_SAVE(C_GET(far, "period"), C_INT, self->config.cache.tracking.far.period);
+				}
+			}
+
 			break;
 		}
 	}
 
+	// zlib refuses other levels, every chunk send would fail
+	if (self->config.cache.chunks.compression < Z_DEFAULT_COMPRESSION || self->config.cache.chunks.compression > Z_BEST_COMPRESSION) {
+		SERR(server, "world %s: chunks.compression %d isn't a zlib level (-1 to 9), using the default",
+			name, self->config.cache.chunks.compression);
+
+		self->config.cache.chunks.compression = Z_DEFAULT_COMPRESSION;
+	}
+
+	if (self->config.cache.chunks.memory < 0) {
+		SERR(server, "world %s: chunks.memory %d is negative, using 256",
+			name, self->config.cache.chunks.memory);
+
+		self->config.cache.chunks.memory = 256;
+	}
+
+	// a period is at least a tick
+	if (self->config.cache.tracking.near.period < 1) {
+		self->config.cache.tracking.near.period = 1;
+	}
+
+	if (self->config.cache.tracking.middle.period < 1) {
+		self->config.cache.tracking.middle.period = 1;
+	}
+
+	if (self->config.cache.tracking.far.period < 1) {
+		self->config.cache.tracking.far.period = 1;
+	}
+
 	self->name       = CD_CreateStringFromCStringCopy(name);
 	self->dimension  = SVWorldSkylands;
         self->mode       = SVModeCreative;
@@ -54,7 +198,29 @@ SV_CreateWorld (CDServer* server, const char* name)
 	self->players  = CD_CreateHash();
 	self->entities = CD_CreateMap();
 
-	self->chunks = CD_CreateSetWith(2000, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition);
+	self->grid.cells = CD_CreateMap();
+
+	// the memory limit is in megabytes of packed chunks
+	self->chunks.entries     = CD_CreateMap();
+	self->chunks.unused.head = NULL;
+	self->chunks.unused.tail = NULL;
+	self->chunks.length      = 0;
+	self->chunks.memory      = 0;
+	self->chunks.changed     = NULL;
+	self->chunks.dirty       = NULL;
+	self->chunks.limit       = (size_t) self->config.cache.chunks.memory * 1024 * 1024;
+
+	self->chunks.slabs.chunks  = CD_CreateSlabPool(sizeof(SVChunk), self->config.cache.chunks.hugepages);
+	self->chunks.slabs.buffers = CD_CreateSlabPool(SV_ChunkCompressBound(), self->config.cache.chunks.hugepages);
+
+	self->chunks.stats.hits      = 0;
+	self->chunks.stats.misses    = 0;
+	self->chunks.stats.evictions = 0;
+
+	self->chunks.stats.compressions = 0;
+	self->chunks.stats.changes      = 0;
+	self->chunks.stats.resends      = 0;
+	self->chunks.stats.saves        = 0;
 
 	self->lastGeneratedEntityId = 0;
 
@@ -71,6 +237,8 @@ SV_WorldSave (SVWorld* self)
 {
 	bool status;
 
+	SV_WorldSaveChunks(self);
+
 	CD_EventDispatchWithError(status, self->server, "World.save", self);
 
 	return status == CDOk;
@@ -81,12 +249,15 @@ SV_DestroyWorld (SVWorld* self)
 {
 	assert(self);
 
+	// what changed since the last save would be lost with the cache
+	SV_WorldSaveChunks(self);
+
 	CD_EventDispatch(self->server, "World.destroy", self);
 
 	CD_HASH_FOREACH(self->players, it) {
 		SVPlayer* player = (SVPlayer*) CD_HashIteratorValue(it);
 
-		if (player->client->status != CDClientDisconnect) {
+		if (CD_ClientGetStatus(player->client) != CDClientDisconnect) {
 			CD_ServerKick(self->server, player->client, NULL);
 		}
 	}
@@ -94,7 +265,58 @@ SV_DestroyWorld (SVWorld* self)
 	CD_DestroyHash(self->players);
 	CD_DestroyMap(self->entities);
 
-	CD_DestroySet(self->chunks);
+	CD_MAP_FOREACH(self->grid.cells, it) {
+		SVWorldCell* cell = (SVWorldCell*) CD_MapIteratorValue(it);
+
+		CD_free(cell->item);
+		CD_free(cell);
+	}
+
+	CD_DestroyMap(self->grid.cells);
+
+	pthread_rwlock_destroy(&self->grid.lock);
+
+	SDEBUG(self->server, "%s: chunk cache %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions, %" PRIu64 " compressions",
+		CD_StringContent(self->name), self->chunks.stats.hits, self->chunks.stats.misses, self->chunks.stats.evictions,
+		self->chunks.stats.compressions);
+
+	SDEBUG(self->server, "%s: %" PRIu64 " block changes, %" PRIu64 " chunks sent again, %" PRIu64 " saved",
+		CD_StringContent(self->name), self->chunks.stats.changes, self->chunks.stats.resends, self->chunks.stats.saves);
+
+	SDEBUG(self->server, "%s: %zu chunks cached in %zu bytes, %zu bytes each expanded",
+		CD_StringContent(self->name), self->chunks.length, self->chunks.memory, sizeof(SVChunk));
+
+	SDEBUG(self->server, "%s: %zu chunk slabs live, %zu cached, %zu buffer slabs live, %zu cached",
+		CD_StringContent(self->name), self->chunks.slabs.chunks->stats.live, self->chunks.slabs.chunks->stats.cached,
+		self->chunks.slabs.buffers->stats.live, self->chunks.slabs.buffers->stats.cached);
+
+	CD_MAP_FOREACH(self->chunks.entries, it) {
+		SVWorldChunk* entry = (SVWorldChunk*) CD_MapIteratorValue(it);
+
+		if (entry->chunk) {
+			SV_DestroyPackedChunk(entry->chunk);
+		}
+
+		if (entry->packet) {
+			CD_DestroySharedBuffer(entry->packet);
+		}
+
+		if (entry->subscribers.item) {
+			CD_free(entry->subscribers.item);
+		}
+
+		pthread_rwlock_destroy(&entry->lock);
+
+		CD_free(entry);
+	}
+
+	CD_DestroyMap(self->chunks.entries);
+
+	CD_DestroySlabPool(self->chunks.slabs.chunks);
+	CD_DestroySlabPool(self->chunks.slabs.buffers);
+
+	pthread_cond_destroy(&self->chunks.loaded);
+	pthread_mutex_destroy(&self->chunks.lock);
 
 	CD_DestroyString(self->name);
 
@@ -169,7 +391,8 @@ SV_WorldAddPlayer (SVWorld* self, SVPlayer* player)
 
 	CD_HashPut(self->players, CD_StringContent(player->username),
 				(CDPointer) player);
-	CD_MapPut(self->entities, player->entity.id, (CDPointer) player);
+
+	SV_WorldAddEntity(self, &player->entity);
 
 	done: {
 		return ret;
@@ -184,7 +407,135 @@ SV_WorldRemovePlayer (SVWorld* self, SVPlayer* player)
 	assert(player->world == self);
 
 	CD_HashDelete(player->world->players, CD_StringContent(player->username));
-	CD_MapDelete(player->world->entities, player->entity.id);
+
+	SV_WorldRemoveEntity(self, &player->entity);
+}
+
+void
+SV_WorldAddEntity (SVWorld* self, SVEntity* entity)
+{
+	assert(self);
+	assert(entity);
+
+	CD_MapPut(self->entities, entity->id, (CDPointer) entity);
+
+	pthread_rwlock_wrlock(&self->grid.lock);
+	sv_WorldCellAdd(self, entity);
+	pthread_rwlock_unlock(&self->grid.lock);
+}
+
+void
+SV_WorldRemoveEntity (SVWorld* self, SVEntity* entity)
+{
+	assert(self);
+	assert(entity);
+
+	pthread_rwlock_wrlock(&self->grid.lock);
+	sv_WorldCellRemove(self, entity);
+	pthread_rwlock_unlock(&self->grid.lock);
+
+	CD_MapDelete(self->entities, entity->id);
+}
+
+void
+SV_WorldMoveEntity (SVWorld* self, SVEntity* entity, SVPrecisePosition position)
+{
+	assert(self);
+	assert(entity);
+
+	SVChunkPosition from = SV_PrecisePositionToChunkPosition(entity->position);
+	SVChunkPosition to   = SV_PrecisePositionToChunkPosition(position);
+
+	// most moves stay in the same chunk and don't touch the index
+	if (SV_ChunkPositionEqual(from, to)) {
+		entity->position = position;
+
+		return;
+	}
+
+	pthread_rwlock_wrlock(&self->grid.lock);
+	sv_WorldCellRemove(self, entity);
+	entity->position = position;
+	sv_WorldCellAdd(self, entity);
+	pthread_rwlock_unlock(&self->grid.lock);
+}
+
+void
+SV_WorldForEachInChunks (SVWorld* self, SVChunkPosition center, int radius, SVWorldEntityCallback callback, CDPointer context)
+{
+	assert(self);
+	assert(callback);
+	assert(radius >= 0);
+
+	pthread_rwlock_rdlock(&self->grid.lock);
+
+	// with few occupied chunks it's cheaper to go through them than through the area
+	if ((size_t) (2 * radius + 1) * (2 * radius + 1) > CD_MapLength(self->grid.cells)) {
+		CD_MAP_FOREACH(self->grid.cells, it) {
+			SVWorldCell* cell = (SVWorldCell*) CD_MapIteratorValue(it);
+
+			if (SV_IsCoordInRadius(&cell->position, &center, radius)) {
+				for (size_t i = 0; i < cell->length; i++) {
+					callback(self, cell->item[i], context);
+				}
+			}
+		}
+	}
+	else {
+		for (int x = center.x - radius; x <= center.x + radius; x++) {
+			for (int z = center.z - radius; z <= center.z + radius; z++) {
+				SVWorldCell* cell = (SVWorldCell*) CD_MapGet(self->grid.cells, sv_ChunkId(x, z));
+
+				if (!cell) {
+					continue;
+				}
+
+				for (size_t i = 0; i < cell->length; i++) {
+					callback(self, cell->item[i], context);
+				}
+			}
+		}
+	}
+
+	pthread_rwlock_unlock(&self->grid.lock);
+}
+
+typedef struct _SVWorldQuery {
+	SVPrecisePosition center;
+	double            radius;
+	CDList*           result;
+} SVWorldQuery;
+
+static
+void
+sv_WorldQueryRadiusCollect (SVWorld* self, SVEntity* entity, SVWorldQuery* query)
+{
+	double dx = entity->position.x - query->center.x;
+	double dy = entity->position.y - query->center.y;
+	double dz = entity->position.z - query->center.z;
+
+	if (dx * dx + dy * dy + dz * dz <= query->radius * query->radius) {
+		CD_ListPush(query->result, (CDPointer) entity);
+	}
+}
+
+CDList*
+SV_WorldQueryRadius (SVWorld* self, SVPrecisePosition center, double radius)
+{
+	SVWorldQuery query = {
+		.center = center,
+		.radius = radius,
+		.result = CD_CreateList()
+	};
+
+	assert(self);
+	assert(radius >= 0);
+
+	// a chunk is 16 blocks wide, the radius can reach into the neighbouring ones
+	SV_WorldForEachInChunks(self, SV_PrecisePositionToChunkPosition(center), (int) (radius / 16) + 1,
+		(SVWorldEntityCallback) sv_WorldQueryRadiusCollect, (CDPointer) &query);
+
+	return query.result;
 }
 
 void
@@ -192,15 +543,18 @@ SV_WorldBroadcastBuffer (SVWorld* self, CDBuffer* buffer)
 {
 	assert(self);
 
+	// every client references the same payload, it's freed when the last output drains
+	CDSharedBuffer* shared = CD_CreateSharedBuffer(buffer);
+
 	CD_HASH_FOREACH(self->players, it) {
 		SVPlayer* player = (SVPlayer*) CD_HashIteratorValue(it);
 
-		pthread_rwlock_rdlock(&player->client->lock.status);
-		if (player->client->status != CDClientDisconnect) {
-			CD_ClientSendBuffer(player->client, buffer);
+		if (CD_ClientGetStatus(player->client) != CDClientDisconnect) {
+			CD_ClientSendSharedBuffer(player->client, shared);
 		}
-		pthread_rwlock_unlock(&player->client->lock.status);
 	}
+
+	CD_DestroySharedBuffer(shared);
 }
 
 void
@@ -259,28 +613,839 @@ SV_WorldSetTime (SVWorld* self, uint16_t time)
 	return time;
 }
 
-SVChunk*
-SV_WorldGetChunk (SVWorld* self, int x, int z)
+static
+void
+sv_WorldUnusedRemove (SVWorld* self, SVWorldChunk* entry)
 {
-	SVChunk* result = CD_alloc(sizeof(SVChunk));
-	CDError  status;
+	if (entry->previous) {
+		entry->previous->next = entry->next;
+	}
+	else {
+		self->chunks.unused.head = entry->next;
+	}
 
-	CD_EventDispatchWithError(status, self->server, "World.chunk", self, x, z, result);
+	if (entry->next) {
+		entry->next->previous = entry->previous;
+	}
+	else {
+		self->chunks.unused.tail = entry->previous;
+	}
 
-	if (status == CDOk) {
-		return result;
+	entry->previous = entry->next = NULL;
+}
+
+static
+void
+sv_WorldUnusedPush (SVWorld* self, SVWorldChunk* entry)
+{
+	entry->previous = NULL;
+	entry->next     = self->chunks.unused.head;
+
+	if (self->chunks.unused.head) {
+		self->chunks.unused.head->previous = entry;
+	}
+	else {
+		self->chunks.unused.tail = entry;
+	}
+
+	self->chunks.unused.head = entry;
+}
+
+static
+void
+sv_WorldDeleteChunk (SVWorld* self, SVWorldChunk* entry)
+{
+	CD_MapDelete(self->chunks.entries, sv_ChunkId(entry->position.x, entry->position.z));
+	self->chunks.length--;
+	self->chunks.memory -= entry->size;
+
+	if (entry->chunk) {
+		SV_DestroyPackedChunk(entry->chunk);
+	}
+
+	if (entry->packet) {
+		CD_DestroySharedBuffer(entry->packet);
+	}
+
+	if (entry->subscribers.item) {
+		CD_free(entry->subscribers.item);
+	}
+
+	pthread_rwlock_destroy(&entry->lock);
+
+	CD_free(entry);
+}
+
+/**
+ * Evict the least recently used unreferenced chunks until the cache fits,
+ * must be called with the chunks lock held.
+ */
+static
+void
+sv_WorldEvictChunks (SVWorld* self)
+{
+	while (self->chunks.memory > self->chunks.limit && self->chunks.unused.tail) {
+		SVWorldChunk* entry = self->chunks.unused.tail;
+
+		sv_WorldUnusedRemove(self, entry);
+		sv_WorldDeleteChunk(self, entry);
+
+		self->chunks.stats.evictions++;
+	}
+}
+
+/**
+ * Drop a reference, failed loads are forgotten as soon as nobody waits on
+ * them. Must be called with the chunks lock held.
+ */
+static
+void
+sv_WorldUnreferenceChunk (SVWorld* self, SVWorldChunk* entry)
+{
+	if (--entry->references > 0) {
+		return;
+	}
+
+	if (entry->chunk) {
+		sv_WorldUnusedPush(self, entry);
+		sv_WorldEvictChunks(self);
 	}
 	else {
-		CD_free(result);
+		sv_WorldDeleteChunk(self, entry);
+	}
+}
+
+/**
+ * Reference the cache entry of a chunk, loading the chunk on a miss
+ *
+ * @return The entry or NULL if the chunk couldn't be loaded, errno is set
+ */
+static
+SVWorldChunk*
+sv_WorldReferenceChunk (SVWorld* self, int x, int z)
+{
+	SVWorldChunk*  entry;
+	SVChunk*       chunk;
+	SVPackedChunk* packed = NULL;
+	CDError        status;
+
+	pthread_mutex_lock(&self->chunks.lock);
+
+	entry = (SVWorldChunk*) CD_MapGet(self->chunks.entries, sv_ChunkId(x, z));
+
+	if (entry) {
+		self->chunks.stats.hits++;
+
+		if (entry->references++ == 0 && !entry->loading) {
+			sv_WorldUnusedRemove(self, entry);
+		}
+
+		while (entry->loading) {
+			pthread_cond_wait(&self->chunks.loaded, &self->chunks.lock);
+		}
+
+		if (entry->chunk == NULL) {
+			sv_WorldUnreferenceChunk(self, entry);
+			entry = NULL;
+			errno = ENOENT;
+		}
+
+		pthread_mutex_unlock(&self->chunks.lock);
+
+		return entry;
+	}
+
+	self->chunks.stats.misses++;
+
+	entry = CD_malloc(sizeof(SVWorldChunk));
+	entry->position.x = x;
+	entry->position.z = z;
+	entry->chunk      = NULL;
+	entry->size       = 0;
+	entry->packet     = NULL;
+	entry->version    = 0;
+	entry->references = 1;
+	entry->loading    = true;
+	entry->previous   = NULL;
+	entry->next       = NULL;
+
+	if (pthread_rwlock_init(&entry->lock, NULL) != 0) {
+		CD_abort("pthread rwlock failed to initialize");
+	}
+
+	entry->changes.length   = 0;
+	entry->changes.overflow = false;
+	entry->changes.queued   = false;
+	entry->changes.next     = NULL;
 
+	entry->dirty.queued = false;
+	entry->dirty.next   = NULL;
+
+	entry->subscribers.item   = NULL;
+	entry->subscribers.length = 0;
+	entry->subscribers.size   = 0;
+
+	CD_MapPut(self->chunks.entries, sv_ChunkId(x, z), (CDPointer) entry);
+	self->chunks.length++;
+
+	// load outside the lock, others asking for this chunk wait on the entry
+	pthread_mutex_unlock(&self->chunks.lock);
+
+	chunk = CD_SlabAlloc(self->chunks.slabs.chunks);
+	memset(chunk, 0, sizeof(SVChunk));
+
+	CD_EventDispatchWithError(status, self->server, "World.chunk", self, x, z, chunk);
+
+	// only the packed chunk stays in memory
+	if (status == CDOk) {
+		chunk->position = entry->position;
+		packed          = SV_CreatePackedChunk(chunk);
+	}
+
+	CD_SlabFree(self->chunks.slabs.chunks, chunk);
+
+	pthread_mutex_lock(&self->chunks.lock);
+
+	entry->chunk   = packed;
+	entry->loading = false;
+
+	pthread_cond_broadcast(&self->chunks.loaded);
+
+	if (packed) {
+		entry->size          = SV_PackedChunkSize(packed);
+		self->chunks.memory += entry->size;
+
+		sv_WorldEvictChunks(self);
+	}
+	else {
+		sv_WorldUnreferenceChunk(self, entry);
+		entry = NULL;
 		errno = CD_ErrorToErrno(status);
+	}
+
+	pthread_mutex_unlock(&self->chunks.lock);
+
+	return entry;
+}
+
+/**
+ * Reference a chunk and take its lock for the access
+ */
+static
+SVWorldChunk*
+sv_WorldAcquireEntry (SVWorld* self, int x, int z, SVChunkAccess access)
+{
+	SVWorldChunk* entry = sv_WorldReferenceChunk(self, x, z);
+
+	// the reference keeps the entry around while waiting on the lock
+	if (entry && access == SVChunkRead) {
+		pthread_rwlock_rdlock(&entry->lock);
+	}
+	else if (entry && access == SVChunkWrite) {
+		pthread_rwlock_wrlock(&entry->lock);
+	}
+
+	return entry;
+}
+
+/**
+ * Unlock and unreference a chunk, must be called with the chunks lock held
+ */
+static
+void
+sv_WorldReleaseEntry (SVWorld* self, SVWorldChunk* entry, SVChunkAccess access)
+{
+	if (access != SVChunkReference) {
+		pthread_rwlock_unlock(&entry->lock);
+	}
+
+	sv_WorldUnreferenceChunk(self, entry);
+}
+
+SVWorldChunk*
+SV_WorldAcquireChunk (SVWorld* self, int x, int z, SVChunkAccess access)
+{
+	assert(self);
+
+	return sv_WorldAcquireEntry(self, x, z, access);
+}
+
+void
+SV_WorldReleaseChunk (SVWorld* self, SVWorldChunk* chunk, SVChunkAccess access)
+{
+	assert(self);
+	assert(chunk);
+
+	pthread_mutex_lock(&self->chunks.lock);
+
+	assert(chunk->references > 0);
 
+	sv_WorldReleaseEntry(self, chunk, access);
+
+	pthread_mutex_unlock(&self->chunks.lock);
+}
+
+/**
+ * Compress a chunk into a MapChunk packet, it's expanded for the time of the compression
+ */
+static
+CDSharedBuffer*
+sv_WorldCompressChunk (SVWorld* self, SVPackedChunk* packed)
+{
+	size_t          length = SV_ChunkCompressBound();
+	uint8_t*        buffer = CD_SlabAlloc(self->chunks.slabs.buffers);
+	SVChunk*        chunk  = CD_SlabAlloc(self->chunks.slabs.chunks);
+	CDSharedBuffer* result = NULL;
+
+	SV_PackedChunkExpand(packed, chunk);
+
+	if ((length = SV_ChunkCompress(chunk, self->config.cache.chunks.compression, buffer, length)) == 0) {
+		SERR(self->server, "zlib compress failure");
+
+		goto done;
+	}
+
+	SDEBUG(self->server, "compressed chunk (%d, %d) to %zu bytes", chunk->position.x, chunk->position.z, length);
+
+	SVPacketMapChunk pkt = {
+		.response = {
+			.position = SV_ChunkPositionToBlockPosition(chunk->position),
+
+			.size = {
+				.x = 16,
+				.y = 128,
+				.z = 16
+			},
+
+			.length = length,
+			.item   = (SVByte*) buffer
+		}
+	};
+
+	SVPacket packet = { SVResponse, SVMapChunk, (CDPointer) &pkt };
+
+	result = SV_PacketToSharedBuffer(&packet);
+
+	done: {
+		CD_SlabFree(self->chunks.slabs.buffers, buffer);
+		CD_SlabFree(self->chunks.slabs.chunks, chunk);
+
+		return result;
+	}
+}
+
+CDSharedBuffer*
+SV_WorldGetChunkPacket (SVWorld* self, SVWorldChunk* chunk)
+{
+	CDSharedBuffer* result = NULL;
+	unsigned int    version;
+
+	assert(self);
+	assert(chunk);
+
+	pthread_mutex_lock(&self->chunks.lock);
+
+	if (chunk->packet) {
+		result = CD_ReferenceSharedBuffer(chunk->packet);
+	}
+
+	version = chunk->version;
+
+	pthread_mutex_unlock(&self->chunks.lock);
+
+	if (result) {
+		return result;
+	}
+
+	// compress outside the chunks lock, if two sends race the first one gets cached
+	pthread_rwlock_rdlock(&chunk->lock);
+	result = sv_WorldCompressChunk(self, chunk->chunk);
+	pthread_rwlock_unlock(&chunk->lock);
+
+	if (!result) {
 		return NULL;
 	}
+
+	pthread_mutex_lock(&self->chunks.lock);
+
+	self->chunks.stats.compressions++;
+
+	// a change while compressing bumped the version, the packet is already stale
+	if (!chunk->packet && chunk->version == version) {
+		chunk->packet = CD_ReferenceSharedBuffer(result);
+	}
+
+	pthread_mutex_unlock(&self->chunks.lock);
+
+	return result;
 }
 
 void
 SV_WorldSetChunk (SVWorld* self, SVChunk* chunk)
 {
+	SVWorldChunk* entry;
+	bool          cached;
+
+	assert(self);
+	assert(chunk);
+
+	pthread_mutex_lock(&self->chunks.lock);
+
+	entry  = (SVWorldChunk*) CD_MapGet(self->chunks.entries, sv_ChunkId(chunk->position.x, chunk->position.z));
+	cached = entry && entry->chunk;
+
+	pthread_mutex_unlock(&self->chunks.lock);
+
+	// keep the cached copy in sync, packing it before taking the lock
+	if (cached) {
+		SVPackedChunk* packed = SV_CreatePackedChunk(chunk);
+
+		if ((entry = sv_WorldAcquireEntry(self, chunk->position.x, chunk->position.z, SVChunkWrite))) {
+			// repacked in place, whoever holds the entry keeps reading the same chunk
+			SV_PackedChunkReplace(entry->chunk, packed);
+			packed = NULL;
+
+			pthread_mutex_lock(&self->chunks.lock);
+
+			if (entry->packet) {
+				CD_DestroySharedBuffer(entry->packet);
+				entry->packet = NULL;
+			}
+
+			entry->version++;
+
+			self->chunks.memory -= entry->size;
+			entry->size          = SV_PackedChunkSize(entry->chunk);
+			self->chunks.memory += entry->size;
+
+			sv_WorldReleaseEntry(self, entry, SVChunkWrite);
+
+			pthread_mutex_unlock(&self->chunks.lock);
+		}
+
+		if (packed) {
+			SV_DestroyPackedChunk(packed);
+		}
+	}
+
 	CD_EventDispatch(self->server, "World.chunk=", self, chunk->position.x, chunk->position.z, chunk);
 }
+
+/**
+ * Index of a block in the chunk arrays
+ */
+static inline
+size_t
+sv_BlockIndex (SVBlockPosition position)
+{
+	return position.y + 128 * ((position.z & 15) + 16 * (position.x & 15));
+}
+
+/**
+ * Position in the chunk of a block index
+ */
+static inline
+SVBlockPosition
+sv_BlockIndexPosition (size_t index)
+{
+	return (SVBlockPosition) {
+		.x = index >> 11,
+		.y = index & 127,
+		.z = (index >> 7) & 15
+	};
+}
+
+bool
+SV_WorldGetBlock (SVWorld* self, SVBlockPosition position, SVWorldBlock* result)
+{
+	SVChunkPosition chunkPosition = SV_BlockPositionToChunkPosition(position);
+	SVWorldChunk*   chunk;
+
+	assert(self);
+	assert(result);
+
+	if (position.y < 0) {
+		errno = EINVAL;
+
+		return false;
+	}
+
+	if (!(chunk = SV_WorldAcquireChunk(self, chunkPosition.x, chunkPosition.z, SVChunkRead))) {
+		return false;
+	}
+
+	result->position = position;
+
+	SV_PackedChunkGetBlock(chunk->chunk, position, &result->type, &result->metadata);
+
+	SV_WorldReleaseChunk(self, chunk, SVChunkRead);
+
+	return true;
+}
+
+/**
+ * Change a block and remember it for the next flush, must be called with the
+ * chunk write locked.
+ *
+ * @return true if the block actually changed
+ */
+static
+bool
+sv_WorldChangeBlock (SVWorldChunk* entry, SVWorldBlock* block)
+{
+	size_t index = sv_BlockIndex(block->position);
+
+	if (!SV_PackedChunkSetBlock(entry->chunk, block->position, block->type, block->metadata)) {
+		return false;
+	}
+
+	if (entry->changes.overflow) {
+		return true;
+	}
+
+	for (size_t i = 0; i < entry->changes.length; i++) {
+		if (entry->changes.item[i] == index) {
+			return true;
+		}
+	}
+
+	if (entry->changes.length == SV_WORLD_CHUNK_CHANGES) {
+		entry->changes.overflow = true;
+	}
+	else {
+		entry->changes.item[entry->changes.length++] = index;
+	}
+
+	return true;
+}
+
+/**
+ * Release a chunk written by SV_WorldSetBlocks, when anything changed the
+ * cached packet goes away and the first change keeps the chunk referenced
+ * until the next flush, and until the next save.
+ */
+static
+void
+sv_WorldCommitChanges (SVWorld* self, SVWorldChunk* entry, size_t changed)
+{
+	// a palette can grow with a change, never shrink
+	size_t size = changed > 0 ? SV_PackedChunkSize(entry->chunk) : entry->size;
+
+	pthread_mutex_lock(&self->chunks.lock);
+
+	if (changed > 0) {
+		self->chunks.memory += size - entry->size;
+		entry->size          = size;
+
+		if (entry->packet) {
+			CD_DestroySharedBuffer(entry->packet);
+			entry->packet = NULL;
+		}
+
+		entry->version++;
+
+		self->chunks.stats.changes += changed;
+
+		if (!entry->changes.queued) {
+			entry->references++;
+
+			entry->changes.queued = true;
+			entry->changes.next   = self->chunks.changed;
+			self->chunks.changed  = entry;
+		}
+
+		if (!entry->dirty.queued) {
+			entry->references++;
+
+			entry->dirty.queued = true;
+			entry->dirty.next   = self->chunks.dirty;
+			self->chunks.dirty  = entry;
+		}
+	}
+
+	sv_WorldReleaseEntry(self, entry, SVChunkWrite);
+
+	pthread_mutex_unlock(&self->chunks.lock);
+}
+
+bool
+SV_WorldSetBlock (SVWorld* self, SVBlockPosition position, uint8_t type, uint8_t metadata)
+{
+	SVWorldBlock block = { position, type, metadata };
+
+	return SV_WorldSetBlocks(self, &block, 1);
+}
+
+bool
+SV_WorldSetBlocks (SVWorld* self, SVWorldBlock* blocks, size_t length)
+{
+	SVWorldChunk*   entry   = NULL;
+	SVChunkPosition current = { 0, 0 };
+	size_t          changed = 0;
+	bool            result  = true;
+
+	assert(self);
+	assert(blocks || length == 0);
+
+	for (size_t i = 0; i < length; i++) {
+		SVChunkPosition position = SV_BlockPositionToChunkPosition(blocks[i].position);
+
+		if (blocks[i].position.y < 0) {
+			errno  = EINVAL;
+			result = false;
+
+			continue;
+		}
+
+		// runs of blocks in the same chunk are written under a single lock
+		if (!entry || !SV_ChunkPositionEqual(position, current)) {
+			if (entry) {
+				sv_WorldCommitChanges(self, entry, changed);
+			}
+
+			current = position;
+			changed = 0;
+
+			if (!(entry = sv_WorldAcquireEntry(self, current.x, current.z, SVChunkWrite))) {
+				result = false;
+
+				continue;
+			}
+		}
+
+		if (sv_WorldChangeBlock(entry, &blocks[i])) {
+			changed++;
+		}
+	}
+
+	if (entry) {
+		sv_WorldCommitChanges(self, entry, changed);
+	}
+
+	return result;
+}
+
+void
+SV_WorldFlushChanges (SVWorld* self, SVWorldChangesCallback callback, CDPointer context)
+{
+	SVWorldChunk* entry;
+	SVWorldChunk* next;
+
+	assert(self);
+
+	pthread_mutex_lock(&self->chunks.lock);
+	next                 = self->chunks.changed;
+	self->chunks.changed = NULL;
+	pthread_mutex_unlock(&self->chunks.lock);
+
+	while ((entry = next)) {
+		SVShort         coordinate[SV_WORLD_CHUNK_CHANGES];
+		SVByte          type[SV_WORLD_CHUNK_CHANGES];
+		SVByte          metadata[SV_WORLD_CHUNK_CHANGES];
+		size_t          length;
+		bool            overflow;
+		CDSharedBuffer* packet = NULL;
+
+		// snapshot the changes, a change from now on queues the chunk again
+		pthread_rwlock_wrlock(&entry->lock);
+		pthread_mutex_lock(&self->chunks.lock);
+
+		next = entry->changes.next;
+
+		entry->changes.queued = false;
+		entry->changes.next   = NULL;
+
+		if (entry->changes.overflow) {
+			self->chunks.stats.resends++;
+		}
+
+		pthread_mutex_unlock(&self->chunks.lock);
+
+		length   = entry->changes.length;
+		overflow = entry->changes.overflow;
+
+		if (!overflow) {
+			for (size_t i = 0; i < length; i++) {
+				SVBlockPosition position = sv_BlockIndexPosition(entry->changes.item[i]);
+				uint8_t         blockType;
+				uint8_t         blockMetadata;
+
+				SV_PackedChunkGetBlock(entry->chunk, position, &blockType, &blockMetadata);
+
+				// the packet carries the coordinates as x << 12 | z << 8 | y, big endian
+				coordinate[i] = htons((position.x << 12) | (position.z << 8) | position.y);
+				type[i]       = blockType;
+				metadata[i]   = blockMetadata;
+			}
+		}
+
+		entry->changes.length   = 0;
+		entry->changes.overflow = false;
+
+		pthread_rwlock_unlock(&entry->lock);
+
+		if (overflow) {
+			packet = SV_WorldGetChunkPacket(self, entry);
+		}
+		else if (length > 0) {
+			SVPacketMultiBlockChange pkt = {
+				.response = {
+					.position = entry->position,
+					.length   = length,
+
+					.coordinate = coordinate,
+					.type       = type,
+					.metadata   = metadata
+				}
+			};
+
+			SVPacket multi = { SVResponse, SVMultiBlockChange, (CDPointer) &pkt };
+
+			packet = SV_PacketToSharedBuffer(&multi);
+		}
+
+		if (packet) {
+			callback(self, entry->position, packet, context);
+
+			CD_DestroySharedBuffer(packet);
+		}
+
+		pthread_mutex_lock(&self->chunks.lock);
+		sv_WorldUnreferenceChunk(self, entry);
+		pthread_mutex_unlock(&self->chunks.lock);
+	}
+}
+
+void
+SV_WorldSaveChunks (SVWorld* self)
+{
+	SVWorldChunk* entry;
+	SVWorldChunk* next;
+	SVChunk*      chunk = NULL;
+
+	assert(self);
+
+	pthread_mutex_lock(&self->chunks.lock);
+	next               = self->chunks.dirty;
+	self->chunks.dirty = NULL;
+	pthread_mutex_unlock(&self->chunks.lock);
+
+	while ((entry = next)) {
+		// dequeue before expanding, a change from now on queues the chunk again
+		pthread_mutex_lock(&self->chunks.lock);
+
+		next = entry->dirty.next;
+
+		entry->dirty.queued = false;
+		entry->dirty.next   = NULL;
+
+		self->chunks.stats.saves++;
+
+		pthread_mutex_unlock(&self->chunks.lock);
+
+		// persistence gets the chunk expanded, in one buffer for the whole save
+		if (!chunk) {
+			chunk = CD_SlabAlloc(self->chunks.slabs.chunks);
+		}
+
+		pthread_rwlock_rdlock(&entry->lock);
+		SV_PackedChunkExpand(entry->chunk, chunk);
+		pthread_rwlock_unlock(&entry->lock);
+
+		CD_EventDispatch(self->server, "World.chunk=", self, entry->position.x, entry->position.z, chunk);
+
+		pthread_mutex_lock(&self->chunks.lock);
+		sv_WorldUnreferenceChunk(self, entry);
+		pthread_mutex_unlock(&self->chunks.lock);
+	}
+
+	if (chunk) {
+		CD_SlabFree(self->chunks.slabs.chunks, chunk);
+	}
+}
+
+void
+SV_WorldSubscribeChunk (SVWorld* self, SVChunkPosition position, SVPlayer* player)
+{
+	SVWorldChunk* entry;
+
+	assert(self);
+	assert(player);
+
+	pthread_mutex_lock(&self->chunks.lock);
+
+	if ((entry = (SVWorldChunk*) CD_MapGet(self->chunks.entries, sv_ChunkId(position.x, position.z)))) {
+		if (entry->subscribers.length == entry->subscribers.size) {
+			entry->subscribers.size = entry->subscribers.size ? entry->subscribers.size * 2 : 4;
+			entry->subscribers.item = CD_realloc(entry->subscribers.item, entry->subscribers.size * sizeof(SVPlayer*));
+		}
+
+		entry->subscribers.item[entry->subscribers.length++] = player;
+	}
+
+	pthread_mutex_unlock(&self->chunks.lock);
+}
+
+void
+SV_WorldUnsubscribeChunk (SVWorld* self, SVChunkPosition position, SVPlayer* player)
+{
+	SVWorldChunk* entry;
+
+	assert(self);
+	assert(player);
+
+	pthread_mutex_lock(&self->chunks.lock);
+
+	if ((entry = (SVWorldChunk*) CD_MapGet(self->chunks.entries, sv_ChunkId(position.x, position.z)))) {
+		for (size_t i = 0; i < entry->subscribers.length; i++) {
+			if (entry->subscribers.item[i] == player) {
+				entry->subscribers.item[i] = entry->subscribers.item[--entry->subscribers.length];
+
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&self->chunks.lock);
+}
+
+void
+SV_ChunkBroadcastSharedBuffer (SVWorld* world, SVChunkPosition position, CDSharedBuffer* buffer)
+{
+	SVWorldChunk* entry;
+
+	assert(world);
+	assert(buffer);
+
+	// sending under the lock orders it against unsubscribing, a player that
+	// logged out may not have a client anymore once it's given back. The
+	// packet is encoded before, only appending the shared buffer happens here.
+	pthread_mutex_lock(&world->chunks.lock);
+
+	if ((entry = (SVWorldChunk*) CD_MapGet(world->chunks.entries, sv_ChunkId(position.x, position.z)))) {
+		for (size_t i = 0; i < entry->subscribers.length; i++) {
+			SVPlayer* player = entry->subscribers.item[i];
+
+			if (CD_ClientGetStatus(player->client) != CDClientDisconnect) {
+				CD_ClientSendSharedBuffer(player->client, buffer);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&world->chunks.lock);
+}
+
+void
+SV_ChunkBroadcastPacket (SVWorld* world, SVChunkPosition position, SVPacket* packet)
+{
+	CDSharedBuffer* buffer;
+
+	assert(world);
+	assert(packet);
+
+	if ((buffer = SV_PacketToSharedBuffer(packet))) {
+		SV_ChunkBroadcastSharedBuffer(world, position, buffer);
+
+		CD_DestroySharedBuffer(buffer);
+	}
+}
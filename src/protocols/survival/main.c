@@ -30,6 +30,8 @@ CD_InitializeSurvivalProtocol (CDServer* server)
 {
 	server->protocol = CD_CreateProtocol("survival", SV_PacketParsable, (CDProtocolPacketParse) SV_PacketFromBuffers);
 
+	SV_InitializeCharset();
+
 	CD_EventProvides(server, "Client.process",   CD_CreateEventParameters("CDClient", "SVPacket", NULL));
 	CD_EventProvides(server, "Client.processed", CD_CreateEventParameters("CDClient", "SVPacket", NULL));
 
@@ -27,6 +27,12 @@
 #include <craftd/protocols/survival/common.h>
 #undef CRAFTD_SURVIVAL_MINECRAFT_IGNORE_EXTERN
 
+#include <zlib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 const char* SVCharset =
 	" #$%&\"()*+,-./:;<=>!?@[\\]^_'{|}~⌂ªº¿®¬½¼¡«»£×ƒ"
 	"0123456789"
@@ -38,18 +44,132 @@ const char SVCharsetPixel[] = {
 	4, 5, 5, 5, 5, 4, 4, 4, 4, 5, 1, 5, 1, 5, 1, 1, 4, 5, 4, 1, 5, 6, 3, 5, 3, 5
 };
 
-const size_t SVCharsetLen = 143;
-const size_t SVCharsetOffset[] = {
-	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
-	21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 35, 37, 39, 41, 43, 45, 47,
-	49, 51, 53, 55, 57, 59, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73,
-	74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92,
-	93, 94, 95, 96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108,
-	109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123,
-	125, 127, 129, 131, 133, 135, 137, 139, 141, 143, 145, 147, 149, 151, 153,
-	155, 157, 159, 161, 163, 165, 167, 169, 171, 173, 175, 177, 179, 181, 183,
-	185, 187, 189, 191
-};
+/* One bit per BMP codepoint, set for the characters in SVCharset */
+static uint32_t       _charset[0x10000 / 32];
+static bool           _charsetSimple = false;
+static pthread_once_t _charsetOnce   = PTHREAD_ONCE_INIT;
+
+/* Every thread compressing chunks keeps its own deflate stream around */
+typedef struct _SVChunkDeflater {
+	z_stream stream;
+	int      level;
+} SVChunkDeflater;
+
+static pthread_key_t  _deflater;
+static pthread_once_t _deflaterOnce = PTHREAD_ONCE_INIT;
+
+/* U+00A7, the color code prefix */
+#define SV_SECTION_SIGN 0xA7
+
+/**
+ * Decode the UTF-8 character at the start of data, malformed sequences and characters
+ * outside the BMP decode to U+FFFD.
+ *
+ * @return The number of bytes the character takes
+ */
+static inline
+size_t
+sv_UTF8Next (const uint8_t* data, size_t size, uint32_t* ch)
+{
+	uint8_t lead = data[0];
+
+	if (lead < 0x80) {
+		*ch = lead;
+		return 1;
+	}
+
+	if ((lead & 0xE0) == 0xC0 && size >= 2 && (data[1] & 0xC0) == 0x80) {
+		*ch = ((lead & 0x1F) << 6) | (data[1] & 0x3F);
+		return 2;
+	}
+
+	if ((lead & 0xF0) == 0xE0 && size >= 3 && (data[1] & 0xC0) == 0x80 && (data[2] & 0xC0) == 0x80) {
+		*ch = ((lead & 0x0F) << 12) | ((data[1] & 0x3F) << 6) | (data[2] & 0x3F);
+		return 3;
+	}
+
+	*ch = 0xFFFD;
+
+	if ((lead & 0xF8) == 0xF0 && size >= 4 && (data[1] & 0xC0) == 0x80 && (data[2] & 0xC0) == 0x80 && (data[3] & 0xC0) == 0x80) {
+		return 4;
+	}
+
+	return 1;
+}
+
+static inline
+bool
+sv_CharsetHas (uint32_t ch)
+{
+	return ch < 0x10000 && (_charset[ch / 32] & (1U << (ch % 32)));
+}
+
+static
+void
+sv_BuildCharset (void)
+{
+	const uint8_t* data = (const uint8_t*) SVCharset;
+	size_t         size = strlen(SVCharset);
+
+	for (size_t offset = 0; offset < size;) {
+		uint32_t ch;
+
+		offset += sv_UTF8Next(data + offset, size - offset, &ch);
+
+		if (ch != 0xFFFD) {
+			_charset[ch / 32] |= 1U << (ch % 32);
+		}
+	}
+
+	// the SIMD path assumes the printable ASCII characters but ` are in the charset
+	_charsetSimple = true;
+
+	for (uint32_t ch = 0; ch < 0x80; ch++) {
+		if (sv_CharsetHas(ch) != (ch >= 0x20 && ch <= 0x7E && ch != '`')) {
+			_charsetSimple = false;
+		}
+	}
+}
+
+void
+SV_InitializeCharset (void)
+{
+	pthread_once(&_charsetOnce, sv_BuildCharset);
+}
+
+/**
+ * Get how many bytes at the start of data are ASCII characters in the charset
+ */
+static inline
+size_t
+sv_CharsetASCIIRun (const uint8_t* data, size_t size)
+{
+	size_t i = 0;
+
+	#ifdef __SSE2__
+	if (_charsetSimple) {
+		// signed compares, so bytes with the high bit set are below 0x20 as well
+		while (i + 16 <= size) {
+			__m128i chunk = _mm_loadu_si128((const __m128i*) (data + i));
+			__m128i bad   = _mm_or_si128(
+				_mm_or_si128(_mm_cmplt_epi8(chunk, _mm_set1_epi8(0x20)), _mm_cmpgt_epi8(chunk, _mm_set1_epi8(0x7E))),
+				_mm_cmpeq_epi8(chunk, _mm_set1_epi8('`')));
+
+			if (_mm_movemask_epi8(bad) != 0) {
+				break;
+			}
+
+			i += 16;
+		}
+	}
+	#endif
+
+	while (i < size && data[i] < 0x80 && sv_CharsetHas(data[i])) {
+		i++;
+	}
+
+	return i;
+}
 
 const SVEntityId SVMaxEntityId = INT_MAX;
 
@@ -88,7 +208,7 @@ SV_DestroyMetadata (SVMetadata* self)
 SVData*
 SV_CreateData (void)
 {
-	SVData* self = CD_malloc(sizeof(SVData));
+	SVData* self = CD_alloc(sizeof(SVData));
 
 	if (!self) {
 		return NULL;
@@ -128,71 +248,198 @@ SV_AppendData (SVMetadata* metadata, SVData* data)
 	return metadata;
 }
 
+size_t
+SV_MetadataSize (SVMetadata* self)
+{
+	// the terminator
+	size_t size = 1;
+
+	if (!self) {
+		return size;
+	}
+
+	for (size_t i = 0; i < self->length; i++) {
+		SVData* item = self->item[i];
+
+		size += SVByteSize;
+
+		switch (item->type) {
+			case SVTypeByte:           size += SVByteSize;                                 break;
+			case SVTypeShort:          size += SVShortSize;                                break;
+			case SVTypeInteger:        size += SVIntegerSize;                              break;
+			case SVTypeFloat:          size += SVFloatSize;                                break;
+			case SVTypeString:         size += SVShortSize + CD_StringSize(item->data.S);  break;
+			case SVTypeShortByteShort: size += SVShortSize + SVByteSize + SVShortSize;     break;
+			case SVTypeIntIntInt:      size += SVIntegerSize * 3;                          break;
+		}
+	}
+
+	return size;
+}
+
+#define SV_WRITE(output, type, value) do { \
+	type _value = (value); \
+	memcpy(output, &_value, sizeof(_value)); \
+	output += sizeof(_value); \
+} while (0)
+
+size_t
+SV_MetadataToByteArray (SVMetadata* self, uint8_t* array)
+{
+	uint8_t* output = array;
+
+	for (size_t i = 0; self && i < self->length; i++) {
+		SVData* item = self->item[i];
+
+		*output++ = (item->type << 5) | (item->index & 0x1F);
+
+		switch (item->type) {
+			case SVTypeByte:
+				*output++ = item->data.b;
+			break;
+
+			case SVTypeShort:
+				SV_WRITE(output, SVShort, htons(item->data.s));
+			break;
+
+			case SVTypeInteger:
+				SV_WRITE(output, SVInteger, htonl(item->data.i));
+			break;
+
+			case SVTypeFloat:
+				SV_WRITE(output, SVFloat, htonf(item->data.f));
+			break;
+
+			case SVTypeString:
+				SV_WRITE(output, SVShort, htons(CD_StringSize(item->data.S)));
+
+				memcpy(output, CD_StringContent(item->data.S), CD_StringSize(item->data.S));
+				output += CD_StringSize(item->data.S);
+			break;
+
+			case SVTypeShortByteShort:
+				SV_WRITE(output, SVShort, htons(item->data.sbs.first));
+				*output++ = item->data.sbs.second;
+				SV_WRITE(output, SVShort, htons(item->data.sbs.third));
+			break;
+
+			case SVTypeIntIntInt:
+				SV_WRITE(output, SVInteger, htonl(item->data.iii.first));
+				SV_WRITE(output, SVInteger, htonl(item->data.iii.second));
+				SV_WRITE(output, SVInteger, htonl(item->data.iii.third));
+			break;
+		}
+	}
+
+	*output++ = 127;
+
+	return output - array;
+}
+
+#undef SV_WRITE
+
 bool
 SV_StringIsValid (SVString self)
 {
 	assert(self);
 
-	for (size_t i = 0, ie = CD_StringLength(self); i < ie; i++) {
-		bool      has = false;
-		CDString* ch  = CD_CharAt(self, i);
+	if (self->clean) {
+		return true;
+	}
 
-		for (size_t h = 0; h < SVCharsetLen; h++) {
-			const char* che = &SVCharset[SVCharsetOffset[h]];
+	SV_InitializeCharset();
 
-			if (strncmp(CD_StringContent(ch), che, CD_StringSize(ch)) == 0) {
-				has = true;
-				break;
-			}
+	const uint8_t* data   = (const uint8_t*) CD_StringContent(self);
+	size_t         size   = CD_StringSize(self);
+	size_t         length = CD_StringLength(self);
+
+	for (size_t offset = 0, i = 0; offset < size; i++) {
+		size_t run = sv_CharsetASCIIRun(data + offset, size - offset);
+
+		if (run > 0) {
+			offset += run;
+			i      += run - 1;
+
+			continue;
 		}
 
-		if (!has && !(strncmp(CD_StringContent(ch), "§", 2) == 0 && i < ie - 2)) {
-			CD_DestroyString(ch);
+		uint32_t ch;
+
+		offset += sv_UTF8Next(data + offset, size - offset, &ch);
+
+		// color codes need something to color after them
+		if (!sv_CharsetHas(ch) && !(ch == SV_SECTION_SIGN && i < length - 2)) {
 			return false;
 		}
-
-		CD_DestroyString(ch);
 	}
 
+	self->clean = true;
+
 	return true;
 }
 
 SVString
 SV_StringSanitize (SVString self)
 {
-	CDString* result = CD_CreateString();
-
 	assert(self);
 
-	for (size_t i = 0, ie = CD_StringLength(self); i < ie; i++) {
-		bool      has = false;
-		CDString* ch  = CD_CharAt(self, i);
+	SV_InitializeCharset();
 
-		for (size_t h = 0; h < SVCharsetLen; h++) {
-			const char* che = &SVCharset[SVCharsetOffset[h]];
-			
-			if (strncmp(CD_StringContent(ch), che, CD_StringSize(ch)) == 0) {
-				has = true;
-				break;
-			}
+	const uint8_t* data    = (const uint8_t*) CD_StringContent(self);
+	size_t         size    = CD_StringSize(self);
+	size_t         length  = CD_StringLength(self);
+	char*          output  = CD_malloc(size + 1);
+	size_t         written = 0;
+	bool           changed = false;
+	CDString*      result;
+
+	// replacements never take more bytes than the original characters
+	for (size_t offset = 0, i = 0; offset < size; i++) {
+		size_t run = sv_CharsetASCIIRun(data + offset, size - offset);
+
+		if (run > 0) {
+			memcpy(output + written, data + offset, run);
+
+			offset  += run;
+			written += run;
+			i       += run - 1;
+
+			continue;
 		}
 
-		if (i == ie - 2 && strncmp(CD_StringContent(ch), "§", 2) == 0){
-			CD_DestroyString(ch);
+		uint32_t ch;
+		size_t   width = sv_UTF8Next(data + offset, size - offset, &ch);
+
+		// a color code without anything to color is dropped with its last character
+		if (ch == SV_SECTION_SIGN && i == length - 2) {
+			changed = true;
 			break;
 		}
 
-		if (has || strncmp(CD_StringContent(ch), "§", 2) == 0) {
-			CD_AppendString(result, ch);
+		if (sv_CharsetHas(ch) || ch == SV_SECTION_SIGN) {
+			memcpy(output + written, data + offset, width);
+
+			written += width;
 		}
 		else {
-			CD_AppendCString(result, "?");
+			output[written++] = '?';
+
+			changed = true;
 		}
 
-		CD_DestroyString(ch);
+		offset += width;
 	}
 
-	self->length = CD_UTF8_strnlen(CD_StringContent(self), self->raw->slen);
+	output[written] = '\0';
+
+	result            = CD_CreateStringFromBuffer(output, written);
+	result->external  = false;
+	result->raw->mlen = written + 1;
+	result->clean     = true;
+
+	if (!changed) {
+		self->clean = true;
+	}
 
 	return result;
 }
@@ -246,12 +493,10 @@ SV_CompareChunkPosition (CDSet* self, SVChunkPosition* a, SVChunkPosition* b)
 unsigned int
 SV_HashChunkPosition (CDSet* self, SVChunkPosition* position)
 {
-	const int HASHMULTIPLIER = 31;
-	const int CHUNKBUCKETS   = 401; // Max chunks to the nearest prime
-
 	assert(self);
 
-	return ((((position->x * HASHMULTIPLIER)) * HASHMULTIPLIER + position->z) * HASHMULTIPLIER) % CHUNKBUCKETS;
+	// the set reduces the hash to its own size, keep all the bits and mix both axes in
+	return ((uint32_t) position->x * 73856093u) ^ ((uint32_t) position->z * 19349663u);
 }
 
 void
@@ -267,3 +512,112 @@ SV_ChunkToByteArray (SVChunk* chunk, uint8_t* array)
 	offset += 16384;
 	memcpy(array + offset, chunk->skyLight, 16384);
 }
+
+static
+void
+sv_DestroyChunkDeflater (void* data)
+{
+	SVChunkDeflater* self = (SVChunkDeflater*) data;
+
+	deflateEnd(&self->stream);
+
+	CD_free(self);
+}
+
+static
+void
+sv_CreateChunkDeflaterKey (void)
+{
+	if (pthread_key_create(&_deflater, sv_DestroyChunkDeflater) != 0) {
+		CD_abort("pthread key failed to initialize");
+	}
+}
+
+/**
+ * Get the calling thread's deflate stream, reset and set to the given level
+ */
+static
+z_stream*
+sv_GetChunkDeflater (int level)
+{
+	SVChunkDeflater* self;
+
+	pthread_once(&_deflaterOnce, sv_CreateChunkDeflaterKey);
+
+	if ((self = (SVChunkDeflater*) pthread_getspecific(_deflater)) == NULL) {
+		self = CD_alloc(sizeof(SVChunkDeflater));
+
+		if (deflateInit(&self->stream, level) != Z_OK) {
+			CD_free(self);
+
+			return NULL;
+		}
+
+		self->level = level;
+
+		pthread_setspecific(_deflater, self);
+
+		return &self->stream;
+	}
+
+	if (deflateReset(&self->stream) != Z_OK) {
+		return NULL;
+	}
+
+	if (self->level != level) {
+		if (deflateParams(&self->stream, level, Z_DEFAULT_STRATEGY) != Z_OK) {
+			return NULL;
+		}
+
+		self->level = level;
+	}
+
+	return &self->stream;
+}
+
+size_t
+SV_ChunkCompressBound (void)
+{
+	return compressBound(81920);
+}
+
+size_t
+SV_ChunkCompress (SVChunk* chunk, int level, uint8_t* output, size_t length)
+{
+	z_stream* stream;
+
+	const struct {
+		uint8_t* data;
+		size_t   length;
+	} parts[] = {
+		{ chunk->blocks,     sizeof(chunk->blocks) },
+		{ chunk->data,       sizeof(chunk->data) },
+		{ chunk->blockLight, sizeof(chunk->blockLight) },
+		{ chunk->skyLight,   sizeof(chunk->skyLight) }
+	};
+
+	assert(chunk);
+	assert(output);
+
+	if ((stream = sv_GetChunkDeflater(level)) == NULL) {
+		return 0;
+	}
+
+	stream->next_out  = output;
+	stream->avail_out = length;
+
+	for (size_t i = 0; i < ARRAY_SIZE(parts); i++) {
+		bool last = (i == ARRAY_SIZE(parts) - 1);
+
+		stream->next_in  = parts[i].data;
+		stream->avail_in = parts[i].length;
+
+		int status = deflate(stream, last ? Z_FINISH : Z_NO_FLUSH);
+
+		if (last ? status != Z_STREAM_END : (status != Z_OK || stream->avail_in != 0)) {
+			return 0;
+		}
+	}
+
+	return stream->total_out;
+}